@@ -18,7 +18,9 @@
 #include "rapidjson/stringbuffer.h"
 #include "sha256.h"
 #include "hmac.h"
+#include "trace/Trace.h"
 #include <kodi/Filesystem.h>
+#include "log/DebugLog.h"
 
 /***********************************************************
   * PVR Client AddOn specific public library functions
@@ -92,7 +94,7 @@ bool CPVRMagenta::is_pvr_allowed(const rapidjson::Value& current_item)
   return false;
 }
 
-int CPVRMagenta::SelectMediaId(const MagentaChannel channel, const bool npvr)
+int CPVRMagenta::SelectMediaId(const MagentaChannel& channel, const bool npvr)
 {
 
   int currentMediaId = 0;
@@ -119,7 +121,7 @@ int CPVRMagenta::SelectMediaId(const MagentaChannel channel, const bool npvr)
   return currentMediaId;
 }
 
-std::string CPVRMagenta::GetPlayUrl(const MagentaChannel channel, const int mediaId)
+std::string CPVRMagenta::GetPlayUrl(const MagentaChannel& channel, const int mediaId)
 {
   for (int i = 0; i < channel.physicalChannels.size(); i++)
   {
@@ -130,7 +132,18 @@ std::string CPVRMagenta::GetPlayUrl(const MagentaChannel channel, const int medi
   return "";
 }
 
-bool CPVRMagenta::HasStreamingUrl(const MagentaChannel channel)
+void CPVRMagenta::UpdateMediaSelection()
+{
+  std::lock_guard<std::mutex> lock(m_mediaSelectionMutex);
+  for (auto& channel : m_channels)
+  {
+    channel.liveMediaId = SelectMediaId(channel, false);
+    channel.npvrMediaId = SelectMediaId(channel, true);
+    channel.livePlayUrl = GetPlayUrl(channel, channel.liveMediaId);
+  }
+}
+
+bool CPVRMagenta::HasStreamingUrl(const MagentaChannel& channel)
 {
   for (int i = 0; i < channel.physicalChannels.size(); i++)
   {
@@ -161,7 +174,7 @@ void CPVRMagenta::GenerateCNonce()
   }
   m_cnonce = string_to_hex(convert.str());
   std::transform(m_cnonce.begin(), m_cnonce.end(), m_cnonce.begin(), ::tolower);
-  kodi::Log(ADDON_LOG_DEBUG, "Generated cnonce %s", m_cnonce.c_str());
+  DEBUG_LOG("Generated cnonce %s", m_cnonce.c_str());
 }
 
 bool CPVRMagenta::JsonRequest(const std::string& url, const std::string& postData, rapidjson::Document& doc)
@@ -169,15 +182,22 @@ bool CPVRMagenta::JsonRequest(const std::string& url, const std::string& postDat
   int statusCode = 0;
   std::string result = m_httpClient->HttpPost(url, postData, statusCode);
 
-  doc.Parse(result.c_str());
+  profiletime_t parseStart = std::chrono::steady_clock::now();
+  {
+    TRACE_SCOPE("json", "Parse");
+    doc.Parse(result.c_str());
+  }
+  StartupProfiler::AddParse(parseStart);
   if ((doc.GetParseError()) || (!doc.HasMember("retcode") || (statusCode != 200)))
   {
-    kodi::Log(ADDON_LOG_ERROR, "Failed JsonRequest %s with body %s", url.c_str(), postData.c_str());
+    kodi::Log(ADDON_LOG_ERROR, "Failed JsonRequest %s with body %s", url.c_str(), DebugLog::RedactParameters(postData).c_str());
     return false;
   }
   if (Utils::JsonStringOrEmpty(doc, "retcode") == "-2") {
-    kodi::Log(ADDON_LOG_DEBUG, "Retcode returned -2 from %s - need to reauthenticate", url.c_str());
+    DEBUG_LOG("Retcode returned -2 from %s - need to reauthenticate", url.c_str());
+    m_httpClient->GetMetrics().AddReauth(url);
     MagentaAuthenticate();
+    m_httpClient->GetMetrics().AddRetry(url);
     result = m_httpClient->HttpPost(url, postData, statusCode);
 
     doc.Parse(result.c_str());
@@ -188,11 +208,11 @@ bool CPVRMagenta::JsonRequest(const std::string& url, const std::string& postDat
     }
   }
   if (doc.HasMember("retmsg")) {
-    kodi::Log(ADDON_LOG_DEBUG, "JSON Request return message: %s", Utils::JsonStringOrEmpty(doc, "retmsg").c_str());
+    DEBUG_LOG("JSON Request return message: %s", Utils::JsonStringOrEmpty(doc, "retmsg").c_str());
   }
   if (Utils::JsonStringOrEmpty(doc, "retcode") != "0")
   {
-    kodi::Log(ADDON_LOG_ERROR, "JsonRequest returned not 0 with url %s, and body %s", url.c_str(), postData.c_str());
+    kodi::Log(ADDON_LOG_ERROR, "JsonRequest returned not 0 with url %s, and body %s", url.c_str(), DebugLog::RedactParameters(postData).c_str());
     kodi::Log(ADDON_LOG_ERROR, "JsonRequest returned %s", result.c_str());
     return false;
   }
@@ -219,7 +239,7 @@ bool CPVRMagenta::GuestLogin()
 
   if (doc.HasMember("epghttpsurl")) {
     m_epg_https_url = Utils::JsonStringOrEmpty(doc, "epghttpsurl") + EPGDIR;
-    kodi::Log(ADDON_LOG_DEBUG, "Setting EPG url to: %s", m_epg_https_url.c_str());
+    DEBUG_LOG("Setting EPG url to: %s", m_epg_https_url.c_str());
     if (doc.HasMember("sam3Para")) {
       const rapidjson::Value& sam3paras = doc["sam3Para"];
       for (rapidjson::Value::ConstValueIterator itr1 = sam3paras.Begin();
@@ -235,7 +255,7 @@ bool CPVRMagenta::GuestLogin()
         kodi::Log(ADDON_LOG_ERROR, "Failed to get SAM3ServiceURL!");
         return false;
       } else {
-        kodi::Log(ADDON_LOG_DEBUG, "Setting SAM3ServiceURL to: %s", m_sam_service_url.c_str());
+        DEBUG_LOG("Setting SAM3ServiceURL to: %s", m_sam_service_url.c_str());
       }
     }
   } else {
@@ -247,7 +267,7 @@ bool CPVRMagenta::GuestLogin()
 
 bool CPVRMagenta::GuestAuthenticate()
 {
-  kodi::Log(ADDON_LOG_DEBUG, "function call: [%s]", __FUNCTION__);
+  DEBUG_LOG("function call: [%s]", __FUNCTION__);
 
   std::string url = m_epg_https_url + "Authenticate";
   std::string postData = "{\"cnonce\": \"" + m_cnonce + "\","
@@ -270,6 +290,7 @@ bool CPVRMagenta::GuestAuthenticate()
   }
 
   m_settings->SetSetting("csrftoken", Utils::JsonStringOrEmpty(doc, "csrfToken"));
+  std::lock_guard<std::mutex> lock(m_sessionMutex);
   m_userGroup = Utils::JsonStringOrEmpty(doc, "usergroup");
   m_sessionID = Utils::JsonStringOrEmpty(doc, "sessionid");
   m_encryptToken = Utils::JsonStringOrEmpty(doc, "encryptToken");
@@ -281,7 +302,7 @@ bool CPVRMagenta::GuestAuthenticate()
 
 bool CPVRMagenta::MagentaDTAuthenticate()
 {
-  kodi::Log(ADDON_LOG_DEBUG, "function call: [%s]", __FUNCTION__);
+  DEBUG_LOG("function call: [%s]", __FUNCTION__);
 
   std::string url = m_epg_https_url + "DTAuthenticate";
   std::string postData = "{\"accessToken\": \"" + m_settings->GetMagentaEPGToken() +
@@ -320,8 +341,11 @@ bool CPVRMagenta::MagentaDTAuthenticate()
   rapidjson::Document doc;
   if (!JsonRequest(url, postData, doc)) {
     if (!doc.GetParseError()) {
-      m_userID = Utils::JsonStringOrEmpty(doc, "userID");
-      m_userGroup = Utils::JsonStringOrEmpty(doc, "usergroup");
+      {
+        std::lock_guard<std::mutex> lock(m_sessionMutex);
+        m_userID = Utils::JsonStringOrEmpty(doc, "userID");
+        m_userGroup = Utils::JsonStringOrEmpty(doc, "usergroup");
+      }
       if (m_userID.empty()) {
         return false;
       }
@@ -341,12 +365,15 @@ bool CPVRMagenta::MagentaDTAuthenticate()
   m_licence_url = Utils::JsonStringOrEmpty(ca_verimatrix, "multiRightsWidevine");
   const rapidjson::Value& ca_device = doc["caDeviceInfo"][0];
   m_ca_device_id = Utils::JsonStringOrEmpty(ca_device, "VUID");
-  m_userID = Utils::JsonStringOrEmpty(doc, "userID");
-  m_userGroup = Utils::JsonStringOrEmpty(doc, "usergroup");
-  m_sessionID = Utils::JsonStringOrEmpty(doc, "sessionid");
-  m_encryptToken = Utils::JsonStringOrEmpty(doc, "encryptToken");
-  m_userContentFilter = Utils::JsonStringOrEmpty(doc, "userContentFilter");
-  m_userContentListFilter = Utils::JsonStringOrEmpty(doc, "userContentListFilter");
+  {
+    std::lock_guard<std::mutex> lock(m_sessionMutex);
+    m_userID = Utils::JsonStringOrEmpty(doc, "userID");
+    m_userGroup = Utils::JsonStringOrEmpty(doc, "usergroup");
+    m_sessionID = Utils::JsonStringOrEmpty(doc, "sessionid");
+    m_encryptToken = Utils::JsonStringOrEmpty(doc, "encryptToken");
+    m_userContentFilter = Utils::JsonStringOrEmpty(doc, "userContentFilter");
+    m_userContentListFilter = Utils::JsonStringOrEmpty(doc, "userContentListFilter");
+  }
 
   if (doc.HasMember("configurations")) {
     const rapidjson::Value& configurations = doc["configurations"];
@@ -366,19 +393,36 @@ bool CPVRMagenta::MagentaDTAuthenticate()
   }
 
   std::string key = MagentaParameters[m_params].pskValue + m_userID + m_encryptToken + m_cnonce;
-  kodi::Log(ADDON_LOG_DEBUG, "Key: %s", key.c_str());
+  DEBUG_LOG("Key: %s", DebugLog::Redact(key).c_str());
 
   SHA256 sha256;
-  m_session_key  = sha256(key);
-  std::transform(m_session_key.begin(), m_session_key.end(), m_session_key.begin(), ::toupper);
+  std::string sessionKey = sha256(key);
+  std::transform(sessionKey.begin(), sessionKey.end(), sessionKey.begin(), ::toupper);
+  {
+    std::lock_guard<std::mutex> lock(m_sessionMutex);
+    m_session_key = sessionKey;
+  }
 
-  kodi::Log(ADDON_LOG_DEBUG, "Session key: %s", m_session_key.c_str());
+  DEBUG_LOG("Session key: %s", DebugLog::Redact(sessionKey).c_str());
   return true;
 }
 
+std::string CPVRMagenta::GetSessionValue(const std::string& value)
+{
+  // only the auth flight writes these, everybody else reads a copy
+  std::lock_guard<std::mutex> lock(m_sessionMutex);
+  return value;
+}
+
 bool CPVRMagenta::MagentaAuthenticate()
 {
-  kodi::Log(ADDON_LOG_DEBUG, "function call: [%s]", __FUNCTION__);
+  DEBUG_LOG("function call: [%s]", __FUNCTION__);
+  // parallel EPG and playback requests all see retcode -2 when the session ends
+  return m_authFlight.Do([this]() { return MagentaSamAuthenticate(); });
+}
+
+bool CPVRMagenta::MagentaSamAuthenticate()
+{
   if (!MagentaDTAuthenticate()) {
     int statusCode = 0;
     std::string url = m_sam_service_url + "/oauth2/tokens";
@@ -451,7 +495,7 @@ bool CPVRMagenta::GetCategories()
   std::string jsonString;
   int statusCode = 0;
 
-  std::string url = m_epg_https_url + "CategoryList?userContentListFilter=" + m_userContentListFilter;
+  std::string url = m_epg_https_url + "CategoryList?userContentListFilter=" + GetSessionValue(m_userContentListFilter);
   std::string postData = "{\"offset\": 0, \"count\": 1000,"
 	                       "\"type\": \"VOD;AUDIO_VOD;VIDEO_VOD;CHANNEL;AUDIO_CHANNEL;VIDEO_CHANNEL;MIX;VAS;PROGRAM\","
 	                       "\"categoryid\": \"" + m_ChannelCategoryID + "\"}";
@@ -553,62 +597,137 @@ void CPVRMagenta::FillRecording(const rapidjson::Value& recordingItem, MagentaRe
   }
 }
 
-bool CPVRMagenta::GetTimersRecordings(const bool isRecording)
+std::string CPVRMagenta::GetFingerprint(const rapidjson::Value& item)
 {
-  kodi::Log(ADDON_LOG_DEBUG, "function call: [%s]", __FUNCTION__);
-  if (isRecording) {
-    m_recordings.clear();
-    m_recGroups.clear();
-  } else {
-    m_timers.clear();
-    m_timerGroups.clear();
+  // only the fields that change on an existing recording, serializing the whole item costs more than FillRecording
+  static const char* fields[] = { "status", "beginTime", "endTime", "beginOffset", "endOffset",
+                                  "realRecordLength", "bookmarkTime", "isWatched", "deleteMode", "pvrName" };
+  std::string fingerprint;
+  for (const auto& field : fields)
+  {
+    fingerprint += Utils::JsonStringOrEmpty(item, field);
+    fingerprint += '|';
   }
+  return fingerprint;
+}
 
-  std::string url = m_epg_https_url + "QueryPVR";
-  std::string postData = "{\"count\": -1,"
-	                       "\"expandSubTask\": 2,"
-	                       "\"isFilter\": 0,"
-	                       "\"offset\": 0,"
-	                       "\"orderType\": 1,";
-  if (m_settings->IsOnlyCloud()) {
-    postData += "\"pvrType\": 2,";
-  }
-  postData += "\"type\": 0,"
-	            "\"DTQueryType\": ";
-  postData += (isRecording ? "0" : "1");
-  postData += "}";
+unsigned int CPVRMagenta::GetSyncIndex(MagentaSyncState& state, const std::string& key)
+{
+  auto it = state.indexes.find(key);
+  if (it != state.indexes.end())
+    return it->second;
+  state.indexes[key] = state.nextIndex;
+  return state.nextIndex++;
+}
 
-  rapidjson::Document doc;
-  if (!JsonRequest(url, postData, doc)) {
-    return PVR_ERROR_FAILED;
+void CPVRMagenta::InvalidateTimersRecordings()
+{
+  m_recordingSync.isValid = false;
+  m_timerSync.isValid = false;
+}
+
+void CPVRMagenta::SyncRecordingItem(MagentaSyncState& state,
+                                    const rapidjson::Value& recordingItem,
+                                    const std::map<std::string, const MagentaRecording*>& known,
+                                    std::map<std::string, std::string>& fingerprints,
+                                    std::vector<MagentaRecording>& items,
+                                    MagentaSyncResult& result)
+{
+  std::string pvrId = Utils::JsonStringOrEmpty(recordingItem, "pvrId");
+  std::string fingerprint = GetFingerprint(recordingItem);
+  fingerprints[pvrId] = fingerprint;
+
+  auto itKnown = known.find(pvrId);
+  auto itFingerprint = state.fingerprints.find(pvrId);
+  if ((itKnown != known.end()) && (itFingerprint != state.fingerprints.end()) &&
+      (itFingerprint->second == fingerprint))
+  {
+    items.emplace_back(*itKnown->second);
+    return;
   }
 
-  if (doc.HasMember("pvrlist"))
+  MagentaRecording magenta_recording;
+  FillRecording(recordingItem, magenta_recording, GetSyncIndex(state, pvrId));
+  items.emplace_back(magenta_recording);
+  if (itKnown == known.end())
+    result.added++;
+  else
+    result.updated++;
+  DEBUG_LOG("%s item: [%s]", (itKnown == known.end()) ? "New" : "Changed",
+            magenta_recording.pvrName.c_str());
+}
+
+bool CPVRMagenta::SyncTimersRecordings(const bool isRecording, MagentaSyncResult& result)
+{
+  DEBUG_LOG("function call: [%s]", __FUNCTION__);
+  result = {0, 0, 0};
+
+  MagentaSyncState& state = isRecording ? m_recordingSync : m_timerSync;
+  std::vector<MagentaRecording>& items = isRecording ? m_recordings : m_timers;
+  std::vector<MagentaRecordingGroup>& groups = isRecording ? m_recGroups : m_timerGroups;
+
+  time_t now = time(nullptr);
+  if (state.isValid && (state.lastSync + PVR_SYNC_MIN_INTERVAL > now))
   {
-    const rapidjson::Value& recordings = doc["pvrlist"];
+    DEBUG_LOG("%s snapshot still fresh", isRecording ? "Recordings" : "Timers");
+    return true;
+  }
+
+  std::map<std::string, const MagentaRecording*> known;
+  for (const auto& item : items)
+    known[item.pvrId] = &item;
+  std::map<std::string, const MagentaRecordingGroup*> knownGroups;
+  for (const auto& group : groups)
+    knownGroups[group.periodPVRTaskId] = &group;
+
+  std::vector<MagentaRecording> newItems;
+  std::vector<MagentaRecordingGroup> newGroups;
+  std::map<std::string, std::string> fingerprints;
 
-    unsigned int index = 1;
+  std::string url = m_epg_https_url + "QueryPVR";
+  int offset = 0;
+  int total = -1;
+  rapidjson::SizeType received = 0;
+  do
+  {
+    std::string postData = "{\"count\": " + std::to_string(PVR_SYNC_PAGE_SIZE) + ","
+	                         "\"expandSubTask\": 2,"
+	                         "\"isFilter\": 0,"
+	                         "\"offset\": " + std::to_string(offset) + ","
+	                         "\"orderType\": 1,";
+    if (m_settings->IsOnlyCloud()) {
+      postData += "\"pvrType\": 2,";
+    }
+    postData += "\"type\": 0,"
+	              "\"DTQueryType\": ";
+    postData += (isRecording ? "0" : "1");
+    postData += "}";
+
+    rapidjson::Document doc;
+    if (!JsonRequest(url, postData, doc)) {
+      return false;
+    }
+    if (!doc.HasMember("pvrlist"))
+      break;
+
+    std::string counttotal = Utils::JsonStringOrEmpty(doc, "counttotal");
+    if (!counttotal.empty())
+      total = std::stoi(counttotal);
+
+    const rapidjson::Value& recordings = doc["pvrlist"];
+    received = recordings.Size();
     for (rapidjson::Value::ConstValueIterator itr1 = recordings.Begin();
         itr1 != recordings.End(); ++itr1)
     {
       const rapidjson::Value& recordingItem = (*itr1);
 
       if (recordingItem.HasMember("pvrId")) {
-        MagentaRecording magenta_recording;
-        FillRecording(recordingItem, magenta_recording, index++);
-
-        if (isRecording) {
-          m_recordings.emplace_back(magenta_recording);
-          kodi::Log(ADDON_LOG_DEBUG, "Found recording: [%s]", magenta_recording.pvrName.c_str());
-        } else {
-          m_timers.emplace_back(magenta_recording);
-          kodi::Log(ADDON_LOG_DEBUG, "Found timer: [%s]", magenta_recording.pvrName.c_str());
-        }
+        SyncRecordingItem(state, recordingItem, known, fingerprints, newItems, result);
       } else if (recordingItem.HasMember("periodPVRTaskName") && (recordingItem.HasMember("periodPVRTaskId")) && (recordingItem.HasMember("pvrList"))) {
         MagentaRecordingGroup recording_group;
 
-        recording_group.index = index++;
         recording_group.periodPVRTaskId = Utils::JsonStringOrEmpty(recordingItem, "periodPVRTaskId");
+        recording_group.index = GetSyncIndex(state, "group:" + recording_group.periodPVRTaskId);
         recording_group.periodPVRTaskName = Utils::JsonStringOrEmpty(recordingItem, "periodPVRTaskName");
         recording_group.channelName = Utils::JsonStringOrEmpty(recordingItem, "channelName");
         recording_group.seriesType = stoi(Utils::JsonStringOrEmpty(recordingItem, "seriesType"));
@@ -629,36 +748,47 @@ bool CPVRMagenta::GetTimersRecordings(const bool isRecording)
               itr2 != groupmembers.End(); ++itr2)
         {
           const rapidjson::Value& groupItem = (*itr2);
-          MagentaRecording magenta_recording;
-          FillRecording(groupItem, magenta_recording, index++);
+          if (!groupItem.HasMember("pvrId"))
+            continue;
+          SyncRecordingItem(state, groupItem, known, fingerprints, newItems, result);
 
           //recording_group.groupRecordings.emplace_back(magenta_recording);
-          magenta_recording.periodPVRTaskName = Utils::JsonStringOrEmpty(recordingItem, "periodPVRTaskName");
-          magenta_recording.groupIndex = recording_group.index;
-          if (isRecording) {
-            m_recordings.emplace_back(magenta_recording);
-            kodi::Log(ADDON_LOG_DEBUG, "Added recording to group: %s with seriesId: %i, ID: %s", magenta_recording.pvrName.c_str(), magenta_recording.seriesId, magenta_recording.pvrId.c_str());
-          } else {
-            m_timers.emplace_back(magenta_recording);
-            kodi::Log(ADDON_LOG_DEBUG, "Added timer to group: %s with seriesId: %i, ID: %s", magenta_recording.pvrName.c_str(), magenta_recording.seriesId, magenta_recording.pvrId.c_str());
-          }
+          newItems.back().periodPVRTaskName = recording_group.periodPVRTaskName;
+          newItems.back().groupIndex = recording_group.index;
         }
-        if (isRecording) {
-          m_recGroups.emplace_back(recording_group);
-          kodi::Log(ADDON_LOG_DEBUG, "Added recording group: %s Index: %i", recording_group.periodPVRTaskName.c_str(), recording_group.seriesId);
-        } else {
-          m_timerGroups.emplace_back(recording_group);
-          kodi::Log(ADDON_LOG_DEBUG, "Added timer group: %s Index: %i", recording_group.periodPVRTaskName.c_str(), recording_group.seriesId);
+        if (knownGroups.find(recording_group.periodPVRTaskId) == knownGroups.end()) {
+          result.added++;
+          DEBUG_LOG("New %s group: %s Index: %i", isRecording ? "recording" : "timer", recording_group.periodPVRTaskName.c_str(), recording_group.index);
         }
+        fingerprints["group:" + recording_group.periodPVRTaskId] = recording_group.periodPVRTaskName;
+        newGroups.emplace_back(recording_group);
       }
     }
+    offset += static_cast<int>(received);
+  } while ((static_cast<int>(received) == PVR_SYNC_PAGE_SIZE) && ((total < 0) || (offset < total)));
+
+  for (auto it = state.fingerprints.begin(); it != state.fingerprints.end(); ++it)
+  {
+    if (fingerprints.find(it->first) == fingerprints.end()) {
+      state.indexes.erase(it->first);
+      result.removed++;
+    }
   }
+
+  items.swap(newItems);
+  groups.swap(newGroups);
+  state.fingerprints.swap(fingerprints);
+  state.lastSync = now;
+  state.isValid = true;
+  DEBUG_LOG("%s synced: %i items, %i added, %i changed, %i removed",
+            isRecording ? "Recordings" : "Timers", static_cast<int>(items.size()),
+            result.added, result.updated, result.removed);
   return true;
 }
 
 bool CPVRMagenta::GetGenreIds()
 {
-  kodi::Log(ADDON_LOG_DEBUG, "function call: [%s]", __FUNCTION__);
+  DEBUG_LOG("function call: [%s]", __FUNCTION__);
 
   m_genres.clear();
   std::string url = m_epg_https_url + "GetGenreList";
@@ -693,7 +823,7 @@ bool CPVRMagenta::GetMyGenres()
   std::string content;
   kodi::vfs::CFile myFile;
   std::string file = kodi::addon::GetAddonPath() + "mygenres.json";
-  kodi::Log(ADDON_LOG_DEBUG, "Opening mygenres: %s", file.c_str());
+  DEBUG_LOG("Opening mygenres: %s", file.c_str());
   if (myFile.OpenFile(file))
   {
     char buffer[1024];
@@ -721,7 +851,7 @@ bool CPVRMagenta::GetMyGenres()
       if (genre.genreId == currentGenreId) {
         genre.kodiGenre.genreType = stoi(Utils::JsonStringOrEmpty(genres[i], "genreType"));
         genre.kodiGenre.genreSubType = stoi(Utils::JsonStringOrEmpty(genres[i], "genreSubType"));
-        kodi::Log(ADDON_LOG_DEBUG, "Added mapped genre for Magenta GenreID: %i, Kodi Genre Type: %i, Kodi Genre Subtype: %i",
+        DEBUG_LOG("Added mapped genre for Magenta GenreID: %i, Kodi Genre Type: %i, Kodi Genre Subtype: %i",
                                     genre.genreId, genre.kodiGenre.genreType, genre.kodiGenre.genreSubType);
       }
     }
@@ -732,11 +862,10 @@ bool CPVRMagenta::GetMyGenres()
 
 bool CPVRMagenta::GetDeviceList()
 {
-  kodi::Log(ADDON_LOG_DEBUG, "function call: [%s]", __FUNCTION__);
+  DEBUG_LOG("function call: [%s]", __FUNCTION__);
 
-  m_devices.clear();
   std::string url = m_epg_https_url + "GetDeviceList";
-  std::string postData = "{\"userid\": \"" + m_userID + "\","
+  std::string postData = "{\"userid\": \"" + GetSessionValue(m_userID) + "\","
 	                        "\"deviceType\": \"" + std::to_string(IPTV_STB) + ";" +
                                                  std::to_string(OTT) + ";" +
                                                  std::to_string(OTT_STB) + "\"}";
@@ -752,6 +881,7 @@ bool CPVRMagenta::GetDeviceList()
 
   const rapidjson::Value& devices = doc["deviceList"];
 
+  std::vector<MagentaDevice> deviceList;
   for (rapidjson::SizeType i = 0; i < devices.Size(); i++)
   {
     MagentaDevice magenta_device;
@@ -766,14 +896,19 @@ bool CPVRMagenta::GetDeviceList()
     magenta_device.channelNamespaceName = Utils::JsonStringOrEmpty(devices[i], "channelNamespaceName");
     magenta_device.status = stoi(Utils::JsonStringOrEmpty(devices[i], "status"));
 
-    kodi::Log(ADDON_LOG_DEBUG, "Found device %s, device ID: %s, device type %i, physical ID: %s, last online: %s",
+    DEBUG_LOG("Found device %s, device ID: %s, device type %i, physical ID: %s, last online: %s",
                                                             magenta_device.deviceName.c_str(),
                                                             magenta_device.deviceId.c_str(),
                                                             magenta_device.deviceType,
                                                             magenta_device.physicalDeviceId.c_str(),
                                                             magenta_device.lastOfflineTime.c_str());
 
-    m_devices.emplace_back(magenta_device);
+    deviceList.emplace_back(magenta_device);
+  }
+  {
+    // a re-authentication inside any startup step places the device as well
+    std::lock_guard<std::mutex> lock(m_devicesMutex);
+    m_devices.swap(deviceList);
   }
 
 /*
@@ -794,7 +929,8 @@ bool CPVRMagenta::GetDeviceList()
 
 bool CPVRMagenta::IsDeviceInList()
 {
-  kodi::Log(ADDON_LOG_DEBUG, "function call: [%s]", __FUNCTION__);
+  DEBUG_LOG("function call: [%s]", __FUNCTION__);
+  std::lock_guard<std::mutex> lock(m_devicesMutex);
   for (const auto& device : m_devices)
   {
     if (m_device_id == device.physicalDeviceId)
@@ -807,15 +943,16 @@ bool CPVRMagenta::IsDeviceInList()
 
 bool CPVRMagenta::ReplaceDevice(const std::string& orgDeviceId)
 {
-  kodi::Log(ADDON_LOG_DEBUG, "Replace device with ID: [%s]", orgDeviceId.c_str());
+  DEBUG_LOG("Replace device with ID: [%s]", orgDeviceId.c_str());
 
-  if ((m_userID.empty()) || (m_device_id.empty()) || (orgDeviceId.empty()))
+  std::string userId = GetSessionValue(m_userID);
+  if ((userId.empty()) || (m_device_id.empty()) || (orgDeviceId.empty()))
     return false;
 
   std::string url = m_epg_https_url + "ReplaceDevice";
   std::string postData = "{\"destDeviceId\": \"" + m_device_id + "\","
 	                        "\"orgDeviceId\": \"" + orgDeviceId + "\","
-	                        "\"userid\": \"" + m_userID + "\"}";
+	                        "\"userid\": \"" + userId + "\"}";
 
   rapidjson::Document doc;
   if (!JsonRequest(url, postData, doc)) {
@@ -827,7 +964,7 @@ bool CPVRMagenta::ReplaceDevice(const std::string& orgDeviceId)
 
 bool CPVRMagenta::ModifyDeviceName(const std::string& deviceId)
 {
-  kodi::Log(ADDON_LOG_DEBUG, "Modify device name for ID: [%s]", deviceId.c_str());
+  DEBUG_LOG("Modify device name for ID: [%s]", deviceId.c_str());
 
   std::string url = m_epg_https_url + "ModifyDeviceName";
   std::string postData = "{\"deviceid\": \"" + deviceId + "\","
@@ -843,13 +980,18 @@ bool CPVRMagenta::ModifyDeviceName(const std::string& deviceId)
 
 bool CPVRMagenta::ReplaceOldestDevice()
 {
-  kodi::Log(ADDON_LOG_DEBUG, "function call: [%s]", __FUNCTION__);
-  if (m_devices.size() == 0) {
+  DEBUG_LOG("function call: [%s]", __FUNCTION__);
+  std::vector<MagentaDevice> devices;
+  {
+    std::lock_guard<std::mutex> lock(m_devicesMutex);
+    devices = m_devices;
+  }
+  if (devices.size() == 0) {
     return false;
   }
   std::string oldest_id = "";
   time_t oldest_time;
-  for (const auto& device : m_devices)
+  for (const auto& device : devices)
   {
     if (device.deviceType != OTT)
       continue;
@@ -877,7 +1019,7 @@ bool CPVRMagenta::ReplaceOldestDevice()
 
 bool CPVRMagenta::PlaceDevice()
 {
-  kodi::Log(ADDON_LOG_DEBUG, "function call: [%s]", __FUNCTION__);
+  DEBUG_LOG("function call: [%s]", __FUNCTION__);
   if (!GetDeviceList()) {
     return false;
   }
@@ -892,10 +1034,17 @@ bool CPVRMagenta::PlaceDevice()
 }
 
 CPVRMagenta::CPVRMagenta() :
-  m_settings(new CSettings())
+  m_timeshiftWindow(TIMEBUFFER),
+  m_httpClient(nullptr),
+  m_settings(new CSettings()),
+  m_magenta2(nullptr),
+  m_sessionManager([this](const std::string& url, const std::string& postData, rapidjson::Document& doc) {
+    return JsonRequest(url, postData, doc);
+  }),
+  m_profiler("MagentaTV 1.0")
 {
   m_settings->Load();
-  m_httpClient = new HttpClient(m_settings);
+  m_httpClient = new HttpClient(m_settings, &m_httpMetrics);
 
   m_isMagenta2 = m_settings->IsMagenta2();
   if (m_isMagenta2) {
@@ -910,6 +1059,8 @@ CPVRMagenta::CPVRMagenta() :
   m_userGroup = "-1";
   m_currentMediaId = -1;
   m_currentChannelId = -1;
+  m_recordingSync = {{}, {}, 1, 0, false};
+  m_timerSync = {{}, {}, 1, 0, false};
   m_ChannelCategoryID = DEFAULT_CATEGORY_ID;
 
   m_device_id = m_settings->GetMagentaDeviceID();
@@ -917,29 +1068,44 @@ CPVRMagenta::CPVRMagenta() :
     m_device_id = Utils::CreateUUID();
     m_settings->SetSetting("deviceid", m_device_id);
   }
-  kodi::Log(ADDON_LOG_DEBUG, "Current DeviceID %s", m_device_id.c_str());
+  DEBUG_LOG("Current DeviceID %s", m_device_id.c_str());
 
-  if (!GuestLogin()) {
-    return;
-  }
-  if (m_settings->GetMagentaCSRFToken().empty()) {
-    GuestAuthenticate();
-  }
-  if (!MagentaAuthenticate()) {
-    return;
-  }
-  if (m_settings->IsGroupsenabled()) {
-    if (!GetCategories()) {
-      return;
-    }
-  }
-  GetDeviceList();
-  GetGenreIds();
-  GetMyGenres();
-  GetTimersRecordings(true); //recordings
-  GetTimersRecordings(false); //timers
-  UpdateBookmarks();
-  LoadChannels();
+  // after the login the lookups are independent of each other, only channels and
+  // genres are needed right away, recordings and devices finish in the background
+  m_startup.Add("login", {}, [this]() {
+    if (!GuestLogin())
+      return false;
+    if (m_settings->GetMagentaCSRFToken().empty())
+      GuestAuthenticate();
+    return MagentaAuthenticate();
+  });
+  m_startup.Add("categories", {"login"}, [this]() {
+    return !m_settings->IsGroupsenabled() || GetCategories();
+  });
+  m_startup.Add("channels", {"categories"}, [this]() {
+    LoadChannels();
+    UpdateMediaSelection();
+    return true;
+  });
+  m_startup.Add("genres", {"login"}, [this]() {
+    GetGenreIds();
+    GetMyGenres();
+    return true;
+  });
+  m_startup.Add("devices", {"login"}, [this]() {
+    return GetDeviceList();
+  });
+  m_startup.Add("recordings", {"login"}, [this]() {
+    MagentaSyncResult syncResult;
+    SyncTimersRecordings(true, syncResult); //recordings
+    SyncTimersRecordings(false, syncResult); //timers
+    UpdateBookmarks();
+    return true;
+  });
+  m_startup.SetProfiler(&m_profiler);
+  m_startup.Start();
+  m_startup.Wait("channels");
+  m_startup.Wait("genres");
 }
 
 bool CPVRMagenta::AddGroupChannel(const long groupid, const unsigned int channelid)
@@ -957,12 +1123,31 @@ bool CPVRMagenta::AddGroupChannel(const long groupid, const unsigned int channel
 
 CPVRMagenta::~CPVRMagenta()
 {
+  m_startup.WaitAll();
+  m_sessionManager.Stop();
+  m_taskQueue.Stop(true);
+  // the 2.0 backend joins its own startup and queues, unlocks and saves its state
+  delete m_magenta2;
+  m_magenta2 = nullptr;
+  delete m_httpClient;
+  m_httpClient = nullptr;
   m_channels.clear();
+  TRACE_DUMP("special://profile/addon_data/pvr.magenta/trace.json");
 }
 
 ADDON_STATUS CPVRMagenta::SetSetting(const std::string& settingName, const std::string& settingValue)
 {
   ADDON_STATUS result = m_settings->SetSetting(settingName, settingValue);
+  if (!m_isMagenta2 && settingName == "higherresolution")
+  {
+    m_startup.Wait("channels");
+    UpdateMediaSelection();
+  }
+  if (m_isMagenta2 && settingName == "whitelogos")
+  {
+    m_magenta2->UpdateChannelIcons();
+    kodi::addon::CInstancePVRClient::TriggerChannelUpdate();
+  }
   if (!m_settings->VerifySettings()) {
     return ADDON_STATUS_NEED_SETTINGS;
   }
@@ -973,8 +1158,8 @@ bool CPVRMagenta::LoadChannels()
 {
   m_channels.clear();
   int pictureNo = m_settings->UseWhiteLogos() ? 15:14;
-  kodi::Log(ADDON_LOG_DEBUG, "Load Magenta Channels");
-  std::string url = m_epg_https_url + "AllChannel?userContentListFilter=" + m_userContentListFilter;
+  DEBUG_LOG("Load Magenta Channels");
+  std::string url = m_epg_https_url + "AllChannel?userContentListFilter=" + GetSessionValue(m_userContentListFilter);
   std::string jsonString;
   int statusCode = 0;
   std::string postData = "{\"properties\":[{"
@@ -1060,7 +1245,7 @@ bool CPVRMagenta::LoadChannels()
         physicalChannel.definition = stoi(Utils::JsonStringOrEmpty(physicalItem, "definition"));
 
         magenta_channel.physicalChannels.emplace_back(physicalChannel);
-        kodi::Log(ADDON_LOG_DEBUG, "%i. Channel Name: %s ID: %i MediaID %i", magenta_channel.iChannelNumber, magenta_channel.strChannelName.c_str(), magenta_channel.iUniqueId, physicalChannel.mediaId);
+        DEBUG_LOG_LIMITED(1, 20, "%i. Channel Name: %s ID: %i MediaID %i", magenta_channel.iChannelNumber, magenta_channel.strChannelName.c_str(), magenta_channel.iUniqueId, physicalChannel.mediaId);
       }
     }
 
@@ -1180,7 +1365,7 @@ void CPVRMagenta::SetStreamProperties(std::vector<kodi::addon::PVRStreamProperty
                                     const std::string& url,
                                     bool realtime, bool playTimeshiftBuffer, bool epgplayback)
 {
-  kodi::Log(ADDON_LOG_DEBUG, "[PLAY STREAM] url: %s", url.c_str());
+  DEBUG_LOG("[PLAY STREAM] url: %s", url.c_str());
 
   properties.emplace_back(PVR_STREAM_PROPERTY_STREAMURL, url);
   properties.emplace_back(PVR_STREAM_PROPERTY_INPUTSTREAM, "inputstream.adaptive");
@@ -1196,7 +1381,7 @@ void CPVRMagenta::SetStreamProperties(std::vector<kodi::addon::PVRStreamProperty
   properties.emplace_back("inputstream.adaptive.license_type", "com.widevine.alpha");
 
   std::string lkey = m_licence_url + "|deviceId=" + m_ca_device_id + "|R{SSM}|";
-  kodi::Log(ADDON_LOG_DEBUG, "Licence Key: %s", lkey.c_str());
+  DEBUG_LOG("Licence Key: %s", lkey.c_str());
   properties.emplace_back("inputstream.adaptive.license_key", lkey);
 
 //  properties.emplace_back("inputstream.adaptive.manifest_update_parameter", "full");
@@ -1205,7 +1390,8 @@ void CPVRMagenta::SetStreamProperties(std::vector<kodi::addon::PVRStreamProperty
 
 PVR_ERROR CPVRMagenta::GetCapabilities(kodi::addon::PVRCapabilities& capabilities)
 {
-  kodi::Log(ADDON_LOG_DEBUG, "function call: [%s]", __FUNCTION__);
+  TRACE_SCOPE("magenta", __FUNCTION__);
+  DEBUG_LOG("function call: [%s]", __FUNCTION__);
   if (m_isMagenta2)
     return m_magenta2->GetCapabilities(capabilities);
 
@@ -1235,31 +1421,35 @@ PVR_ERROR CPVRMagenta::GetCapabilities(kodi::addon::PVRCapabilities& capabilitie
 
 PVR_ERROR CPVRMagenta::GetBackendName(std::string& name)
 {
+  TRACE_SCOPE("magenta", __FUNCTION__);
   name = "Magenta PVR";
   return PVR_ERROR_NO_ERROR;
 }
 
 PVR_ERROR CPVRMagenta::GetBackendVersion(std::string& version)
 {
+  TRACE_SCOPE("magenta", __FUNCTION__);
   version = STR(MAGENTA_VERSION);
   return PVR_ERROR_NO_ERROR;
 }
 
 PVR_ERROR CPVRMagenta::GetConnectionString(std::string& connection)
 {
+  TRACE_SCOPE("magenta", __FUNCTION__);
   connection = "connected";
   return PVR_ERROR_NO_ERROR;
 }
 
 PVR_ERROR CPVRMagenta::GetBackendHostname(std::string& hostname)
 {
+  TRACE_SCOPE("magenta", __FUNCTION__);
   hostname = STR(m_epg_https_url);
   return PVR_ERROR_NO_ERROR;
 }
 
 uint64_t CPVRMagenta::GetPVRSpace(const int type)
 {
-  kodi::Log(ADDON_LOG_DEBUG, "function call: [%s]", __FUNCTION__);
+  DEBUG_LOG("function call: [%s]", __FUNCTION__);
   std::string url = m_epg_https_url + "QueryPVRSpace";
   std::string postData = "{\"type\": " + std::to_string(type) + "}";
 
@@ -1267,19 +1457,20 @@ uint64_t CPVRMagenta::GetPVRSpace(const int type)
   if ((!JsonRequest(url, postData, doc)) || (!doc.HasMember("space"))) {
     return 0;
   }
-  kodi::Log(ADDON_LOG_DEBUG, "finished: [%s]", __FUNCTION__);
+  DEBUG_LOG("finished: [%s]", __FUNCTION__);
   return stol(Utils::JsonStringOrEmpty(doc, "space"));
 }
 
 PVR_ERROR CPVRMagenta::GetDriveSpace(uint64_t& total, uint64_t& used)
 {
-  kodi::Log(ADDON_LOG_DEBUG, "function call: [%s]", __FUNCTION__);
+  TRACE_SCOPE("magenta", __FUNCTION__);
+  DEBUG_LOG("function call: [%s]", __FUNCTION__);
   if (m_isMagenta2)
     return m_magenta2->GetDriveSpace(total, used);
 
   total = GetPVRSpace(0) * KBM;
   used = GetPVRSpace(1) * KBM;
-  kodi::Log(ADDON_LOG_DEBUG, "Reported %llu/%llu used/total", used, total);
+  DEBUG_LOG("Reported %llu/%llu used/total", used, total);
   return PVR_ERROR_NO_ERROR;
 }
 
@@ -1311,7 +1502,7 @@ KodiGenre CPVRMagenta::GetKodiGenreFromId(const int& genreId)
 
 bool CPVRMagenta::GetEPGDetails(std::string& contentCode, rapidjson::Document& epgDoc)
 {
-  kodi::Log(ADDON_LOG_DEBUG, "function call: [%s]", __FUNCTION__);
+  DEBUG_LOG("function call: [%s]", __FUNCTION__);
 
   std::string jsonEpg;
   int statusCode = 0;
@@ -1326,7 +1517,7 @@ bool CPVRMagenta::GetEPGDetails(std::string& contentCode, rapidjson::Document& e
                          "\"metaDataVer\": \"Channel/1.1\","
                          "\"playbill\": \"" + contentCode + "\"}";
 
-  std::string url = m_epg_https_url + "ContentDetail?userContentFilter=" + m_userContentFilter;
+  std::string url = m_epg_https_url + "ContentDetail?userContentFilter=" + GetSessionValue(m_userContentFilter);
 
   jsonEpg = m_httpClient->HttpPost(url, postData, statusCode);
 //    kodi::Log(ADDON_LOG_DEBUG, "GetProgramme returned: code: %i %s", statusCode, jsonEpg.c_str());
@@ -1352,7 +1543,7 @@ bool CPVRMagenta::GetEPGDetails(std::string& contentCode, rapidjson::Document& e
 
 bool CPVRMagenta::GetEPGPlaybill(const int& channelId, const time_t& start, const time_t& end, rapidjson::Document& epgDoc)
 {
-  kodi::Log(ADDON_LOG_DEBUG, "function call: [%s]", __FUNCTION__);
+  DEBUG_LOG("function call: [%s]", __FUNCTION__);
 
   std::string startTime = Utils::TimeToString(start);
   std::string endTime = Utils::TimeToString(end);
@@ -1360,8 +1551,8 @@ bool CPVRMagenta::GetEPGPlaybill(const int& channelId, const time_t& start, cons
   std::string jsonEpg;
   int statusCode = 0;
 
-  kodi::Log(ADDON_LOG_DEBUG, "Start %u End %u", start, end);
-  kodi::Log(ADDON_LOG_DEBUG, "EPG Request for channel %i from %s to %s", channelId, startTime.c_str(), endTime.c_str());
+  DEBUG_LOG("Start %u End %u", start, end);
+  DEBUG_LOG("EPG Request for channel %i from %s to %s", channelId, startTime.c_str(), endTime.c_str());
 
   std::string postData = "{\"channelid\": \"" + std::to_string(channelId) + "\"," +
                          "\"type\": 2," +
@@ -1378,7 +1569,7 @@ bool CPVRMagenta::GetEPGPlaybill(const int& channelId, const time_t& start, cons
 
 //    kodi::Log(ADDON_LOG_DEBUG, "PostData %s", postData.c_str());
 
-  std::string url = m_epg_https_url + "PlayBillList?userContentFilter=" + m_userContentFilter;
+  std::string url = m_epg_https_url + "PlayBillList?userContentFilter=" + GetSessionValue(m_userContentFilter);
 
   jsonEpg = m_httpClient->HttpPost(url, postData, statusCode);
 //    kodi::Log(ADDON_LOG_DEBUG, "GetProgramme returned: code: %i %s", statusCode, jsonEpg.c_str());
@@ -1501,7 +1692,7 @@ bool CPVRMagenta::FillEPGTag(const rapidjson::Value& epgItem, kodi::addon::PVREP
           cast += Utils::JsonStringOrEmpty(casts[i], "castName");
           break;
         default:
-          kodi::Log(ADDON_LOG_DEBUG, "Unknown Cast Type: %i CastName: %s", stoi(Utils::JsonStringOrEmpty(casts[i], "roleType")), Utils::JsonStringOrEmpty(casts[i], "castName").c_str());
+          DEBUG_LOG_LIMITED(1, 20, "Unknown Cast Type: %i CastName: %s", stoi(Utils::JsonStringOrEmpty(casts[i], "roleType")), Utils::JsonStringOrEmpty(casts[i], "castName").c_str());
       }
     }
     tag.SetCast(cast);
@@ -1573,7 +1764,8 @@ PVR_ERROR CPVRMagenta::GetEPGForChannel(int channelUid,
                                      time_t end,
                                      kodi::addon::PVREPGTagsResultSet& results)
 {
-  kodi::Log(ADDON_LOG_DEBUG, "function call: [%s]", __FUNCTION__);
+  TRACE_SCOPE("magenta", __FUNCTION__);
+  DEBUG_LOG("function call: [%s]", __FUNCTION__);
 
   if (m_isMagenta2)
     return m_magenta2->GetEPGForChannel(channelUid, start, end, results);
@@ -1596,7 +1788,7 @@ PVR_ERROR CPVRMagenta::GetEPGForChannel(int channelUid,
 	                           "\toDate\": \"20230715215959\"}";
 
   std::string jsonEpg2 = m_httpClient->HttpPost(url2, postData2, statusCode2);
-  kodi::Log(ADDON_LOG_DEBUG, "GetDataVersion returned: code: %i %s", statusCode2, jsonEpg2.c_str());
+  DEBUG_LOG("GetDataVersion returned: code: %i %s", statusCode2, jsonEpg2.c_str());
 */
   rapidjson::Document epgDoc;
 
@@ -1605,7 +1797,7 @@ PVR_ERROR CPVRMagenta::GetEPGForChannel(int channelUid,
 
   const rapidjson::Value& epgitems = epgDoc["playbilllist"];
 
-  kodi::Log(ADDON_LOG_DEBUG, "[epg] iterate entries");
+  DEBUG_LOG("[epg] iterate entries");
   for (rapidjson::SizeType i = 0; i < epgitems.Size(); i++)
 //  for (rapidjson::Value::ConstValueIterator itr1 = epgitems.Begin();
 //        itr1 != epgitems.End(); ++itr1)
@@ -1620,7 +1812,7 @@ PVR_ERROR CPVRMagenta::GetEPGForChannel(int channelUid,
 
 bool CPVRMagenta::UpdateEPGEvent(const kodi::addon::PVREPGTag& oldtag)
 {
-  kodi::Log(ADDON_LOG_DEBUG, "function call: [%s]", __FUNCTION__);
+  DEBUG_LOG("function call: [%s]", __FUNCTION__);
 
   rapidjson::Document epgDoc;
   kodi::addon::PVREPGTag newtag = oldtag;
@@ -1637,7 +1829,7 @@ bool CPVRMagenta::UpdateEPGEvent(const kodi::addon::PVREPGTag& oldtag)
 
     std::string externalContentCode = Utils::JsonStringOrEmpty(epgItem, "externalContentCode");
 
-    kodi::Log(ADDON_LOG_DEBUG, "Content Code: %s", externalContentCode.c_str());
+    DEBUG_LOG("Content Code: %s", externalContentCode.c_str());
 
     rapidjson::Document epgDoc2;
 
@@ -1658,7 +1850,8 @@ bool CPVRMagenta::UpdateEPGEvent(const kodi::addon::PVREPGTag& oldtag)
 
 PVR_ERROR CPVRMagenta::IsEPGTagPlayable(const kodi::addon::PVREPGTag& tag, bool& bIsPlayable)
 {
-  kodi::Log(ADDON_LOG_DEBUG, "function call: [%s]", __FUNCTION__);
+  TRACE_SCOPE("magenta", __FUNCTION__);
+  DEBUG_LOG("function call: [%s]", __FUNCTION__);
 
   if (m_isMagenta2)
     return m_magenta2->IsEPGTagPlayable(tag, bIsPlayable);
@@ -1671,12 +1864,8 @@ PVR_ERROR CPVRMagenta::IsEPGTagPlayable(const kodi::addon::PVREPGTag& tag, bool&
   {
     if (channel.iUniqueId == tag.GetUniqueChannelId())
     {
-      auto current_time = time(NULL);
-      time_t startTime = tag.GetStartTime();
-      if ((current_time > startTime) && (current_time - TIMEBUFFER < startTime))
-      {
-        bIsPlayable = true;
-      }
+      bIsPlayable = m_timeshiftWindow.IsPlayable(channel.iUniqueId, tag.GetStartTime());
+      break;
     }
   }
 
@@ -1685,27 +1874,10 @@ PVR_ERROR CPVRMagenta::IsEPGTagPlayable(const kodi::addon::PVREPGTag& tag, bool&
 
 PVR_ERROR CPVRMagenta::GetEPGTagEdl(const kodi::addon::PVREPGTag& tag, std::vector<kodi::addon::PVREDLEntry>& edl)
 {
-  kodi::Log(ADDON_LOG_DEBUG, "function call: [%s]", __FUNCTION__);
+  TRACE_SCOPE("magenta", __FUNCTION__);
+  DEBUG_LOG("function call: [%s]", __FUNCTION__);
 
-  //cut before
-  uint64_t elapsedTime = (time(NULL) - tag.GetStartTime());
-  uint64_t edBreak = TIMEBUFFER > elapsedTime ? TIMEBUFFER - elapsedTime : 0;
-
-  kodi::addon::PVREDLEntry entry;
-  entry.SetStart(0);
-  entry.SetEnd(edBreak * 1000);
-  entry.SetType(PVR_EDL_TYPE_COMBREAK);
-  edl.emplace_back(entry);
-
-  //cut after
-  if (time(NULL) > tag.GetEndTime()) {
-      elapsedTime = (time(NULL) - tag.GetEndTime());
-      edBreak = TIMEBUFFER > elapsedTime ? TIMEBUFFER - elapsedTime : TIMEBUFFER;
-      entry.SetStart(edBreak * 1000);
-      entry.SetEnd(TIMEBUFFER * 1000);
-      entry.SetType(PVR_EDL_TYPE_COMBREAK);
-      edl.emplace_back(entry);
-  }
+  m_timeshiftWindow.GetEdl(tag.GetUniqueChannelId(), tag.GetStartTime(), tag.GetEndTime(), edl);
 
   return PVR_ERROR_NO_ERROR;
 }
@@ -1715,26 +1887,16 @@ bool CPVRMagenta::ReleaseCurrentMedia()
   if ((m_currentMediaId == -1) || (m_currentChannelId == -1))
     return true;
 
-  std::string url = m_epg_https_url + "ReleasePlaySession";
-  std::string postData = "{\"mediaId\": \"" + std::to_string(m_currentMediaId) + "\","
-                           "\"contentId\": \"" + std::to_string(m_currentChannelId) + "\","
-                           "\"contentType\": \"VIDEO_CHANNEL\"}";
-
-  rapidjson::Document doc;
-  if (!JsonRequest(url, postData, doc)) {
-    return false;
-  }
+  m_sessionManager.Release(m_currentChannelId, m_currentMediaId);
   return true;
 }
 
 std::string CPVRMagenta::GetPlay(const int& chanId, const int& mediaId, const bool isTimeshift)
 {
-  kodi::Log(ADDON_LOG_DEBUG, "function call: [%s]", __FUNCTION__);
-
-  ReleaseCurrentMedia();
+  DEBUG_LOG("function call: [%s]", __FUNCTION__);
 
-  std::string checksum = hmac<SHA256>(std::to_string(chanId), m_session_key);
-  kodi::Log(ADDON_LOG_DEBUG, "Checksum: %s", checksum.c_str());
+  std::string checksum = hmac<SHA256>(std::to_string(chanId), GetSessionValue(m_session_key));
+  DEBUG_LOG("Checksum: %s", checksum.c_str());
 
   int statusCode = 0;
   std::string url = m_epg_https_url + "Play";
@@ -1757,7 +1919,7 @@ std::string CPVRMagenta::GetPlay(const int& chanId, const int& mediaId, const bo
   if (Utils::JsonStringOrEmpty(doc, "retcode") != "0") {
     if (Utils::JsonStringOrEmpty(doc, "retcode") == "-2") {
       MagentaAuthenticate();
-      checksum = hmac<SHA256>(std::to_string(chanId), m_session_key);
+      checksum = hmac<SHA256>(std::to_string(chanId), GetSessionValue(m_session_key));
       std::string postData = "{\"contentid\": \"" + std::to_string(chanId) + "\","
                               "\"mediaid\": \"" + std::to_string(mediaId) + "\","
                               "\"playtype\": 2,"
@@ -1784,25 +1946,33 @@ std::string CPVRMagenta::GetPlay(const int& chanId, const int& mediaId, const bo
     kodi::Log(ADDON_LOG_ERROR, "Play url was empty");
     return "";
   }
-  kodi::Log(ADDON_LOG_DEBUG, "[PLAY url: %s", playUrl.c_str());
+  DEBUG_LOG("[PLAY url: %s", playUrl.c_str());
   std::vector<std::string> out;
   tokenize(playUrl, "|", out);
   std::string spliturl = out[isTimeshift ? 1 : 0];
 /*
   for (auto &s: out) {
-    kodi::Log(ADDON_LOG_DEBUG, "[PLAY Timeshifted] url: %s", s.c_str());
+    DEBUG_LOG("[PLAY Timeshifted] url: %s", s.c_str());
   }
 */
-  std::string appendix = "&uid=" + m_userID + "&sid=" + m_sessionID + "&i=" + (isTimeshift ? "0" : "4") + "&dp=0";
+  std::string appendix = "&uid=" + GetSessionValue(m_userID) + "&sid=" + GetSessionValue(m_sessionID) + "&i=" + (isTimeshift ? "0" : "4") + "&dp=0";
   spliturl += appendix;
 
+  // the new session is up, the old one is given back without delaying playback
+  if ((m_currentChannelId != chanId) || (m_currentMediaId != mediaId))
+    ReleaseCurrentMedia();
+  std::string heartbitInterval = Utils::JsonStringOrEmpty(doc, "nextcallinterval");
+  m_sessionManager.Start(m_epg_https_url, chanId, mediaId, "VIDEO_CHANNEL",
+                         heartbitInterval.empty() ? 0 : atoi(heartbitInterval.c_str()));
+
   return spliturl;
 }
 
 PVR_ERROR CPVRMagenta::GetEPGTagStreamProperties(
     const kodi::addon::PVREPGTag& tag, std::vector<kodi::addon::PVRStreamProperty>& properties)
 {
-  kodi::Log(ADDON_LOG_DEBUG, "function call: [%s]", __FUNCTION__);
+  TRACE_SCOPE("magenta", __FUNCTION__);
+  DEBUG_LOG("function call: [%s]", __FUNCTION__);
   if (m_isMagenta2)
     return m_magenta2->GetEPGTagStreamProperties(tag, properties);
 
@@ -1812,7 +1982,11 @@ PVR_ERROR CPVRMagenta::GetEPGTagStreamProperties(
     {
 
       int chanId = channel.iUniqueId;
-      int mediaId = SelectMediaId(channel, false);
+      int mediaId;
+      {
+        std::lock_guard<std::mutex> lock(m_mediaSelectionMutex);
+        mediaId = channel.liveMediaId;
+      }
 
       std::string playurl = GetPlay(chanId, mediaId, true);
       if (playurl.empty())
@@ -1820,7 +1994,7 @@ PVR_ERROR CPVRMagenta::GetEPGTagStreamProperties(
 
       m_currentMediaId = mediaId;
       m_currentChannelId = chanId;
-      kodi::Log(ADDON_LOG_DEBUG, "[PLAY Timeshifted] url: %s", playurl.c_str());
+      DEBUG_LOG("[PLAY Timeshifted] url: %s", playurl.c_str());
       SetStreamProperties(properties, playurl, false, true, false);
     }
   }
@@ -1830,29 +2004,33 @@ PVR_ERROR CPVRMagenta::GetEPGTagStreamProperties(
 
 PVR_ERROR CPVRMagenta::GetProvidersAmount(int& amount)
 {
+  TRACE_SCOPE("magenta", __FUNCTION__);
   return PVR_ERROR_NO_ERROR;
 }
 
 PVR_ERROR CPVRMagenta::GetProviders(kodi::addon::PVRProvidersResultSet& results)
 {
+  TRACE_SCOPE("magenta", __FUNCTION__);
   return PVR_ERROR_NO_ERROR;
 }
 
 PVR_ERROR CPVRMagenta::GetChannelsAmount(int& amount)
 {
-  kodi::Log(ADDON_LOG_DEBUG, "function call: [%s]", __FUNCTION__);
+  TRACE_SCOPE("magenta", __FUNCTION__);
+  DEBUG_LOG("function call: [%s]", __FUNCTION__);
   if (m_isMagenta2)
     return m_magenta2->GetChannelsAmount(amount);
 
   amount = m_channels.size();
   std::string amount_str = std::to_string(amount);
-  kodi::Log(ADDON_LOG_DEBUG, "Channels Amount: [%s]", amount_str.c_str());
+  DEBUG_LOG("Channels Amount: [%s]", amount_str.c_str());
   return PVR_ERROR_NO_ERROR;
 }
 
 PVR_ERROR CPVRMagenta::GetChannels(bool bRadio, kodi::addon::PVRChannelsResultSet& results)
 {
-  kodi::Log(ADDON_LOG_DEBUG, "function call: [%s]", __FUNCTION__);
+  TRACE_SCOPE("magenta", __FUNCTION__);
+  DEBUG_LOG("function call: [%s]", __FUNCTION__);
   if (m_isMagenta2)
     return m_magenta2->GetChannels(bRadio, results);
 
@@ -1881,40 +2059,73 @@ PVR_ERROR CPVRMagenta::GetChannels(bool bRadio, kodi::addon::PVRChannelsResultSe
 PVR_ERROR CPVRMagenta::GetChannelStreamProperties(
     const kodi::addon::PVRChannel& channel, std::vector<kodi::addon::PVRStreamProperty>& properties)
 {
-  kodi::Log(ADDON_LOG_DEBUG, "function call: [%s]", __FUNCTION__);
+  TRACE_SCOPE("magenta", __FUNCTION__);
+  DEBUG_LOG("function call: [%s]", __FUNCTION__);
   if (m_isMagenta2)
     return m_magenta2->GetChannelStreamProperties(channel, properties);
 
-  MagentaChannel addonChannel;
-  if (!GetChannel(channel.GetUniqueId(), addonChannel))
+  const MagentaChannel* addonChannel = GetChannel(channel.GetUniqueId());
+  if (!addonChannel)
     return PVR_ERROR_FAILED;
 
-  m_currentMediaId = SelectMediaId(addonChannel, false);
-  m_currentChannelId = addonChannel.iUniqueId;
-  std::string streamUrl = GetPlayUrl(addonChannel, m_currentMediaId);
-
-  kodi::Log(ADDON_LOG_DEBUG, "Stream URL -> %s", streamUrl.c_str());
-  kodi::Log(ADDON_LOG_DEBUG, "ReferenceID -> %i", m_currentChannelId);
+  // the live url needs no Play, the channel is only tracked so it is released once playback moves on
+  int mediaId;
+  std::string streamUrl;
+  {
+    std::lock_guard<std::mutex> lock(m_mediaSelectionMutex);
+    mediaId = addonChannel->liveMediaId;
+    streamUrl = addonChannel->livePlayUrl;
+  }
+  if ((m_currentChannelId != addonChannel->iUniqueId) || (m_currentMediaId != mediaId))
+    ReleaseCurrentMedia();
+  m_currentMediaId = mediaId;
+  m_currentChannelId = addonChannel->iUniqueId;
+  m_sessionManager.Start(m_epg_https_url, m_currentChannelId, m_currentMediaId, "VIDEO_CHANNEL", 0);
+
+  DEBUG_LOG("Stream URL -> %s", streamUrl.c_str());
+  DEBUG_LOG("ReferenceID -> %i", m_currentChannelId);
   SetStreamProperties(properties, streamUrl, true, false, false);
   return PVR_ERROR_NO_ERROR;
 }
 
+void CPVRMagenta::CloseLiveStream()
+{
+  TRACE_SCOPE("magenta", __FUNCTION__);
+  DEBUG_LOG("function call: [%s]", __FUNCTION__);
+  if (m_isMagenta2)
+    m_magenta2->CloseStream();
+  else
+    ReleaseCurrentMedia();
+}
+
+void CPVRMagenta::CloseRecordedStream()
+{
+  TRACE_SCOPE("magenta", __FUNCTION__);
+  DEBUG_LOG("function call: [%s]", __FUNCTION__);
+  if (m_isMagenta2)
+    m_magenta2->CloseStream();
+  else
+    ReleaseCurrentMedia();
+}
+
 PVR_ERROR CPVRMagenta::GetChannelGroupsAmount(int& amount)
 {
-  kodi::Log(ADDON_LOG_DEBUG, "function call: [%s]", __FUNCTION__);
+  TRACE_SCOPE("magenta", __FUNCTION__);
+  DEBUG_LOG("function call: [%s]", __FUNCTION__);
   if (m_isMagenta2)
     return m_magenta2->GetChannelGroupsAmount(amount);
 
   amount = static_cast<int>(m_categories.size());
   std::string amount_str = std::to_string(amount);
-  kodi::Log(ADDON_LOG_DEBUG, "Groups Amount: [%s]", amount_str.c_str());
+  DEBUG_LOG("Groups Amount: [%s]", amount_str.c_str());
 
   return PVR_ERROR_NO_ERROR;
 }
 
 PVR_ERROR CPVRMagenta::GetChannelGroups(bool bRadio, kodi::addon::PVRChannelGroupsResultSet& results)
 {
-  kodi::Log(ADDON_LOG_DEBUG, "function call: [%s]", __FUNCTION__);
+  TRACE_SCOPE("magenta", __FUNCTION__);
+  DEBUG_LOG("function call: [%s]", __FUNCTION__);
   if (m_isMagenta2)
     return m_magenta2->GetChannelGroups(bRadio, results);
 
@@ -1929,7 +2140,7 @@ PVR_ERROR CPVRMagenta::GetChannelGroups(bool bRadio, kodi::addon::PVRChannelGrou
       kodiGroup.SetGroupName(it->name);
 
       results.Add(kodiGroup);
-      kodi::Log(ADDON_LOG_DEBUG, "Group added: %s at position %u", it->name.c_str(), it->position);
+      DEBUG_LOG("Group added: %s at position %u", it->name.c_str(), it->position);
     }
   }
   return PVR_ERROR_NO_ERROR;
@@ -1938,7 +2149,8 @@ PVR_ERROR CPVRMagenta::GetChannelGroups(bool bRadio, kodi::addon::PVRChannelGrou
 PVR_ERROR CPVRMagenta::GetChannelGroupMembers(const kodi::addon::PVRChannelGroup& group,
                                            kodi::addon::PVRChannelGroupMembersResultSet& results)
 {
-  kodi::Log(ADDON_LOG_DEBUG, "function call: [%s]", __FUNCTION__);
+  TRACE_SCOPE("magenta", __FUNCTION__);
+  DEBUG_LOG("function call: [%s]", __FUNCTION__);
   if (m_isMagenta2)
     return m_magenta2->GetChannelGroupMembers(group, results);
 
@@ -1986,14 +2198,16 @@ int CPVRMagenta::GetGroupRecordingsAmount()
 
 PVR_ERROR CPVRMagenta::GetRecordingsAmount(bool deleted, int& amount)
 {
-  kodi::Log(ADDON_LOG_DEBUG, "function call: [%s]", __FUNCTION__);
+  TRACE_SCOPE("magenta", __FUNCTION__);
+  DEBUG_LOG("function call: [%s]", __FUNCTION__);
   if (m_isMagenta2)
     return m_magenta2->GetRecordingsAmount(deleted, amount);
+  m_startup.Wait("recordings");
 
   amount = static_cast<int>(m_recordings.size());
   amount += GetGroupRecordingsAmount();
   std::string amount_str = std::to_string(amount);
-  kodi::Log(ADDON_LOG_DEBUG, "Recordings Amount: [%s]", amount_str.c_str());
+  DEBUG_LOG("Recordings Amount: [%s]", amount_str.c_str());
 
   return PVR_ERROR_NO_ERROR;
 }
@@ -2023,7 +2237,14 @@ void CPVRMagenta::FillPVRRecording(kodi::addon::PVRRecording& kodiRecording, con
   if (rec.realRecordLength != 0) {
     kodiRecording.SetDuration(rec.realRecordLength);
   }
-  kodiRecording.SetLastPlayedPosition(rec.bookmarkTime);
+  int bookmarkTime = rec.bookmarkTime;
+  {
+    std::lock_guard<std::mutex> lock(m_bookmarkMutex);
+    auto it = m_bookmarks.find(rec.pvrId);
+    if (it != m_bookmarks.end())
+      bookmarkTime = it->second;
+  }
+  kodiRecording.SetLastPlayedPosition(bookmarkTime);
   kodiRecording.SetRecordingTime(Utils::StringToTime(PrepareTime(rec.beginTime)));
   KodiGenre myGenre = GetKodiGenreFromId(rec.genres[0]);
   if (myGenre.genreType != 0) {
@@ -2048,11 +2269,14 @@ void CPVRMagenta::FillPVRRecording(kodi::addon::PVRRecording& kodiRecording, con
 
 PVR_ERROR CPVRMagenta::GetRecordings(bool deleted, kodi::addon::PVRRecordingsResultSet& results)
 {
-  kodi::Log(ADDON_LOG_DEBUG, "function call: [%s]", __FUNCTION__);
+  TRACE_SCOPE("magenta", __FUNCTION__);
+  DEBUG_LOG("function call: [%s]", __FUNCTION__);
   if (m_isMagenta2)
     return m_magenta2->GetRecordings(deleted, results);
+  m_startup.Wait("recordings");
 
-  if (!GetTimersRecordings(true)) {
+  MagentaSyncResult syncResult;
+  if (!SyncTimersRecordings(true, syncResult)) {
     kodi::Log(ADDON_LOG_ERROR, "Failed to get recordings from backend");
     return PVR_ERROR_SERVER_ERROR;
   }
@@ -2066,7 +2290,7 @@ PVR_ERROR CPVRMagenta::GetRecordings(bool deleted, kodi::addon::PVRRecordingsRes
       kodiRecording.SetDirectory(current_recording.periodPVRTaskName);
 
     results.Add(kodiRecording);
-    kodi::Log(ADDON_LOG_DEBUG, "Recording added: %s", current_recording.pvrName.c_str());
+    DEBUG_LOG("Recording added: %s", current_recording.pvrName.c_str());
   }
 
   for (const auto& current_group : m_recGroups)
@@ -2079,7 +2303,7 @@ PVR_ERROR CPVRMagenta::GetRecordings(bool deleted, kodi::addon::PVRRecordingsRes
       kodiRecording.SetDirectory(current_group.periodPVRTaskName);
 
       results.Add(kodiRecording);
-      kodi::Log(ADDON_LOG_DEBUG, "Recording added: %s from group", current_recording.pvrName.c_str(), current_group.periodPVRTaskName.c_str());
+      DEBUG_LOG("Recording added: %s from group", current_recording.pvrName.c_str(), current_group.periodPVRTaskName.c_str());
     }
   }
 
@@ -2090,9 +2314,11 @@ PVR_ERROR CPVRMagenta::GetRecordingStreamProperties(
     const kodi::addon::PVRRecording& recording,
     std::vector<kodi::addon::PVRStreamProperty>& properties)
 {
-  kodi::Log(ADDON_LOG_DEBUG, "function call: [%s]", __FUNCTION__);
+  TRACE_SCOPE("magenta", __FUNCTION__);
+  DEBUG_LOG("function call: [%s]", __FUNCTION__);
   if (m_isMagenta2)
     return m_magenta2->GetRecordingStreamProperties(recording, properties);
+  m_startup.Wait("recordings");
 
   for (const auto& current_recording : m_recordings)
   {
@@ -2103,8 +2329,8 @@ PVR_ERROR CPVRMagenta::GetRecordingStreamProperties(
       return PVR_ERROR_FAILED;
     }
 */
-    std::string checksum = hmac<SHA256>(std::to_string(current_recording.channelId), m_session_key);
-    kodi::Log(ADDON_LOG_DEBUG, "Checksum: %s", checksum.c_str());
+    std::string checksum = hmac<SHA256>(std::to_string(current_recording.channelId), GetSessionValue(m_session_key));
+    DEBUG_LOG("Checksum: %s", checksum.c_str());
 
     int statusCode = 0;
     std::string url = m_epg_https_url + "AuthorizeAndPlay";
@@ -2126,7 +2352,7 @@ PVR_ERROR CPVRMagenta::GetRecordingStreamProperties(
     if (Utils::JsonStringOrEmpty(doc, "retcode") != "0") {
       if (Utils::JsonStringOrEmpty(doc, "retcode") == "-2") {
         MagentaAuthenticate();
-        checksum = hmac<SHA256>(std::to_string(current_recording.channelId), m_session_key);
+        checksum = hmac<SHA256>(std::to_string(current_recording.channelId), GetSessionValue(m_session_key));
         std::string postData = "{\"contentType\": \"CHANNEL\","
                                 "\"businessType\": 8,"
                                 "\"contentId\": \"" + std::to_string(current_recording.channelId) + "\","
@@ -2153,7 +2379,7 @@ PVR_ERROR CPVRMagenta::GetRecordingStreamProperties(
       kodi::Log(ADDON_LOG_ERROR, "Recording playUrl was empty");
       return PVR_ERROR_SERVER_ERROR;
     }
-    kodi::Log(ADDON_LOG_DEBUG, "[PLAY RECORDING] url: %s", playUrl.c_str());
+    DEBUG_LOG("[PLAY RECORDING] url: %s", playUrl.c_str());
 
     SetStreamProperties(properties, playUrl, false, false, false);
   }
@@ -2162,7 +2388,8 @@ PVR_ERROR CPVRMagenta::GetRecordingStreamProperties(
 
 PVR_ERROR CPVRMagenta::DeletePVR(const std::string pvrId, const bool isRecording)
 {
-  kodi::Log(ADDON_LOG_DEBUG, "Request to delete ID: [%s]", pvrId.c_str());
+  TRACE_SCOPE("magenta", __FUNCTION__);
+  DEBUG_LOG("Request to delete ID: [%s]", pvrId.c_str());
   std::string url = m_epg_https_url + "DeletePVR";
   std::string postData = "{\"pvrId\": \"" + pvrId + "\"}";
 
@@ -2171,6 +2398,7 @@ PVR_ERROR CPVRMagenta::DeletePVR(const std::string pvrId, const bool isRecording
     return PVR_ERROR_FAILED;
   }
   else {
+    InvalidateTimersRecordings();
     if (isRecording) {
       kodi::QueueNotification(QUEUE_INFO, "Aufnahme", "Aufnahme gelöscht");
       kodi::addon::CInstancePVRClient::TriggerRecordingUpdate();
@@ -2184,7 +2412,9 @@ PVR_ERROR CPVRMagenta::DeletePVR(const std::string pvrId, const bool isRecording
 
 PVR_ERROR CPVRMagenta::DeleteRecording(const kodi::addon::PVRRecording& recording)
 {
-  kodi::Log(ADDON_LOG_DEBUG, "function call: [%s]", __FUNCTION__);
+  TRACE_SCOPE("magenta", __FUNCTION__);
+  DEBUG_LOG("function call: [%s]", __FUNCTION__);
+  m_startup.Wait("recordings");
   return DeletePVR(recording.GetRecordingId(), true);
 }
 
@@ -2216,7 +2446,7 @@ struct TimerType : kodi::addon::PVRTimerType
 
 bool CPVRMagenta::UpdateBookmarks()
 {
-  kodi::Log(ADDON_LOG_DEBUG, "function call: [%s]", __FUNCTION__);
+  DEBUG_LOG("function call: [%s]", __FUNCTION__);
 
   std::string url = m_epg_https_url + "QueryBookmark";
   std::string postData = "{\"bookmarkType\": " + std::to_string(MAGENTA_BOOKMARK_RECORDING) + ","
@@ -2226,52 +2456,107 @@ bool CPVRMagenta::UpdateBookmarks()
   if (!JsonRequest(url, postData, doc) || !doc.HasMember("bookmarkList")) {
     return false;
   }
-  else {
-    const rapidjson::Value& bookmarkList = doc["bookmarkList"];
 
-    for (rapidjson::Value::ConstValueIterator itr2 = bookmarkList.Begin();
-        itr2 != bookmarkList.End(); ++itr2)
-    {
-      const rapidjson::Value& bookmarkItem = (*itr2);
+  std::lock_guard<std::mutex> lock(m_bookmarkMutex);
+  m_bookmarks.clear();
+  const rapidjson::Value& bookmarkList = doc["bookmarkList"];
+  for (rapidjson::Value::ConstValueIterator itr2 = bookmarkList.Begin();
+      itr2 != bookmarkList.End(); ++itr2)
+  {
+    const rapidjson::Value& bookmarkItem = (*itr2);
+    std::string rangeTime = Utils::JsonStringOrEmpty(bookmarkItem, "rangeTime");
+    if (!rangeTime.empty())
+      m_bookmarks[Utils::JsonStringOrEmpty(bookmarkItem, "contentId")] = stoi(rangeTime);
+  }
+  // positions not yet written to the backend are newer than what it returned
+  for (const auto& pending : m_pendingBookmarks)
+    m_bookmarks[pending.first] = pending.second;
 
-      for (auto& recording : m_recordings)
-      {
-        if ( Utils::JsonStringOrEmpty(bookmarkItem, "contentId") == recording.pvrId)
-        {
-          recording.bookmarkTime = stoi(Utils::JsonStringOrEmpty(bookmarkItem, "rangeTime"));
-          kodi::Log(ADDON_LOG_DEBUG, "Updating position %i for Recording ID: %s", recording.bookmarkTime, recording.pvrId.c_str());
-        }
-      }
-    }
+  for (auto& recording : m_recordings)
+  {
+    auto it = m_bookmarks.find(recording.pvrId);
+    if (it != m_bookmarks.end())
+      recording.bookmarkTime = it->second;
   }
+  DEBUG_LOG("Loaded %i bookmarks", static_cast<int>(m_bookmarks.size()));
   return true;
 }
 
-PVR_ERROR CPVRMagenta::SetRecordingLastPlayedPosition(const kodi::addon::PVRRecording& recording,
-    int lastplayedposition)
+void CPVRMagenta::FlushBookmarks()
 {
-  kodi::Log(ADDON_LOG_DEBUG, "function call: [%s]", __FUNCTION__);
-  kodi::Log(ADDON_LOG_DEBUG, "Setting position %i for Recording ID: %s", lastplayedposition, recording.GetRecordingId().c_str());
+  std::unordered_map<std::string, int> pending;
+  {
+    std::lock_guard<std::mutex> lock(m_bookmarkMutex);
+    pending.swap(m_pendingBookmarks);
+  }
+  if (pending.empty())
+    return;
 
+  std::string bookmarkList;
+  for (const auto& bookmark : pending)
+  {
+    if (!bookmarkList.empty())
+      bookmarkList += ",";
+    bookmarkList += "{\"contentId\": \"" + bookmark.first + "\","
+                     "\"bookmarkType\": " + std::to_string(MAGENTA_BOOKMARK_RECORDING) + ","
+                     "\"rangeTime\": " + std::to_string(bookmark.second) + "}";
+  }
   std::string url = m_epg_https_url + "AddBookmark";
-  std::string postData = "{\"bookmarkList\": [{"
-  		                    "\"contentId\": \"" + recording.GetRecordingId() + "\","
-  		                    "\"bookmarkType\": " + std::to_string(MAGENTA_BOOKMARK_RECORDING) + ","
-  		                    "\"rangeTime\": " + std::to_string(lastplayedposition) + "}]}";
+  std::string postData = "{\"bookmarkList\": [" + bookmarkList + "]}";
 
   rapidjson::Document doc;
   if (!JsonRequest(url, postData, doc)) {
-    return PVR_ERROR_FAILED;
+    kodi::Log(ADDON_LOG_ERROR, "Failed to write %i bookmarks, retrying", static_cast<int>(pending.size()));
+    {
+      std::lock_guard<std::mutex> lock(m_bookmarkMutex);
+      if (m_pendingBookmarks.empty())
+        m_pendingBookmarksSince = std::chrono::steady_clock::now();
+      // positions set while we were writing are newer, insert keeps them
+      for (const auto& bookmark : pending)
+        m_pendingBookmarks.insert(bookmark);
+    }
+    m_taskQueue.Schedule("bookmarks", BOOKMARK_FLUSH_MAX_DELAY, [this]() { FlushBookmarks(); });
+    return;
   }
-  UpdateBookmarks();
+  DEBUG_LOG("Wrote %i bookmarks", static_cast<int>(pending.size()));
+}
+
+PVR_ERROR CPVRMagenta::SetRecordingLastPlayedPosition(const kodi::addon::PVRRecording& recording,
+    int lastplayedposition)
+{
+  TRACE_SCOPE("magenta", __FUNCTION__);
+  DEBUG_LOG("function call: [%s]", __FUNCTION__);
+  DEBUG_LOG("Setting position %i for Recording ID: %s", lastplayedposition, recording.GetRecordingId().c_str());
+  m_startup.Wait("recordings");
+
+  int delay = BOOKMARK_FLUSH_DELAY;
+  {
+    std::lock_guard<std::mutex> lock(m_bookmarkMutex);
+    auto now = std::chrono::steady_clock::now();
+    if (m_pendingBookmarks.empty())
+      m_pendingBookmarksSince = now;
+    m_bookmarks[recording.GetRecordingId()] = lastplayedposition;
+    m_pendingBookmarks[recording.GetRecordingId()] = lastplayedposition;
+    // seeking fires many updates, only the last one within the delay gets written,
+    // but no later than BOOKMARK_FLUSH_MAX_DELAY after the first unwritten one
+    int waited = static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(now - m_pendingBookmarksSince).count());
+    delay = std::max(0, std::min(delay, BOOKMARK_FLUSH_MAX_DELAY - waited));
+  }
+  for (auto& thisRecording : m_recordings)
+  {
+    if (thisRecording.pvrId == recording.GetRecordingId())
+      thisRecording.bookmarkTime = lastplayedposition;
+  }
+  m_taskQueue.Schedule("bookmarks", delay, [this]() { FlushBookmarks(); });
 
   return PVR_ERROR_NO_ERROR;
 }
 
 PVR_ERROR CPVRMagenta::GetRecordingLastPlayedPosition(const kodi::addon::PVRRecording& recording, int& position)
 {
+  TRACE_SCOPE("magenta", __FUNCTION__);
   position = recording.GetLastPlayedPosition();
-  kodi::Log(ADDON_LOG_DEBUG, "Returning position %i for Recording ID: %s", position, recording.GetRecordingId().c_str());
+  DEBUG_LOG("Returning position %i for Recording ID: %s", position, recording.GetRecordingId().c_str());
 
   return PVR_ERROR_NO_ERROR;
 }
@@ -2295,7 +2580,10 @@ void CPVRMagenta::GetLifetimeValues(std::vector<kodi::addon::PVRTypeIntValue>& l
 
 PVR_ERROR CPVRMagenta::GetTimerTypes(std::vector<kodi::addon::PVRTimerType>& types)
 {
-  kodi::Log(ADDON_LOG_DEBUG, "function call: [%s]", __FUNCTION__);
+  TRACE_SCOPE("magenta", __FUNCTION__);
+  DEBUG_LOG("function call: [%s]", __FUNCTION__);
+  if (m_isMagenta2)
+    return m_magenta2->GetTimerTypes(types);
 
   /* PVR_Timer.iLifetime values and presentation.*/
   std::vector<kodi::addon::PVRTypeIntValue> lifetimeValues;
@@ -2353,21 +2641,35 @@ PVR_ERROR CPVRMagenta::GetTimerTypes(std::vector<kodi::addon::PVRTimerType>& typ
 
 PVR_ERROR CPVRMagenta::GetTimersAmount(int& amount)
 {
-  kodi::Log(ADDON_LOG_DEBUG, "function call: [%s]", __FUNCTION__);
+  TRACE_SCOPE("magenta", __FUNCTION__);
+  DEBUG_LOG("function call: [%s]", __FUNCTION__);
+  if (m_isMagenta2)
+    return m_magenta2->GetTimersAmount(amount);
+  m_startup.Wait("recordings");
   amount = static_cast<int>(m_timers.size());
   amount += GetGroupTimersAmount();
   std::string amount_str = std::to_string(amount);
-  kodi::Log(ADDON_LOG_DEBUG, "Timers Amount: [%s]", amount_str.c_str());
+  DEBUG_LOG("Timers Amount: [%s]", amount_str.c_str());
   return PVR_ERROR_NO_ERROR;
 }
 
 PVR_ERROR CPVRMagenta::GetTimers(kodi::addon::PVRTimersResultSet& results)
 {
-  kodi::Log(ADDON_LOG_DEBUG, "function call: [%s]", __FUNCTION__);
-  if (!GetTimersRecordings(false)) {
+  TRACE_SCOPE("magenta", __FUNCTION__);
+  DEBUG_LOG("function call: [%s]", __FUNCTION__);
+  if (m_isMagenta2)
+    return m_magenta2->GetTimers(results);
+  m_startup.Wait("recordings");
+  MagentaSyncResult syncResult;
+  if (!SyncTimersRecordings(false, syncResult)) {
     kodi::Log(ADDON_LOG_ERROR, "Failed to get timers from backend");
     return PVR_ERROR_SERVER_ERROR;
   }
+  if (syncResult.removed > 0) {
+    // finished or started timers show up as recordings
+    m_recordingSync.isValid = false;
+    kodi::addon::CInstancePVRClient::TriggerRecordingUpdate();
+  }
 
   for (const auto& timerGroup : m_timerGroups)
   {
@@ -2399,7 +2701,7 @@ PVR_ERROR CPVRMagenta::GetTimers(kodi::addon::PVRTimersResultSet& results)
 
     results.Add(tagGroup);
 
-    kodi::Log(ADDON_LOG_DEBUG, "Timer Group added: %s for seriesId: %i with index: %i", timerGroup.periodPVRTaskName.c_str(), timerGroup.seriesId, timerGroup.index);
+    DEBUG_LOG("Timer Group added: %s for seriesId: %i with index: %i", timerGroup.periodPVRTaskName.c_str(), timerGroup.seriesId, timerGroup.index);
   }
   std::vector<MagentaRecording>::iterator it;
   for (it = m_timers.begin(); it != m_timers.end(); ++it)
@@ -2432,7 +2734,7 @@ PVR_ERROR CPVRMagenta::GetTimers(kodi::addon::PVRTimersResultSet& results)
 //    kodiTimer.SetChannelType(PVR_RECORDING_CHANNEL_TYPE_TV);
 
     results.Add(kodiTimer);
-    kodi::Log(ADDON_LOG_DEBUG, "Timer added: %s, ProgramID; %s", it->pvrName.c_str(), it->programId.c_str());
+    DEBUG_LOG("Timer added: %s, ProgramID; %s", it->pvrName.c_str(), it->programId.c_str());
   }
 
   return PVR_ERROR_NO_ERROR;
@@ -2449,13 +2751,18 @@ std::string CPVRMagenta::GetPeriodPVRPayload(const MagentaChannel& channel, cons
     latestSeriesNum = 10;
     deleteMode = 2;
   }
+  int npvrMediaId;
+  {
+    std::lock_guard<std::mutex> lock(m_mediaSelectionMutex);
+    npvrMediaId = channel.npvrMediaId;
+  }
 
   payload = "{\"action\": \"";
   payload += (isUpdate) ? "UPDATE" : "ADD";
   payload += "\",\"conflictCheckType\": 1,"
                 "\"strategyType\": 0,"
                 "\"task\": {"
-                            "\"mediaId\": \"" + std::to_string(SelectMediaId(channel, true)) + "\","
+                            "\"mediaId\": \"" + std::to_string(npvrMediaId) + "\","
                             "\"beginOffset\": " + std::to_string(timer.GetMarginStart()) + ","
                             "\"deleteMode\": " + std::to_string(deleteMode) + ","
                             "\"endOffset\": " + std::to_string(timer.GetMarginEnd()) + ","
@@ -2484,20 +2791,30 @@ std::string CPVRMagenta::GetPeriodPVRPayload(const MagentaChannel& channel, cons
 
 PVR_ERROR CPVRMagenta::AddTimer(const kodi::addon::PVRTimer& timer)
 {
-  kodi::Log(ADDON_LOG_DEBUG, "function call: [%s]", __FUNCTION__);
+  TRACE_SCOPE("magenta", __FUNCTION__);
+  DEBUG_LOG("function call: [%s]", __FUNCTION__);
+  if (m_isMagenta2)
+    return PVR_ERROR_NOT_IMPLEMENTED;
+  m_startup.Wait("recordings");
+
 
   std::string url;
   std::string postData;
   rapidjson::Document doc;
 
-  MagentaChannel addonChannel;
-  if (!GetChannel(timer.GetClientChannelUid(), addonChannel))
+  const MagentaChannel* addonChannel = GetChannel(timer.GetClientChannelUid());
+  if (!addonChannel)
     return PVR_ERROR_FAILED;
+  int npvrMediaId;
+  {
+    std::lock_guard<std::mutex> lock(m_mediaSelectionMutex);
+    npvrMediaId = addonChannel->npvrMediaId;
+  }
 
   switch (timer.GetTimerType()) {
     case TIMER_ONCE_EPG:
       url = m_epg_https_url + "AddPVR";
-      postData = "{\"mediaId\": \"" + std::to_string(SelectMediaId(addonChannel, true)) + "\","
+      postData = "{\"mediaId\": \"" + std::to_string(npvrMediaId) + "\","
                   "\"beginOffset\": " + std::to_string(timer.GetMarginStart()) + ","
                   "\"deleteMode\": " + std::to_string(m_settings->GetDeleteMode()) + ","
                   "\"endOffset\": " + std::to_string(timer.GetMarginEnd()) + ","
@@ -2509,29 +2826,30 @@ PVR_ERROR CPVRMagenta::AddTimer(const kodi::addon::PVRTimer& timer)
         return PVR_ERROR_SERVER_ERROR;
       }
       else {
-        kodi::Log(ADDON_LOG_DEBUG, "Added single timer for PVRID: %s", Utils::JsonStringOrEmpty(doc, "pvrId").c_str());
+        DEBUG_LOG("Added single timer for PVRID: %s", Utils::JsonStringOrEmpty(doc, "pvrId").c_str());
         kodi::QueueNotification(QUEUE_INFO, "Aufnahme", "Einzelaufnahme programmiert");
       }
       break;
     case TIMER_SERIES_EPG:
-      kodi::Log(ADDON_LOG_DEBUG, "Add Series Timer");
+      DEBUG_LOG("Add Series Timer");
 
       url = m_epg_https_url + "PeriodPVRMgmt";
-      postData = GetPeriodPVRPayload(addonChannel, timer, "", false);
+      postData = GetPeriodPVRPayload(*addonChannel, timer, "", false);
 
       if (!JsonRequest(url, postData, doc)) {
         return PVR_ERROR_SERVER_ERROR;
       }
       else {
-        kodi::Log(ADDON_LOG_DEBUG, "Added series timer for periodPVRTaskId: %s", Utils::JsonStringOrEmpty(doc, "periodPVRTaskId").c_str());
+        DEBUG_LOG("Added series timer for periodPVRTaskId: %s", Utils::JsonStringOrEmpty(doc, "periodPVRTaskId").c_str());
         kodi::QueueNotification(QUEUE_INFO, "Aufnahme", "Serienaufnahme programmiert");
       }
       break;
     default:
-      kodi::Log(ADDON_LOG_DEBUG, "Unknown Timer Type");
+      DEBUG_LOG("Unknown Timer Type");
       return PVR_ERROR_FAILED;
   }
 
+  InvalidateTimersRecordings();
   kodi::addon::CInstancePVRClient::TriggerTimerUpdate();
   auto current_time = time(NULL);
   if (current_time > timer.GetStartTime()) {
@@ -2542,7 +2860,11 @@ PVR_ERROR CPVRMagenta::AddTimer(const kodi::addon::PVRTimer& timer)
 
 PVR_ERROR CPVRMagenta::UpdateTimer(const kodi::addon::PVRTimer& timer)
 {
-  kodi::Log(ADDON_LOG_DEBUG, "function call: [%s]", __FUNCTION__);
+  TRACE_SCOPE("magenta", __FUNCTION__);
+  DEBUG_LOG("function call: [%s]", __FUNCTION__);
+  if (m_isMagenta2)
+    return PVR_ERROR_NOT_IMPLEMENTED;
+  m_startup.Wait("recordings");
 
   std::string url;
   std::string postData;
@@ -2570,7 +2892,7 @@ PVR_ERROR CPVRMagenta::UpdateTimer(const kodi::addon::PVRTimer& timer)
       if (!JsonRequest(url, postData, doc)) {
         return PVR_ERROR_SERVER_ERROR;
       } else {
-        kodi::Log(ADDON_LOG_DEBUG, "Updated timer for PVRID: %s", mytimer.pvrId.c_str());
+        DEBUG_LOG("Updated timer for PVRID: %s", mytimer.pvrId.c_str());
         kodi::QueueNotification(QUEUE_INFO, "Aufnahme", "Aufnahme geändert");
       }
     }
@@ -2581,21 +2903,22 @@ PVR_ERROR CPVRMagenta::UpdateTimer(const kodi::addon::PVRTimer& timer)
       if (timer.GetClientIndex() != mytimer.index)
         continue;
 
-      MagentaChannel addonChannel;
-      if (!GetChannel(timer.GetClientChannelUid(), addonChannel))
+      const MagentaChannel* addonChannel = GetChannel(timer.GetClientChannelUid());
+      if (!addonChannel)
         return PVR_ERROR_FAILED;
 
       url = m_epg_https_url + "PeriodPVRMgmt";
-      postData = GetPeriodPVRPayload(addonChannel, timer, mytimer.periodPVRTaskId, true);
+      postData = GetPeriodPVRPayload(*addonChannel, timer, mytimer.periodPVRTaskId, true);
       if (!JsonRequest(url, postData, doc)) {
         return PVR_ERROR_SERVER_ERROR;
       } else {
-        kodi::Log(ADDON_LOG_DEBUG, "Updated series timer for periodPVRTaskId: %s", mytimer.periodPVRTaskId.c_str());
+        DEBUG_LOG("Updated series timer for periodPVRTaskId: %s", mytimer.periodPVRTaskId.c_str());
         kodi::QueueNotification(QUEUE_INFO, "Aufnahme", "Serienaufnahme geändert");
       }
     }
   }
 
+  InvalidateTimersRecordings();
   kodi::addon::CInstancePVRClient::TriggerTimerUpdate();
 
   return PVR_ERROR_NO_ERROR;
@@ -2603,7 +2926,12 @@ PVR_ERROR CPVRMagenta::UpdateTimer(const kodi::addon::PVRTimer& timer)
 
 PVR_ERROR CPVRMagenta::DeleteTimer(const kodi::addon::PVRTimer& timer, bool)
 {
-  kodi::Log(ADDON_LOG_DEBUG, "function call: [%s]", __FUNCTION__);
+  TRACE_SCOPE("magenta", __FUNCTION__);
+  DEBUG_LOG("function call: [%s]", __FUNCTION__);
+  if (m_isMagenta2)
+    return PVR_ERROR_NOT_IMPLEMENTED;
+  m_startup.Wait("recordings");
+
   if (timer.GetTimerType() == TIMER_ONCE_EPG)
   {
     for (const auto& thisTimer : m_timers)
@@ -2630,6 +2958,7 @@ PVR_ERROR CPVRMagenta::DeleteTimer(const kodi::addon::PVRTimer& timer, bool)
         return PVR_ERROR_SERVER_ERROR;
       } else {
         kodi::QueueNotification(QUEUE_INFO, "Timer", "Serientimer gelöscht");
+        InvalidateTimersRecordings();
         kodi::addon::CInstancePVRClient::TriggerTimerUpdate();
 
         //TODO: {"action":"DELETE","task":{"periodPVRTaskId":"xyz"}} if all recordings are deleted
@@ -2642,28 +2971,15 @@ PVR_ERROR CPVRMagenta::DeleteTimer(const kodi::addon::PVRTimer& timer, bool)
   return PVR_ERROR_FAILED;
 }
 
-bool CPVRMagenta::GetChannel(const int& channelUid, MagentaChannel& myChannel)
+const MagentaChannel* CPVRMagenta::GetChannel(const int& channelUid) const
 {
   for (const auto& thisChannel : m_channels)
   {
     if (thisChannel.iUniqueId == (int)channelUid)
-    {
-      myChannel.bRadio = thisChannel.bRadio;
-      myChannel.iUniqueId = thisChannel.iUniqueId;
-//      myChannel.mediaId = thisChannel.mediaId;
-//      myChannel.bRadio = thisChannel.bRadio;
-      myChannel.iChannelNumber = thisChannel.iChannelNumber;
-      myChannel.strChannelName = thisChannel.strChannelName;
-      myChannel.strIconPath = thisChannel.strIconPath;
-//      myChannel.strStreamURL = thisChannel.strStreamURL;
-      myChannel.physicalChannels = thisChannel.physicalChannels;
-      myChannel.isHidden = thisChannel.isHidden;
-
-      return true;
-    }
+      return &thisChannel;
   }
 
-  return false;
+  return nullptr;
 }
 
 ADDONCREATOR(CPVRMagenta)
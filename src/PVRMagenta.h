@@ -6,17 +6,23 @@
  *  See LICENSE.md for more information.
  */
 
+#include <map>
+#include <mutex>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include <kodi/addon-instance/PVR.h>
 #include "Settings.h"
 #include "http/HttpClient.h"
 #include "PVRMagenta2.h"
+#include "task/TaskQueue.h"
+#include "task/TaskGraph.h"
+#include "epg/TimeshiftWindow.h"
+#include "session/SessionManager.h"
+#include "auth/SingleFlight.h"
 #include "rapidjson/document.h"
 
-#define TIMER_ONCE_EPG (PVR_TIMER_TYPE_NONE + 1)
-#define TIMER_SERIES_EPG (PVR_TIMER_TYPE_NONE + 2)
 static const int IPTV_STB = 0;
 static const int PC = 1;
 static const int OTT = 2;
@@ -47,6 +53,10 @@ static const int MAGENTA_RECORDING_DELETE_MODE_KEEP_FIVE = 2;
 static const int MAGENTA_RECORDING_DELETE_MODE_KEEP_TEN = 3;
 static const int MAGENTA_TIMER_TIMEMODE_ANY = 0;
 static const int MAGENTA_TIMER_TIMEMODE_START = 2;
+static const int PVR_SYNC_PAGE_SIZE = 100;
+static const time_t PVR_SYNC_MIN_INTERVAL = 30;
+static const int BOOKMARK_FLUSH_DELAY = 5000; //ms
+static const int BOOKMARK_FLUSH_MAX_DELAY = 30000; //ms
 
 /*
 urls: {
@@ -233,6 +243,22 @@ struct MagentaRecordingGroup
   std::vector<MagentaRecording> groupRecordings;
 };
 
+struct MagentaSyncState
+{
+  std::map<std::string, std::string> fingerprints;
+  std::map<std::string, unsigned int> indexes;
+  unsigned int nextIndex;
+  time_t lastSync;
+  bool isValid;
+};
+
+struct MagentaSyncResult
+{
+  int added;
+  int updated;
+  int removed;
+};
+
 struct MagentaCategory
 {
   unsigned int position;
@@ -264,6 +290,9 @@ struct MagentaChannel
 //  int pvrMediaId;
   unsigned int iChannelNumber; //position
   std::vector<PhysicalChannel> physicalChannels;
+  int liveMediaId; //also used for timeshift
+  int npvrMediaId;
+  std::string livePlayUrl;
   std::string strChannelName;
   std::string strIconPath;
   bool isHidden;
@@ -325,17 +354,18 @@ public:
 
   ADDON_STATUS SetSetting(const std::string& settingName,
                         const std::string& settingValue);
+  void CloseLiveStream() override;
+  void CloseRecordedStream() override;
 /*
   bool SeekTime(double time, bool backward, double& startpts) override;
   bool CanPauseStream() override { return true; }
   bool CanSeekStream() override { return true; }
   bool OpenLiveStream(const kodi::addon::PVRChannel& channel) override;
-  void CloseLiveStream() override;
   int64_t SeekLiveStream(int64_t position, int whence) override;
 */
 protected:
   std::string GetRecordingURL(const kodi::addon::PVRRecording& recording);
-  bool GetChannel(const int& channelUid, MagentaChannel& myChannel);
+  const MagentaChannel* GetChannel(const int& channelUid) const;
 
 private:
 //  PVR_ERROR CallMenuHook(const kodi::addon::PVRMenuhook& menuhook);
@@ -350,21 +380,38 @@ private:
   std::vector<MagentaRecording> m_timers;
   std::vector<MagentaRecordingGroup> m_timerGroups;
   std::vector<MagentaRecordingGroup> m_recGroups;
+  MagentaSyncState m_recordingSync;
+  MagentaSyncState m_timerSync;
+  std::unordered_map<std::string, int> m_bookmarks;
+  std::unordered_map<std::string, int> m_pendingBookmarks;
+  std::chrono::steady_clock::time_point m_pendingBookmarksSince;
+  std::mutex m_bookmarkMutex;
+  std::mutex m_mediaSelectionMutex; //media ids and live url of the channels, the settings thread rewrites them
+  TaskQueue m_taskQueue;
+  TimeshiftWindow m_timeshiftWindow;
   std::vector<MagentaGenre> m_genres;
   std::vector<MagentaDevice> m_devices;
+  std::mutex m_devicesMutex;
+  std::mutex m_sessionMutex; //user and session ids, a re-auth rewrites them while requests run
 
+  HttpMetrics m_httpMetrics;
   HttpClient *m_httpClient;
   CSettings* m_settings;
   CPVRMagenta2* m_magenta2;
+  SessionManager m_sessionManager;
+  SingleFlight<> m_authFlight;
+  StartupProfiler m_profiler;
+  TaskGraph m_startup;
 
   bool JsonRequest(const std::string& url, const std::string& postData, rapidjson::Document& doc);
   std::string PrepareTime(const std::string& current);
   bool is_better_resolution(const int alternative, const int current);
   bool is_pvr_allowed(const rapidjson::Value& current_item);
-  int SelectMediaId(const MagentaChannel channel, const bool npvr);
-  std::string GetPlayUrl(const MagentaChannel channel, const int mediaId);
+  int SelectMediaId(const MagentaChannel& channel, const bool npvr);
+  void UpdateMediaSelection();
+  std::string GetPlayUrl(const MagentaChannel& channel, const int mediaId);
   std::string GetPlay(const int& chanId, const int& mediaId, const bool isTimeshift);
-  bool HasStreamingUrl(const MagentaChannel channel);
+  bool HasStreamingUrl(const MagentaChannel& channel);
   bool GetEPGDetails(std::string& contentCode, rapidjson::Document& epgDoc);
   bool FillEPGTag(const rapidjson::Value& epgItem, kodi::addon::PVREPGTag& tag);
   void FillEPGDetails(const rapidjson::Value& epgItem, kodi::addon::PVREPGTag& tag);
@@ -375,7 +422,9 @@ private:
   bool GuestLogin();
   bool GuestAuthenticate();
   bool MagentaDTAuthenticate();
+  bool MagentaSamAuthenticate();
   bool MagentaAuthenticate();
+  std::string GetSessionValue(const std::string& value);
   bool AddGroupChannel(const long groupid, const unsigned int channelid);
   bool ReleaseCurrentMedia();
   bool GetCategories();
@@ -385,7 +434,17 @@ private:
   void FillRecording(const rapidjson::Value& recordingItem, MagentaRecording& magenta_recording, const int& index);
   void FillPVRRecording(kodi::addon::PVRRecording& kodiRecording, const MagentaRecording& rec);
   bool UpdateBookmarks();
-  bool GetTimersRecordings(const bool isRecording);
+  void FlushBookmarks();
+  std::string GetFingerprint(const rapidjson::Value& item);
+  unsigned int GetSyncIndex(MagentaSyncState& state, const std::string& key);
+  void SyncRecordingItem(MagentaSyncState& state,
+                         const rapidjson::Value& recordingItem,
+                         const std::map<std::string, const MagentaRecording*>& known,
+                         std::map<std::string, std::string>& fingerprints,
+                         std::vector<MagentaRecording>& items,
+                         MagentaSyncResult& result);
+  bool SyncTimersRecordings(const bool isRecording, MagentaSyncResult& result);
+  void InvalidateTimersRecordings();
   bool GetTimers();
   int GetGroupTimersAmount();
   int GetGroupRecordingsAmount();
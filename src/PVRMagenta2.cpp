@@ -9,6 +9,8 @@
 #include "PVRMagenta2.h"
 
 #include <algorithm>
+#include <iomanip>
+#include <set>
 
 #include "Globals.h"
 #include <kodi/General.h>
@@ -21,15 +23,19 @@
 #include <tinyxml2.h>
 #include <kodi/Filesystem.h>
 #include "auth/AuthClient.h"
+#include "smil/SmilParser.h"
+#include "trace/Trace.h"
+#include "log/DebugLog.h"
 
 void tokenize2(std::string const &str, const char* delim,
             std::vector<std::string> &out)
 {
-    char *token = strtok(const_cast<char*>(str.c_str()), delim);
-    while (token != nullptr)
+    size_t start = str.find_first_not_of(delim);
+    while (start != std::string::npos)
     {
-        out.push_back(std::string(token));
-        token = strtok(nullptr, delim);
+        size_t stop = str.find_first_of(delim, start);
+        out.push_back(str.substr(start, stop - start));
+        start = str.find_first_not_of(delim, stop);
     }
 }
 
@@ -42,15 +48,12 @@ void replace(std::string& str, const std::string& from, const std::string& to) {
   }
 }
 
-void PrepareTime(std::string& timestr)
+std::string JsonToString(const rapidjson::Value& value)
 {
-  if (timestr.size() != 15)
-    return;
-  timestr.insert(4, "-");
-  timestr.insert(7, "-");
-  timestr.insert(13, ":");
-  timestr.insert(16, ":");
-  timestr += "Z";
+  rapidjson::StringBuffer buffer;
+  rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+  value.Accept(writer);
+  return buffer.GetString();
 }
 
 /*
@@ -88,7 +91,7 @@ bool CPVRMagenta2::GetMyGenres()
   std::string content;
   kodi::vfs::CFile myFile;
   std::string file = kodi::addon::GetAddonPath() + "mygenres2.json";
-  kodi::Log(ADDON_LOG_DEBUG, "Opening mygenres: %s", file.c_str());
+  DEBUG_LOG("Opening mygenres: %s", file.c_str());
   if (myFile.OpenFile(file))
   {
     char buffer[1024];
@@ -129,7 +132,7 @@ bool CPVRMagenta2::GetMyGenres()
       }
     }
     m_genres.emplace_back(genre);
-    kodi::Log(ADDON_LOG_DEBUG, "Added genre: %s %i %i", genre.primaryGenre.c_str(), genre.genreType, genre.genreSubType);
+    DEBUG_LOG("Added genre: %s %i %i", genre.primaryGenre.c_str(), genre.genreType, genre.genreSubType);
   }
 
   return true;
@@ -149,7 +152,8 @@ bool CPVRMagenta2::GetPostJson(const std::string& url, const std::string& body,
              (url.find(m_liveTvCategoryFeed) != std::string::npos))
 //             (url.find(m_entitledChannelsFeed) != std::string::npos))
       result = m_httpClient->HttpGetCached(url, 60 * 60 * 24 * 3, statusCode);
-    else if (url.find(m_pvrBaseUrl) != std::string::npos)
+    else if ((url.find(m_pvrBaseUrl) != std::string::npos) &&
+             (url.find("/get-recordings") == std::string::npos))
       result = m_httpClient->HttpGetCached(url, 60, statusCode);
     else
       result = m_httpClient->HttpGet(url, statusCode);
@@ -159,7 +163,12 @@ bool CPVRMagenta2::GetPostJson(const std::string& url, const std::string& body,
     result = m_httpClient->HttpPost(url, body, statusCode);
   }
 //  kodi::Log(ADDON_LOG_DEBUG, "Result: %s", result.c_str());
-  doc.Parse(result.c_str());
+  profiletime_t parseStart = std::chrono::steady_clock::now();
+  {
+    TRACE_SCOPE("json", "Parse");
+    doc.Parse(result.c_str());
+  }
+  StartupProfiler::AddParse(parseStart);
   if (statusCode == 206)
   {
 //    kodi::Log(ADDON_LOG_DEBUG, "Status Code 206 Response: %s", result.c_str());
@@ -173,18 +182,20 @@ bool CPVRMagenta2::GetPostJson(const std::string& url, const std::string& body,
   {
     if (Utils::JsonIntOrZero(doc, "responseCode") == 401)
     {
-      kodi::Log(ADDON_LOG_DEBUG, "We need to reauthenticate!");
+      DEBUG_LOG("We need to reauthenticate!");
+      m_httpClient->GetMetrics().AddReauth(url);
       /*
       if (!m_authMethods.password && !m_authMethods.code && !m_authMethods.line)
         m_sam3Client->GetAuthMethods();
       if (m_authMethods.line)
       {
-        kodi::Log(ADDON_LOG_DEBUG, "LineAuth");
+        DEBUG_LOG("LineAuth");
 //        LineAuth();
       }
       */
       if (m_authClient->ReLogin()) {
-        kodi::Log(ADDON_LOG_DEBUG, "Reauth successful");
+        DEBUG_LOG("Reauth successful");
+        m_httpClient->GetMetrics().AddRetry(url);
         if (body.empty()) {
           result = m_httpClient->HttpGet(url, statusCode);
         } else
@@ -200,7 +211,7 @@ bool CPVRMagenta2::GetPostJson(const std::string& url, const std::string& body,
         }
       } else
       {
-        kodi::Log(ADDON_LOG_DEBUG, "Reauth failed");
+        DEBUG_LOG("Reauth failed");
         kodi::gui::dialogs::OK::ShowAndGetInput("Reauth failed", "Reauth failed");
         return false;
       }
@@ -208,7 +219,7 @@ bool CPVRMagenta2::GetPostJson(const std::string& url, const std::string& body,
     }
     else
     {
-      kodi::Log(ADDON_LOG_DEBUG, "Get Json for %s answered response code: %i and title %s",
+      DEBUG_LOG("Get Json for %s answered response code: %i and title %s",
                                           url.c_str(),
                                           Utils::JsonIntOrZero(doc, "responseCode"),
                                           Utils::JsonStringOrEmpty(doc, "title").c_str());
@@ -218,15 +229,12 @@ bool CPVRMagenta2::GetPostJson(const std::string& url, const std::string& body,
   return true;
 }
 
-bool CPVRMagenta2::GetSmil(const std::string& url, tinyxml2::XMLDocument& smilDoc)
+bool CPVRMagenta2::GetSmil(const std::string& url, std::string& smil)
 {
   int statusCode = 0;
-  std::string result;
 
-  result = m_httpClient->HttpGet(url, statusCode);
-
-  smilDoc.Parse(result.c_str());
-  if ((smilDoc.Error()) || (statusCode != 200))
+  smil = m_httpClient->HttpGet(url, statusCode);
+  if ((smil.empty()) || (statusCode != 200))
   {
     kodi::Log(ADDON_LOG_ERROR, "Failed to get SMIL %s status code: %i", url.c_str(), statusCode);
     return false;
@@ -234,7 +242,6 @@ bool CPVRMagenta2::GetSmil(const std::string& url, tinyxml2::XMLDocument& smilDo
 
   return true;
 }
-
 bool CPVRMagenta2::AddDistributionRight(const unsigned int number, const std::string& right)
 {
   for (auto& thisChannel : m_channels)
@@ -246,7 +253,7 @@ bool CPVRMagenta2::AddDistributionRight(const unsigned int number, const std::st
       return true;
     }
   }
-  kodi::Log(ADDON_LOG_DEBUG, "Failed to add distribution right: %s for channel %i", right.c_str(), number);
+  DEBUG_LOG("Failed to add distribution right: %s for channel %i", right.c_str(), number);
   return false;
 }
 
@@ -287,18 +294,18 @@ bool CPVRMagenta2::HideDuplicateChannels()
         {
           if (m_settings->PreferHigherResolution()) {
             (*it2).isHidden = true;
-            kodi::Log(ADDON_LOG_DEBUG, "Hiding %s %i %i", (*it2).strChannelName.c_str(), (*it2).iChannelNumber, (*it2).iUniqueId);
+            DEBUG_LOG("Hiding %s %i %i", (*it2).strChannelName.c_str(), (*it2).iChannelNumber, (*it2).iUniqueId);
           } else {
             (*it).isHidden = true;
-            kodi::Log(ADDON_LOG_DEBUG, "Hiding %s %i %i", (*it).strChannelName.c_str(), (*it).iChannelNumber, (*it).iUniqueId);
+            DEBUG_LOG("Hiding %s %i %i", (*it).strChannelName.c_str(), (*it).iChannelNumber, (*it).iUniqueId);
           }
         } else {
           if (m_settings->PreferHigherResolution()) {
             (*it).isHidden = true;
-            kodi::Log(ADDON_LOG_DEBUG, "Hiding %s %i %i", (*it).strChannelName.c_str(), (*it).iChannelNumber, (*it).iUniqueId);
+            DEBUG_LOG("Hiding %s %i %i", (*it).strChannelName.c_str(), (*it).iChannelNumber, (*it).iUniqueId);
           } else {
             (*it2).isHidden = true;
-            kodi::Log(ADDON_LOG_DEBUG, "Hiding %s %i %i", (*it2).strChannelName.c_str(), (*it2).iChannelNumber, (*it2).iUniqueId);
+            DEBUG_LOG("Hiding %s %i %i", (*it2).strChannelName.c_str(), (*it2).iChannelNumber, (*it2).iUniqueId);
           }
         }
       }
@@ -309,7 +316,7 @@ bool CPVRMagenta2::HideDuplicateChannels()
 
 bool CPVRMagenta2::Bootstrap()
 {
-  kodi::Log(ADDON_LOG_DEBUG, "function call: [%s]", __FUNCTION__);
+  DEBUG_LOG("function call: [%s]", __FUNCTION__);
 
   m_deviceTokensUrl.clear();
   m_manifestBaseUrl.clear();
@@ -363,9 +370,7 @@ bool CPVRMagenta2::GetParameter(const std::string& key, std::string& value)
 
 bool CPVRMagenta2::GetCategories()
 {
-  kodi::Log(ADDON_LOG_DEBUG, "function call: [%s]", __FUNCTION__);
-
-  replace(m_liveTvCategoryFeed, "{MpxAccountPid}", m_accountPid);
+  DEBUG_LOG("function call: [%s]", __FUNCTION__);
 
   std::string url = m_liveTvCategoryFeed;
 
@@ -388,30 +393,52 @@ bool CPVRMagenta2::GetCategories()
     category.scheme = Utils::JsonStringOrEmpty(entries[i], "scheme");
     category.level = Utils::JsonIntOrZero(entries[i], "level");
     m_categories.emplace_back(category);
-    kodi::Log(ADDON_LOG_DEBUG, "Adding category %s", category.description.c_str());
+    DEBUG_LOG("Adding category %s", category.description.c_str());
   }
 
   return true;
 }
 
-bool CPVRMagenta2::DeviceManifest()
+bool CPVRMagenta2::FetchManifest(rapidjson::Document& doc, std::string& type)
 {
-  kodi::Log(ADDON_LOG_DEBUG, "function call: [%s]", __FUNCTION__);
-
-  std::string url = m_deviceTokensUrl +
-                    "?model=" + Utils::UrlEncode(Magenta2Parameters[m_platform].device_model) +
-                    "&deviceId=" + m_deviceId +
-                    "&appname=" + Magenta2Parameters[m_platform].app_name +
-                    "&appVersion=" + Magenta2Parameters[m_platform].app_version +
-                    "&firmware=" + Utils::UrlEncode(Magenta2Parameters[m_platform].firmware) +
-                    "&runtimeVersion=" + Magenta2Parameters[m_platform].runtime +
-                    "&duid=" + m_deviceId;
+  DEBUG_LOG("function call: [%s]", __FUNCTION__);
 
-  rapidjson::Document doc;
-  if (!GetPostJson(url, "", doc)) {
+  std::string url;
+  if (!m_deviceTokensUrl.empty()) {
+    type = "device";
+    url = m_deviceTokensUrl +
+          "?model=" + Utils::UrlEncode(Magenta2Parameters[m_platform].device_model) +
+          "&deviceId=" + m_deviceId +
+          "&appname=" + Magenta2Parameters[m_platform].app_name +
+          "&appVersion=" + Magenta2Parameters[m_platform].app_version +
+          "&firmware=" + Utils::UrlEncode(Magenta2Parameters[m_platform].firmware) +
+          "&runtimeVersion=" + Magenta2Parameters[m_platform].runtime +
+          "&duid=" + m_deviceId;
+  } else if (!m_manifestBaseUrl.empty()) {
+    type = "manifest";
+    url = m_manifestBaseUrl;
+    replace(url, "{configGroupId}", Magenta2Parameters[m_platform].config_group_id);
+    url = url + "?deviceid=" + m_deviceId;
+  } else
+  {
+    DEBUG_LOG("No appropriate URL found");
     return false;
   }
 
+  return GetPostJson(url, "", doc);
+}
+
+bool CPVRMagenta2::ApplyManifest(const rapidjson::Value& doc, const std::string& type)
+{
+  if (type == "device")
+    return DeviceManifest(doc);
+  return Manifest(doc);
+}
+
+bool CPVRMagenta2::DeviceManifest(const rapidjson::Value& doc)
+{
+  DEBUG_LOG("function call: [%s]", __FUNCTION__);
+
   if (!doc.HasMember("settings") || !doc.HasMember("sts"))
   {
     kodi::Log(ADDON_LOG_ERROR, "Failed to load device manifest");
@@ -450,22 +477,15 @@ bool CPVRMagenta2::DeviceManifest()
   std::string deviceToken = Utils::JsonStringOrEmpty(sts, "deviceToken");
   m_authClient->SetDeviceToken(deviceToken);
   m_httpClient->SetDeviceToken(deviceToken);
+  StartupProfiler::Scope scope(&m_profiler, "sam3");
   m_authClient->InitSam3();
 
   return true;
 }
 
-bool CPVRMagenta2::Manifest()
+bool CPVRMagenta2::Manifest(const rapidjson::Value& doc)
 {
-  kodi::Log(ADDON_LOG_DEBUG, "function call: [%s]", __FUNCTION__);
-
-  replace(m_manifestBaseUrl, "{configGroupId}", Magenta2Parameters[m_platform].config_group_id);
-  std::string url = m_manifestBaseUrl + "?deviceid=" + m_deviceId;
-
-  rapidjson::Document doc;
-  if (!GetPostJson(url, "", doc)) {
-    return false;
-  }
+  DEBUG_LOG("function call: [%s]", __FUNCTION__);
 
   if (!doc.HasMember("mpx") || !doc.HasMember("livetv") || !doc.HasMember("ngiss"))
   {
@@ -497,17 +517,21 @@ bool CPVRMagenta2::Manifest()
   const rapidjson::Value& ngiss = doc["ngiss"];
   m_ngiss.basicUrl = Utils::JsonStringOrEmpty(ngiss, "basicUrl");
   m_ngiss.callParameter = Utils::JsonStringOrEmpty(ngiss, "callParameter");
+  {
+    std::lock_guard<std::mutex> lock(m_ngissMutex);
+    m_ngissUrls.clear();
+  }
 
 //  kodi::Log(ADDON_LOG_DEBUG, "m_entitledChannelsFeed: %s", m_entitledChannelsFeed.c_str());
 
   return true;
 }
 
-bool CPVRMagenta2::GetDistributionRights()
+bool CPVRMagenta2::GetDistributionRights(std::vector<std::string>& rights)
 {
-  kodi::Log(ADDON_LOG_DEBUG, "function call: [%s]", __FUNCTION__);
+  DEBUG_LOG("function call: [%s]", __FUNCTION__);
 
-  m_distributionRights.clear();
+  rights.clear();
   std::string url = m_basicUrlGetApplicableDistributionRights + "?form=json&schema=1.2";
 
   rapidjson::Document doc;
@@ -520,12 +544,12 @@ bool CPVRMagenta2::GetDistributionRights()
     kodi::Log(ADDON_LOG_ERROR, "Failed to get distribution rights");
     return false;
   }
-  const rapidjson::Value& rights = doc["getApplicableDistributionRightsResponse"];
-  for (rapidjson::SizeType i = 0; i < rights.Size(); i++)
+  const rapidjson::Value& rightsResponse = doc["getApplicableDistributionRightsResponse"];
+  for (rapidjson::SizeType i = 0; i < rightsResponse.Size(); i++)
   {
-    std::string right = rights[i].GetString();
-    m_distributionRights.emplace_back(right);
-    kodi::Log(ADDON_LOG_DEBUG, "Added right: %s", right.c_str());
+    std::string right = rightsResponse[i].GetString();
+    rights.emplace_back(right);
+    DEBUG_LOG("Added right: %s", right.c_str());
   }
 
   return true;
@@ -590,7 +614,7 @@ void CPVRMagenta2::AddChannelEntry(const rapidjson::Value& entry)
       }
     }
     CPVRMagenta2::m_channels.emplace_back(channel);
-    kodi::Log(ADDON_LOG_DEBUG, "Added channel: %u %s station: %s", channel.iUniqueId, channel.strChannelName.c_str(), channel.stationsId.c_str());
+    DEBUG_LOG("Added channel: %u %s station: %s", channel.iUniqueId, channel.strChannelName.c_str(), channel.stationsId.c_str());
   }
 }
 
@@ -607,7 +631,7 @@ void CPVRMagenta2::AddEntitlementEntry(const rapidjson::Value& entry)
 bool CPVRMagenta2::GetFeed(/*const int& feed,*/ const int& maxEntries, /*const std::string& params,*/ std::string& baseUrl/*, kodi::addon::PVREPGTagsResultSet& results*/,
         handleentry_t HandleEntry)
 {
-  kodi::Log(ADDON_LOG_DEBUG, "function call: [%s]", __FUNCTION__);
+  DEBUG_LOG("function call: [%s]", __FUNCTION__);
 
   int startIndex = 1;
   int endIndex = maxEntries;
@@ -667,11 +691,16 @@ bool CPVRMagenta2::GetFeed(/*const int& feed,*/ const int& maxEntries, /*const s
 }
 
 CPVRMagenta2::CPVRMagenta2(CSettings* settings, HttpClient* httpclient):
-  m_settings(settings),
-  m_httpClient(httpclient)
+  m_timeshiftWindow(TIMEBUFFER2),
+  m_recordingsValidUntil(0),
+  m_nextTimerIndex(1),
+  m_profiler("MagentaTV 2.0"),
+  m_warmStart(false),
+  m_httpClient(httpclient),
+  m_settings(settings)
 {
   m_sessionId = Utils::CreateUUID();
-  kodi::Log(ADDON_LOG_DEBUG, "Current SessionID %s", m_sessionId.c_str());
+  DEBUG_LOG("Current SessionID %s", m_sessionId.c_str());
   m_httpClient->SetSessionId(m_sessionId);
   m_deviceId = m_settings->GetMagentaDeviceID();
   m_platform = m_settings->GetTerminalType();
@@ -679,35 +708,74 @@ CPVRMagenta2::CPVRMagenta2(CSettings* settings, HttpClient* httpclient):
     m_deviceId = Utils::CreateUUID();
     m_settings->SetSetting("deviceid", m_deviceId);
   }
-  kodi::Log(ADDON_LOG_DEBUG, "Current DeviceID %s", m_deviceId.c_str());
+  DEBUG_LOG("Current DeviceID %s", m_deviceId.c_str());
   m_authClient = new AuthClient(m_settings, m_httpClient);
   m_httpClient->SetAuthClient(m_authClient);
+  m_concurrencyClient = new ConcurrencyClient(m_httpClient, m_deviceId);
 
-  if (!Bootstrap())
-    return;
-  if (!m_deviceTokensUrl.empty()) {
-    if (!DeviceManifest())
-      return;
-  } else if (!m_manifestBaseUrl.empty()) {
-    if (!Manifest())
-      return;
-  } else
-  {
-    kodi::Log(ADDON_LOG_DEBUG, "No appropriate URL found");
-    return;
-  }
-  m_categories.clear();
-  if (m_settings->IsGroupsenabled())
-    GetCategories();
+  // each piece of state loads in the background, callers only wait for what they use
+  m_startup.Add("auth", {}, [this]() {
+    {
+      StartupProfiler::Scope scope(&m_profiler, "bootstrap");
+      if (!Bootstrap())
+        return false;
+    }
+    StartupProfiler::Scope scope(&m_profiler, "manifest");
+    m_warmStart = RestoreAuthState();
+    if (!m_warmStart)
+    {
+      rapidjson::Document manifest;
+      std::string manifestType;
+      if (!FetchManifest(manifest, manifestType) || !ApplyManifest(manifest, manifestType))
+        return false;
+      m_authState.SetString("manifest.type", manifestType);
+      m_authState.SetString("manifest", JsonToString(manifest));
+    }
+    // the feed urls are read by the parallel steps below, they must not change after this
+    replace(m_allChannelSchedulesFeed, "{{MpxAccountPid}}", m_accountPid);
+    replace(m_allProgramsFeedUrl, "{{MpxAccountPid}}", m_accountPid);
+    replace(m_liveTvCategoryFeed, "{MpxAccountPid}", m_accountPid);
+    replace(m_entitledChannelsFeed, "{MpxAccountPid}", m_accountPid);
+    if (m_allChannelStationsFeed.empty())
+      GetParameter("mpxDefaultUrlAllChannelStationsFeed", m_allChannelStationsFeed);
+    else
+      replace(m_allChannelStationsFeed, "{MpxAccountPid}", m_accountPid);
+    return true;
+  });
+  m_startup.Add("rights", {"auth"}, [this]() {
+    if (!m_warmStart)
+    {
+      bool fetched = GetDistributionRights(m_distributionRights);
+      m_authState.SetList("distributionRights", m_distributionRights);
+      if (fetched)
+        m_authState.MarkValidated();
+    }
+    // a warm start trusted the snapshot, make sure the next one finds it current
+    if (m_warmStart)
+      m_taskQueue.Post([this]() { RevalidateAuthState(); });
+    else
+      SaveAuthState();
+    return true;
+  });
+  m_startup.Add("categories", {"auth"}, [this]() {
+    m_categories.clear();
+    return !m_settings->IsGroupsenabled() || GetCategories();
+  });
+  m_startup.Add("genres", {}, [this]() {
+    return GetMyGenres();
+  });
+  m_startup.Add("channels", {"categories", "rights"}, [this]() {
+    return LoadChannels();
+  });
+  m_startup.SetProfiler(&m_profiler);
+  m_startup.Start();
+}
 
+bool CPVRMagenta2::LoadChannels()
+{
   m_channels.clear();
   if (m_allChannelStationsFeed.empty())
-  {
-    if (!GetParameter("mpxDefaultUrlAllChannelStationsFeed", m_allChannelStationsFeed))
-      return;
-  } else {
-    replace(m_allChannelStationsFeed, "{MpxAccountPid}", m_accountPid);
-  }
+    return false;
   std::string baseUrl = m_allChannelStationsFeed + "?lang=short-de";
 
   GetFeed(/*FEED_ALL_CHANNELS,*/ MAX_CHANNEL_ENTRIES, baseUrl/*, nullptr*/, &CPVRMagenta2::AddChannelEntry);
@@ -715,9 +783,6 @@ CPVRMagenta2::CPVRMagenta2(CSettings* settings, HttpClient* httpclient):
   //TODO: Remove
 //  m_sam3Client->Sam3Login();
 
-  GetDistributionRights();
-
-  replace(m_entitledChannelsFeed, "{MpxAccountPid}", m_accountPid);
   baseUrl = m_entitledChannelsFeed + "?byDistributionRightId=";
   for (const auto& right : m_distributionRights)
   {
@@ -727,19 +792,86 @@ CPVRMagenta2::CPVRMagenta2(CSettings* settings, HttpClient* httpclient):
   }
   GetFeed(/*FEED_ENTITLED_CHANNELS,*/ MAX_CHANNEL_ENTRIES, baseUrl/*, nullptr*/, &CPVRMagenta2::AddEntitlementEntry);
   HideDuplicateChannels();
-  replace(m_allChannelSchedulesFeed, "{{MpxAccountPid}}", m_accountPid);
-  replace(m_allProgramsFeedUrl, "{{MpxAccountPid}}", m_accountPid);
-  GetMyGenres();
+  SetChannelIcons();
+
+  return true;
+}
+
+bool CPVRMagenta2::RestoreAuthState()
+{
+  if (!m_authState.Load(m_deviceId))
+    return false;
+
+  std::string manifestType;
+  std::string manifest;
+  std::vector<std::string> rights;
+  if (!m_authState.GetString("manifest.type", manifestType) ||
+      !m_authState.GetString("manifest", manifest) ||
+      !m_authState.GetList("distributionRights", rights))
+    return false;
+
+  rapidjson::Document doc;
+  doc.Parse(manifest.c_str());
+  if (doc.GetParseError())
+    return false;
+
+  m_authClient->RestoreState(m_authState);
+  if (!ApplyManifest(doc, manifestType))
+    return false;
+  m_distributionRights = rights;
+  DEBUG_LOG("Started from saved auth state");
+
+  return true;
+}
+
+void CPVRMagenta2::SaveAuthState()
+{
+  m_authClient->SaveState(m_authState);
+  m_authState.Save(m_deviceId);
+}
+
+void CPVRMagenta2::RevalidateAuthState()
+{
+  DEBUG_LOG("function call: [%s]", __FUNCTION__);
+
+  rapidjson::Document manifest;
+  std::string manifestType;
+  std::vector<std::string> rights;
+  if (!FetchManifest(manifest, manifestType) || !GetDistributionRights(rights))
+  {
+    DEBUG_LOG("Auth state revalidation failed, keeping the snapshot");
+    return;
+  }
+  if (rights != m_distributionRights)
+    kodi::Log(ADDON_LOG_INFO, "Distribution rights changed, the channel list follows on next start");
+
+  m_authState.SetString("manifest.type", manifestType);
+  m_authState.SetString("manifest", JsonToString(manifest));
+  m_authState.SetList("distributionRights", rights);
+  m_authState.MarkValidated();
+  SaveAuthState();
 }
 
 CPVRMagenta2::~CPVRMagenta2()
 {
+  m_startup.WaitAll();
+  m_taskQueue.Cancel("zap-prefetch");
+  m_taskQueue.Cancel("zap-expire");
+  m_taskQueue.Stop(false);
+  std::string manifest;
+  if (m_authState.GetString("manifest", manifest))
+    SaveAuthState();
+  delete m_concurrencyClient;
+  // the http client outlives us, it must not ask a deleted auth client for tokens
+  m_httpClient->SetAuthClient(nullptr);
+  delete m_authClient;
   m_channels.clear();
 }
 
 PVR_ERROR CPVRMagenta2::GetCapabilities(kodi::addon::PVRCapabilities& capabilities)
 {
-  kodi::Log(ADDON_LOG_DEBUG, "function call: [%s]", __FUNCTION__);
+  TRACE_SCOPE("magenta2", __FUNCTION__);
+  DEBUG_LOG("function call: [%s]", __FUNCTION__);
   capabilities.SetSupportsEPG(true);
   capabilities.SetSupportsEPGEdl(false);
   capabilities.SetSupportsTV(true);
@@ -751,7 +883,7 @@ PVR_ERROR CPVRMagenta2::GetCapabilities(kodi::addon::PVRCapabilities& capabiliti
   capabilities.SetSupportsRecordingsRename(false);
   capabilities.SetSupportsRecordingsLifetimeChange(false);
   capabilities.SetSupportsLastPlayedPosition(false);
-  capabilities.SetSupportsTimers(false);
+  capabilities.SetSupportsTimers(true);
   capabilities.SetSupportsDescrambleInfo(false);
   capabilities.SetSupportsProviders(false);
   /* PVR recording lifetime values and presentation.*/
@@ -764,180 +896,279 @@ PVR_ERROR CPVRMagenta2::GetCapabilities(kodi::addon::PVRCapabilities& capabiliti
   return PVR_ERROR_NO_ERROR;
 }
 
-bool CPVRMagenta2::GetStreamParameters(const std::string& url, std::string& src, std::string& releasePid)
+bool CPVRMagenta2::GetStreamParameters(const std::string& url, std::string& src, std::string& releasePid, Magenta2Lock& lock,
+                                       const bool silent)
 {
-  tinyxml2::XMLDocument smilDoc;
+  std::string smil;
 
-  if (!GetSmil(url, smilDoc))
+  releasePid.clear();
+  src.clear();
+  if (!GetSmil(url, smil))
     return false;
 
-  tinyxml2::XMLElement* pRootElement = smilDoc.RootElement();
-//  kodi::Log(ADDON_LOG_DEBUG, "Root: %s", pRootElement->Value().c_str());
-  tinyxml2::XMLElement* pElement = pRootElement->FirstChildElement("body");
-  if (!pElement) {
-    kodi::Log(ADDON_LOG_ERROR, "No Body found");
+  SmilResult result;
+  if (!SmilParser::Parse(smil, result)) {
+    kodi::Log(ADDON_LOG_ERROR, "Unknown structure");
     return false;
   }
-  tinyxml2::XMLElement* pHead = pRootElement->FirstChildElement("head");
-  if (!pHead) {
-    kodi::Log(ADDON_LOG_ERROR, "No Head found");
+  for (const auto& meta : result.meta)
+  {
+    if (meta.name == "concurrencyInstance")
+      lock.instance = meta.content;
+    else if (meta.name == "updateLockInterval")
+      lock.updateInterval = atoi(meta.content.c_str());
+    else if (meta.name == "concurrencyServiceUrl")
+      lock.serviceUrl = meta.content;
+    else if (meta.name == "lockId")
+      lock.id = meta.content;
+    else if (meta.name == "lockSequenceToken")
+      lock.token = meta.content;
+    else if (meta.name == "lock")
+      lock.lock = meta.content;
+    else
+      DEBUG_LOG("Unknown Meta Content name: %s with content: %s", meta.name.c_str(), meta.content.c_str());
+  }
+  if (result.isError) {
+    DEBUG_LOG("SRC: %s", result.src.c_str());
+    DEBUG_LOG("Title: %s", result.title.c_str());
+    DEBUG_LOG("Abstract: %s", result.abstract.c_str());
+    DEBUG_LOG("Exception: %i Response code: %i", result.isException, result.responseCode);
+    if (result.isException && !silent)
+      kodi::gui::dialogs::OK::ShowAndGetInput(result.title, result.abstract);
     return false;
   }
-  tinyxml2::XMLElement* pMeta = pHead->FirstChildElement("meta");
-  std::string name;
-  std::string content;
-  while (pMeta)
-  {
-    name = pMeta->Attribute("name");
-    content = pMeta->Attribute("content");
-    if (name == "concurrencyInstance")
-      m_currentLock.instance = content;
-    else if (name == "updateLockInterval")
-      m_currentLock.updateInterval = stoi(content);
-    else if (name == "concurrencyServiceUrl")
-      m_currentLock.serviceUrl = content;
-    else if (name == "lockId")
-      m_currentLock.id = content;
-    else if (name == "lockSequenceToken")
-      m_currentLock.token = content;
-    else if (name == "lock")
-      m_currentLock.lock = content;
-    else
-      kodi::Log(ADDON_LOG_DEBUG, "Unknown Meta Content name: %s with content: %s", name.c_str(), content.c_str());
-    pMeta = pMeta->NextSiblingElement();
+  src = result.src;
+  if (!result.trackingData.empty()) {
+    DEBUG_LOG("Tracking Data: %s", result.trackingData.c_str());
+    SmilParser::GetTrackingValue(result.trackingData, "pid", releasePid);
   }
-  tinyxml2::XMLElement* seq = pElement->FirstChildElement("seq");
-  if (!seq) {
-    kodi::Log(ADDON_LOG_ERROR, "No seq found");
+  return true;
+}
+
+bool CPVRMagenta2::ResolveStream(const std::string& mediaUrl, Magenta2Stream& stream, const bool silent)
+{
+  stream.lock = {};
+  stream.validUntil = 0;
+  GetStreamParameters(mediaUrl + "?format=SMIL&formats=MPEG-DASH&tracking=true&clientId=player_" + m_deviceId,
+                      stream.src, stream.releasePid, stream.lock, silent);
+  if (stream.src.empty())
     return false;
+  stream.validUntil = time(nullptr) + ZAP_PREFETCH_TTL;
+  return true;
+}
+
+void CPVRMagenta2::ActivateStream(const Magenta2Stream& stream)
+{
+  Magenta2Lock previous;
+  {
+    std::lock_guard<std::mutex> lock(m_zapMutex);
+    previous = m_currentLock;
+    m_currentLock = stream.lock;
+  }
+  m_concurrencyClient->Track(stream.lock, true);
+  // the new stream is already set up, the old lock does not need to block the zap
+  if (previous.id != stream.lock.id)
+    m_concurrencyClient->Release(previous);
+}
+
+void CPVRMagenta2::CloseStream()
+{
+  Magenta2Lock current;
+  {
+    std::lock_guard<std::mutex> lock(m_zapMutex);
+    current = m_currentLock;
+    m_currentLock = {};
   }
-  tinyxml2::XMLElement* reffailed = seq->FirstChildElement("ref");
-  tinyxml2::XMLElement* switchgood = seq->FirstChildElement("switch");
-  std::string value;
-  std::string trackingData;
-  releasePid.clear();
-  src.clear();
-  trackingData.clear();
-  if (reffailed) {
-    src = reffailed->Attribute("src");
-    kodi::Log(ADDON_LOG_DEBUG, "SRC: %s", src.c_str());
-    std::string title = reffailed->Attribute("title");
-    kodi::Log(ADDON_LOG_DEBUG, "Title: %s", title.c_str());
-    std::string abstract = reffailed->Attribute("abstract");
-    kodi::Log(ADDON_LOG_DEBUG, "Abstract: %s", abstract.c_str());
-    tinyxml2::XMLElement* pParm = reffailed->FirstChildElement("param");
-    bool isException = false;
-    int responseCode = 0;
-    while (pParm) {
-      name = pParm->Attribute("name");
-      value = pParm->Attribute("value");
-      kodi::Log(ADDON_LOG_DEBUG, "Param Name: %s Value: %s", name.c_str(), value.c_str());
-      if ((name == "isException") && (value == "true"))
-        isException = true;
-      if (name == "responseCode")
-      {
-        try {
-          responseCode = std::stoi(value);
-        } catch (const std::exception& e) {}
-      }
-      pParm = pParm->NextSiblingElement();
-    }
-    if (isException)
-      kodi::gui::dialogs::OK::ShowAndGetInput(title, abstract);
+  m_concurrencyClient->Release(current);
+}
+
+bool CPVRMagenta2::TakePrefetchedStream(const int& channelUid, Magenta2Stream& stream)
+{
+  std::lock_guard<std::mutex> lock(m_zapMutex);
+  auto it = m_zapStreams.find(channelUid);
+  if (it == m_zapStreams.end())
     return false;
-  } else if (switchgood) {
-    tinyxml2::XMLElement* refgood = switchgood->FirstChildElement("ref");
-    src = refgood->Attribute("src");
-    tinyxml2::XMLElement* ppParm = refgood->FirstChildElement("param");
-    if (ppParm) {
-      name = ppParm->Attribute("name");
-      value = ppParm->Attribute("value");
-      if (name == "trackingData") {
-        trackingData = value;
-        kodi::Log(ADDON_LOG_DEBUG, "Tracking Data: %s", trackingData.c_str());
-        std::vector<std::string> out;
-        tokenize2(trackingData, "|", out);
-        for (const auto& data : out)
-        {
-    //      kodi::Log(ADDON_LOG_DEBUG, "Tracking Data: %s", data.c_str());
-          if (data.substr(0,4) == "pid=") {
-            releasePid = data;
-            releasePid.erase(0,4);
-          }
-        }
+  stream = it->second;
+  m_zapStreams.erase(it);
+  return stream.validUntil > time(nullptr);
+}
+
+void CPVRMagenta2::ReleasePrefetchedStreams(const std::set<int>& keep)
+{
+  std::vector<Magenta2Lock> locks;
+  {
+    std::lock_guard<std::mutex> lock(m_zapMutex);
+    time_t now = time(nullptr);
+    for (auto it = m_zapStreams.begin(); it != m_zapStreams.end();)
+    {
+      if ((keep.find(it->first) == keep.end()) || (it->second.validUntil <= now))
+      {
+        locks.emplace_back(it->second.lock);
+        it = m_zapStreams.erase(it);
       }
+      else
+        ++it;
     }
-  } else {
-    kodi::Log(ADDON_LOG_ERROR, "Unknown structure");
-    return false;
   }
-  return true;
+  for (const auto& unused : locks)
+    m_concurrencyClient->Release(unused);
 }
 
-bool CPVRMagenta2::ReleaseLock()
+std::string CPVRMagenta2::GetChannelMediaUrl(const Magenta2Channel& channel)
 {
-  kodi::Log(ADDON_LOG_DEBUG, "function call: [%s]", __FUNCTION__);
-  if (m_currentLock.serviceUrl.empty())
-    return false;
+  return m_basicUrlSelectorService + m_accountPid + "/media/" + channel.mediaPath;
+}
 
-  std::string url = m_currentLock.serviceUrl + "/web/Concurrency/unlock?_clientId=" + m_deviceId +
-                                               "&_encryptedLock=" + Utils::UrlEncode(m_currentLock.lock) +
-                                               "&_id=" + Utils::UrlEncode(m_currentLock.id) +
-                                               "&_sequenceToken=" + Utils::UrlEncode(m_currentLock.token) +
-                                               "&form=json&schema=1.0";
+void CPVRMagenta2::PrefetchStreams(const int channelUid)
+{
+  std::vector<std::pair<int, int>> usage;
+  {
+    std::lock_guard<std::mutex> lock(m_zapMutex);
+    for (const auto& count : m_zapCounts)
+    {
+      if (count.first != channelUid)
+        usage.emplace_back(count.second, count.first);
+    }
+  }
+  std::sort(usage.rbegin(), usage.rend());
 
-  rapidjson::Document doc;
-  if (!GetPostJson(url, "", doc)) {
-    return false;
+  // copies, the list may change while the selector requests are running
+  std::vector<Magenta2Channel> candidates;
+  {
+    std::lock_guard<std::mutex> lock(m_channelsMutex);
+    int position = -1;
+    for (size_t i = 0; i < m_channels.size(); i++)
+    {
+      if (m_channels[i].iUniqueId == channelUid)
+        position = static_cast<int>(i);
+    }
+    if (position == -1)
+      return;
+
+    // neighbours in list order, skipping channels that are not playable
+    for (int direction = -1; direction <= 1; direction += 2)
+    {
+      int found = 0;
+      for (int i = position + direction;
+           (i >= 0) && (i < static_cast<int>(m_channels.size())) && (found < ZAP_PREFETCH_NEIGHBOURS);
+           i += direction)
+      {
+        if (m_channels[i].isHidden || m_channels[i].bRadio)
+          continue;
+        candidates.emplace_back(m_channels[i]);
+        found++;
+      }
+    }
+
+    for (size_t i = 0; (i < usage.size()) && (i < static_cast<size_t>(ZAP_PREFETCH_MOST_USED)); i++)
+    {
+      for (const auto& channel : m_channels)
+      {
+        if (channel.iUniqueId == usage[i].second)
+          candidates.emplace_back(channel);
+      }
+    }
   }
 
-  return true;
+  std::set<int> keep;
+  for (const auto& candidate : candidates)
+    keep.insert(candidate.iUniqueId);
+  ReleasePrefetchedStreams(keep);
+
+  for (const auto& candidate : candidates)
+  {
+    {
+      std::lock_guard<std::mutex> lock(m_zapMutex);
+      if ((m_zapStreams.find(candidate.iUniqueId) != m_zapStreams.end()) ||
+          (m_lockedChannels.find(candidate.iUniqueId) != m_lockedChannels.end()))
+        continue;
+    }
+    Magenta2Stream stream;
+    // nobody asked for this channel yet, errors must not pop up a dialog
+    if (!ResolveStream(GetChannelMediaUrl(candidate), stream, true))
+      continue;
+    // a concurrency lock would occupy one of the account's streams for a channel
+    // that is not watched, give it back and do not resolve this channel ahead again
+    if (!stream.lock.serviceUrl.empty())
+    {
+      m_concurrencyClient->Release(stream.lock);
+      std::lock_guard<std::mutex> lock(m_zapMutex);
+      m_lockedChannels.insert(candidate.iUniqueId);
+      DEBUG_LOG("Not prefetching channel %s, its stream is locked", candidate.strChannelName.c_str());
+      continue;
+    }
+    std::lock_guard<std::mutex> lock(m_zapMutex);
+    m_zapStreams[candidate.iUniqueId] = stream;
+    DEBUG_LOG("Prefetched stream for channel %s", candidate.strChannelName.c_str());
+  }
+  // prefetched streams nobody zapped to are dropped once they expire
+  m_taskQueue.Schedule("zap-expire", static_cast<int>(ZAP_PREFETCH_TTL) * 1000,
+                       [this]() { ReleasePrefetchedStreams({}); });
 }
 
 PVR_ERROR CPVRMagenta2::SetStreamProperties(std::vector<kodi::addon::PVRStreamProperty>& properties,
                                     const std::string& url,
-                                    bool realtime, bool playTimeshiftBuffer, bool epgplayback)
+                                    bool realtime, bool playTimeshiftBuffer, bool epgplayback,
+                                    const int channelUid)
 {
+  TRACE_SCOPE("magenta2", __FUNCTION__);
+  Magenta2Stream stream;
+  if (!ResolveStream(url, stream, false)) {
+    return PVR_ERROR_FAILED;
+  }
+  ActivateStream(stream);
+  return SetStreamProperties(properties, stream, realtime, playTimeshiftBuffer, epgplayback, channelUid);
+}
+
+PVR_ERROR CPVRMagenta2::SetStreamProperties(std::vector<kodi::addon::PVRStreamProperty>& properties,
+                                    const Magenta2Stream& stream,
+                                    bool realtime, bool playTimeshiftBuffer, bool epgplayback,
+                                    const int channelUid)
+{
+  TRACE_SCOPE("magenta2", __FUNCTION__);
   properties.emplace_back(PVR_STREAM_PROPERTY_ISREALTIMESTREAM, realtime ? "true" : "false");
   properties.emplace_back(PVR_STREAM_PROPERTY_EPGPLAYBACKASLIVE, epgplayback ? "true" : "false");
 
-  std::string src;
-  std::string releasePid;
-  GetStreamParameters(url + "?format=SMIL&formats=MPEG-DASH&tracking=true&clientId=player_" + m_deviceId, src, releasePid);
-  if (src.empty()) {
-    return PVR_ERROR_FAILED;
-  }
-  if (src.find("begin=") != std::string::npos)
+  std::string src = stream.src;
+  const std::string& releasePid = stream.releasePid;
+  size_t beginPos = src.find("begin=");
+  if (beginPos != std::string::npos)
   {
-    std::string begin = src.substr(src.find("begin=") + 6, 15);
-    std::string end = src.substr(src.find("end=") + 4, 15);
-    PrepareTime(begin);
-    PrepareTime(end);
-    time_t beginTime = Utils::StringToTime2(begin);
-    kodi::Log(ADDON_LOG_DEBUG, "Begin time: %s / %u end time: %s / %u", begin.c_str(), beginTime, end.c_str(), Utils::StringToTime2(end));
-    if (time(NULL) - TIMEBUFFER2 > beginTime)
+    size_t endPos = src.find("end=");
+    if (realtime && (channelUid != TIMESHIFT_ANY_CHANNEL))
+    {
+      // on live streams an end mark in the past is where the backend buffer currently stops
+      time_t endTime = (endPos != std::string::npos) ? Utils::StringToTime3(src.substr(endPos + 4, 15)) : 0;
+      if ((endTime > 0) && (endTime < m_timeshiftWindow.Now()))
+        m_timeshiftWindow.UpdateLiveEdge(channelUid, endTime);
+      else
+        m_timeshiftWindow.ResetLiveEdge(channelUid);
+    }
+    time_t beginTime = Utils::StringToTime3(src.substr(beginPos + 6, 15));
+    time_t newBeginTime = m_timeshiftWindow.ClampBegin(channelUid, beginTime);
+    if (newBeginTime != beginTime)
     {
-      std::string newBegin = Utils::TimeToString3(time(NULL) - TIMEBUFFER2 + 10);
-      kodi::Log(ADDON_LOG_DEBUG, "New begin time: %s", newBegin.c_str());
-      src.replace(src.find("begin=") + 6, 15, newBegin);
+      std::string newBegin = Utils::TimeToString3(newBeginTime);
+      DEBUG_LOG("New begin time: %s", newBegin.c_str());
+      src.replace(beginPos + 6, 15, newBegin);
     }
   }
   properties.emplace_back(PVR_STREAM_PROPERTY_STREAMURL, src);
-  kodi::Log(ADDON_LOG_DEBUG, "[PLAY STREAM] url: %s", src.c_str());
+  DEBUG_LOG("[PLAY STREAM] url: %s", src.c_str());
   if (!releasePid.empty()) {
     std::string personaToken;
     if (!m_authClient->GetPersonaToken(personaToken))
       return PVR_ERROR_FAILED;
 
     personaToken = base64_decode(personaToken);
-    kodi::Log(ADDON_LOG_DEBUG, "PersonaToken: %s", personaToken.c_str());
+    DEBUG_LOG("PersonaToken: %s", DebugLog::Redact(personaToken).c_str());
     personaToken.erase(0, m_accountBaseUrl.length());
     std::string account = m_accountBaseUrl + personaToken.substr(0, personaToken.find(":"));
-    kodi::Log(ADDON_LOG_DEBUG, "Account: %s", account.c_str());
+    DEBUG_LOG("Account: %s", account.c_str());
     personaToken.erase(0, personaToken.find(":") + 1);
-    kodi::Log(ADDON_LOG_DEBUG, "Token: %s", personaToken.c_str());
+    DEBUG_LOG("Token: %s", DebugLog::Redact(personaToken).c_str());
 
-    kodi::Log(ADDON_LOG_DEBUG, "ReleasePid: %s", releasePid.c_str());
+    DEBUG_LOG("ReleasePid: %s", releasePid.c_str());
 
     std::string lkey = m_widevineLicenseAcquisitionUrl + "?account=" + Utils::UrlEncode(account) +
                                                          "&releasePid=" + releasePid +
@@ -955,7 +1186,7 @@ PVR_ERROR CPVRMagenta2::SetStreamProperties(std::vector<kodi::addon::PVRStreamPr
 //            "&Authorization=Basic " + personaToken +
             "&Content-Type= "
             "|R{SSM}|";
-    kodi::Log(ADDON_LOG_DEBUG, "Licence Key: %s", lkey.c_str());
+    DEBUG_LOG("Licence Key: %s", DebugLog::RedactParameters(lkey).c_str());
     properties.emplace_back(PVR_STREAM_PROPERTY_MIMETYPE, "application/xml+dash");
     properties.emplace_back(PVR_STREAM_PROPERTY_INPUTSTREAM, "inputstream.adaptive");
     properties.emplace_back("inputstream.adaptive.manifest_headers", "User-Agent=" + Magenta2Parameters[m_platform].user_agent);
@@ -966,8 +1197,8 @@ PVR_ERROR CPVRMagenta2::SetStreamProperties(std::vector<kodi::addon::PVRStreamPr
     if (lkey.length() > CUTOFF) {
         urlFirst = lkey.substr(0,CUTOFF);
         urlSecond = lkey.substr(CUTOFF,std::string::npos);
-        kodi::Log(ADDON_LOG_DEBUG, "First %s", urlFirst.c_str());
-        kodi::Log(ADDON_LOG_DEBUG, "Second %s", urlSecond.c_str());
+        DEBUG_LOG("First %s", urlFirst.c_str());
+        DEBUG_LOG("Second %s", urlSecond.c_str());
         properties.emplace_back("inputstream.adaptive.license_url", urlFirst);
         properties.emplace_back("inputstream.adaptive.license_url_append", urlSecond);
     }
@@ -1000,28 +1231,72 @@ bool CPVRMagenta2::GetChannelNamebyId(const std::string& id, std::string& name)
 
 PVR_ERROR CPVRMagenta2::GetChannelsAmount(int& amount)
 {
-  kodi::Log(ADDON_LOG_DEBUG, "function call: [%s]", __FUNCTION__);
+  TRACE_SCOPE("magenta2", __FUNCTION__);
+  DEBUG_LOG("function call: [%s]", __FUNCTION__);
+  m_startup.Wait("channels");
 
   amount = m_channels.size();
   std::string amount_str = std::to_string(amount);
-  kodi::Log(ADDON_LOG_DEBUG, "Channels Amount: [%s]", amount_str.c_str());
+  DEBUG_LOG("Channels Amount: [%s]", amount_str.c_str());
   return PVR_ERROR_NO_ERROR;
 }
 
 std::string CPVRMagenta2::GetNgissUrl(const std::string& url, const int& width, const int& height)
 {
-  return m_ngiss.basicUrl + "iss/?" +
-         m_ngiss.callParameter + "&ar=keep" +
-         "&src=" + Utils::UrlEncode(url) +
-         "&x=" + std::to_string(width) +
-         "&y=" + std::to_string(height);
+  // the same few images come back with every EPG and recordings refresh
+  std::string key = url + "|" + std::to_string(width) + "x" + std::to_string(height);
+  std::lock_guard<std::mutex> lock(m_ngissMutex);
+  auto it = m_ngissUrls.find(key);
+  if (it != m_ngissUrls.end())
+    return it->second;
+
+  std::string ngissUrl = m_ngiss.basicUrl + "iss/?" +
+                         m_ngiss.callParameter + "&ar=keep" +
+                         "&src=" + Utils::UrlEncode(url) +
+                         "&x=" + std::to_string(width) +
+                         "&y=" + std::to_string(height);
+  // pictures of past programs are not asked for again, start over instead of growing forever
+  if (m_ngissUrls.size() >= MAX_NGISS_URLS)
+    m_ngissUrls.clear();
+  m_ngissUrls.emplace(key, ngissUrl);
+  return ngissUrl;
+}
+
+void CPVRMagenta2::UpdateChannelIcons()
+{
+  m_startup.Wait("channels");
+  SetChannelIcons();
+}
+
+void CPVRMagenta2::SetChannelIcons()
+{
+  const std::string logoTitle = m_settings->UseWhiteLogos() ? "stationLogo.png" : "stationLogoColored.png";
+  std::lock_guard<std::mutex> lock(m_channelsMutex);
+  for (auto& channel : m_channels)
+  {
+    channel.strIconPath = "";
+    if (channel.thumbnails.empty())
+      continue;
+    int pictureNo = 0;
+    for (int i=0; i<channel.thumbnails.size(); i++)
+    {
+      if (channel.thumbnails[i].title == logoTitle)
+        pictureNo = i;
+    }
+    channel.strIconPath = GetNgissUrl(channel.thumbnails[pictureNo].url,
+                                      channel.thumbnails[pictureNo].width,
+                                      channel.thumbnails[pictureNo].height);
+  }
 }
 
 PVR_ERROR CPVRMagenta2::GetChannels(bool bRadio, kodi::addon::PVRChannelsResultSet& results)
 {
-  kodi::Log(ADDON_LOG_DEBUG, "function call: [%s]", __FUNCTION__);
+  TRACE_SCOPE("magenta2", __FUNCTION__);
+  DEBUG_LOG("function call: [%s]", __FUNCTION__);
+  m_startup.Wait("channels");
 
   int startnum = m_settings->GetStartNum()-1;
+  std::lock_guard<std::mutex> lock(m_channelsMutex);
   for (const auto& channel : m_channels)
   {
 
@@ -1034,18 +1309,7 @@ PVR_ERROR CPVRMagenta2::GetChannels(bool bRadio, kodi::addon::PVRChannelsResultS
       kodiChannel.SetChannelNumber(static_cast<unsigned int>(startnum + channel.iChannelNumber));
       kodiChannel.SetChannelName(channel.strChannelName);
 
-      int pictureNo = 0;
-      for (int i=0; i<channel.thumbnails.size(); i++)
-      {
-        if ((m_settings->UseWhiteLogos() && channel.thumbnails[i].title == "stationLogo.png") ||
-            (!m_settings->UseWhiteLogos() && channel.thumbnails[i].title == "stationLogoColored.png"))
-          pictureNo = i;
-      }
-      std::string iconUrl = GetNgissUrl(channel.thumbnails[pictureNo].url,
-                                        channel.thumbnails[pictureNo].width,
-                                        channel.thumbnails[pictureNo].height);
-//      kodi::Log(ADDON_LOG_DEBUG, "Icon Url: %s", iconUrl.c_str());
-      kodiChannel.SetIconPath(iconUrl);
+      kodiChannel.SetIconPath(channel.strIconPath);
       kodiChannel.SetIsHidden(channel.isHidden);
       kodiChannel.SetHasArchive(false);
 
@@ -1059,18 +1323,51 @@ PVR_ERROR CPVRMagenta2::GetChannels(bool bRadio, kodi::addon::PVRChannelsResultS
 PVR_ERROR CPVRMagenta2::GetChannelStreamProperties(
     const kodi::addon::PVRChannel& channel, std::vector<kodi::addon::PVRStreamProperty>& properties)
 {
-  kodi::Log(ADDON_LOG_DEBUG, "function call: [%s]", __FUNCTION__);
+  TRACE_SCOPE("magenta2", __FUNCTION__);
+  DEBUG_LOG("function call: [%s]", __FUNCTION__);
+  m_startup.Wait("channels");
 
   for (const auto& mychannel : m_channels)
   {
     if (channel.GetUniqueId() == mychannel.iUniqueId)
     {
-      ReleaseLock();
-      std::string streamUrl = m_basicUrlSelectorService + m_accountPid + "/media/" + mychannel.mediaPath;
+      std::string streamUrl = GetChannelMediaUrl(mychannel);
       // + "?format=SMIL&formats=MPEG-DASH&tracking=true";
-      kodi::Log(ADDON_LOG_DEBUG, "Stream URL -> %s", streamUrl.c_str());
+      DEBUG_LOG("Stream URL -> %s", streamUrl.c_str());
+
+      Magenta2Stream stream;
+      if (TakePrefetchedStream(mychannel.iUniqueId, stream))
+      {
+        DEBUG_LOG("Using prefetched stream");
+      }
+      else
+      {
+        m_concurrencyClient->Release(stream.lock);
+        if (!ResolveStream(streamUrl, stream, false))
+        {
+          // the concurrency limit may be reached by our own locks, give them back and retry once
+          {
+            std::lock_guard<std::mutex> lock(m_zapMutex);
+            m_currentLock = {};
+            m_zapStreams.clear();
+          }
+          m_concurrencyClient->ReleaseAll();
+          if (!ResolveStream(streamUrl, stream, false))
+            return PVR_ERROR_FAILED;
+        }
+      }
+      ActivateStream(stream);
+      {
+        std::lock_guard<std::mutex> lock(m_zapMutex);
+        m_zapCounts[mychannel.iUniqueId]++;
+        if (!stream.lock.serviceUrl.empty())
+          m_lockedChannels.insert(mychannel.iUniqueId);
+      }
+      // only prefetch once the user has settled on a channel
+      int channelUid = mychannel.iUniqueId;
+      m_taskQueue.Schedule("zap-prefetch", ZAP_PREFETCH_DELAY, [this, channelUid]() { PrefetchStreams(channelUid); });
 
-      return SetStreamProperties(properties, streamUrl, true, false, false);
+      return SetStreamProperties(properties, stream, true, false, false, channelUid);
     }
   }
   return PVR_ERROR_FAILED;
@@ -1106,7 +1403,7 @@ bool CPVRMagenta2::GetGenre(int& primaryType, int& secondaryType, const std::str
           secondaryType = 0;
       } else
         secondaryType = 0;
-      kodi::Log(ADDON_LOG_DEBUG, "Returning genre %i and subgenre %i for primary %s and secondary %s", primaryType, secondaryType, primaryGenre.c_str(), secondaryGenre.c_str());
+      DEBUG_LOG_LIMITED(1, 20, "Returning genre %i and subgenre %i for primary %s and secondary %s", primaryType, secondaryType, primaryGenre.c_str(), secondaryGenre.c_str());
       return true;
     }
   }
@@ -1138,7 +1435,7 @@ void CPVRMagenta2::SetGenreTypes(const rapidjson::Value& item, std::string& prim
         //Todo for later
       } else
       {
-        kodi::Log(ADDON_LOG_DEBUG, "Unknown scheme type: %s with title: %s", scheme.c_str(), title.c_str());
+        DEBUG_LOG("Unknown scheme type: %s with title: %s", scheme.c_str(), title.c_str());
       }
     }
     if (!primary.empty())
@@ -1148,27 +1445,22 @@ void CPVRMagenta2::SetGenreTypes(const rapidjson::Value& item, std::string& prim
   }
 }
 
-void CPVRMagenta2::AddEPGEntry(const int& channelNumber, const rapidjson::Value& epgItem, kodi::addon::PVREPGTagsResultSet& results)
+bool CPVRMagenta2::ParseProgram(const rapidjson::Value& epgItem, Magenta2Program& program)
 {
-  kodi::addon::PVREPGTag tag;
-
-  unsigned int epg_tag_flags = EPG_TAG_FLAG_UNDEFINED;
-  int guid;
+  program.guid = Utils::JsonStringOrEmpty(epgItem, "guid");
   try {
-    guid = stoi(Utils::JsonStringOrEmpty(epgItem, "guid").substr(11, std::string::npos), 0, 16);
+    program.broadcastId = static_cast<unsigned int>(stoi(program.guid.substr(11, std::string::npos), 0, 16));
   }
   catch (const std::exception& e) {
-    return;
+    return false;
   }
-  tag.SetUniqueBroadcastId(static_cast<unsigned int>(guid));
-  tag.SetUniqueChannelId(static_cast<unsigned int>(channelNumber));
-  tag.SetTitle(Utils::JsonStringOrEmpty(epgItem, "title"));
-  std::string title = Utils::JsonStringOrEmpty(epgItem, "title");
-  kodi::Log(ADDON_LOG_DEBUG, "Adding EPG item: %s", title.c_str());
 
-  tag.SetPlot(Utils::JsonStringOrEmpty(epgItem, "description"));
-  tag.SetPlotOutline(Utils::JsonStringOrEmpty(epgItem, "shortDescription"));
+  unsigned int epg_tag_flags = EPG_TAG_FLAG_UNDEFINED;
+  program.title = Utils::JsonStringOrEmpty(epgItem, "title");
+  program.plot = Utils::JsonStringOrEmpty(epgItem, "description");
+  program.plotOutline = Utils::JsonStringOrEmpty(epgItem, "shortDescription");
 
+  program.iconPath = "";
   if (epgItem.HasMember("thumbnails"))
   {
     const rapidjson::Value& thumbnails = epgItem["thumbnails"];
@@ -1182,122 +1474,243 @@ void CPVRMagenta2::AddEPGEntry(const int& channelNumber, const rapidjson::Value&
         int width = Utils::JsonIntOrZero(thumbnailsItem, "width");
         int height = Utils::JsonIntOrZero(thumbnailsItem, "height");
         if ((width == 0) && (height == 0))
-          tag.SetIconPath(Utils::JsonStringOrEmpty(thumbnailsItem, "url"));
+          program.iconPath = Utils::JsonStringOrEmpty(thumbnailsItem, "url");
         else
-          tag.SetIconPath(GetNgissUrl(Utils::JsonStringOrEmpty(thumbnailsItem, "url"), width, height));
+          program.iconPath = GetNgissUrl(Utils::JsonStringOrEmpty(thumbnailsItem, "url"), width, height);
       }
     }
   }
 
-  int seasonNum = Utils::JsonIntOrZero(epgItem, "tvSeasonNumber");
-  if (seasonNum != 0)
-  {
-    tag.SetSeriesNumber(seasonNum);
+  program.seriesNumber = Utils::JsonIntOrZero(epgItem, "tvSeasonNumber");
+  if (program.seriesNumber != 0)
     epg_tag_flags += EPG_TAG_FLAG_IS_SERIES;
-  }
-  int episodeNum = Utils::JsonIntOrZero(epgItem, "tvSeasonEpisodeNumber");
-  if (episodeNum != 0)
-    tag.SetEpisodeNumber(episodeNum);
-  tag.SetYear(Utils::JsonIntOrZero(epgItem, "year"));
-  tag.SetEpisodeName(Utils::JsonStringOrEmpty(epgItem, "secondaryTitle"));
-  std::string seriesId = Utils::JsonStringOrEmpty(epgItem, "seriesId");
-  if (!seriesId.empty())
-    tag.SetSeriesLink(seriesId);
+  program.episodeNumber = Utils::JsonIntOrZero(epgItem, "tvSeasonEpisodeNumber");
+  program.year = Utils::JsonIntOrZero(epgItem, "year");
+  program.episodeName = Utils::JsonStringOrEmpty(epgItem, "secondaryTitle");
+  program.seriesLink = Utils::JsonStringOrEmpty(epgItem, "seriesId");
 
+  program.parentalRating = 0;
   if (epgItem.HasMember("ratings") && epgItem["ratings"].GetType() != 0)
   {
     const rapidjson::Value& ratings = epgItem["ratings"];
     if (ratings.Size() > 0) {
       std::string ratingStr = Utils::JsonStringOrEmpty(ratings[0], "rating");
-      int rating = 0;
       try {
-        rating = stoi(ratingStr);
+        program.parentalRating = stoi(ratingStr);
       } catch (const std::exception& e) {}
-      if (rating > 0)
-        tag.SetParentalRating(rating);
     }
   }
 
+  program.publicUrl = "";
+  program.availableFrom = 0;
+  program.availableUntil = 0;
+  program.mediaCheckedAt = time(nullptr);
+  if (epgItem.HasMember("media") && epgItem["media"].IsArray() && (epgItem["media"].Size() > 0))
+  {
+    const rapidjson::Value& media = epgItem["media"][0];
+    program.publicUrl = Utils::JsonStringOrEmpty(media, "publicUrl");
+    program.availableFrom = (time_t) (Utils::JsonInt64OrZero(media, "availableDate") / 1000);
+    program.availableUntil = (time_t) (Utils::JsonInt64OrZero(media, "expirationDate") / 1000);
+  }
+
+  program.imdbNumber = "";
   if (epgItem.HasMember("dt$originalIds") && epgItem["dt$originalIds"].GetType() != 0)
   {
     const rapidjson::Value& originalIds = epgItem["dt$originalIds"];
-    std::string imdbNumber = Utils::JsonStringOrEmpty(originalIds, "imdb");
-    if (!imdbNumber.empty())
-      tag.SetIMDBNumber(imdbNumber);
+    program.imdbNumber = Utils::JsonStringOrEmpty(originalIds, "imdb");
   }
 
+  program.cast = "";
+  program.director = "";
+  program.writer = "";
   if (epgItem.HasMember("credits")) {
     const rapidjson::Value& credits = epgItem["credits"];
-    std::string cast = "";
-    std::string director = "";
-    std::string writer = "";
     for (rapidjson::SizeType i = 0; i < credits.Size(); i++)
     {
       std::string creditType = Utils::JsonStringOrEmpty(credits[i], "creditType");
       if (creditType == "DIRECTOR")
       {
-        if (director != "")
-          director += EPG_STRING_TOKEN_SEPARATOR;
-        director += Utils::JsonStringOrEmpty(credits[i], "personName");
+        if (program.director != "")
+          program.director += EPG_STRING_TOKEN_SEPARATOR;
+        program.director += Utils::JsonStringOrEmpty(credits[i], "personName");
       } else if (creditType == "SCRIPTWRITER")
       {
-        if (writer != "")
-          writer += EPG_STRING_TOKEN_SEPARATOR;
-        writer += Utils::JsonStringOrEmpty(credits[i], "personName");
+        if (program.writer != "")
+          program.writer += EPG_STRING_TOKEN_SEPARATOR;
+        program.writer += Utils::JsonStringOrEmpty(credits[i], "personName");
       } else if ((creditType == "ACTOR") || (creditType == "AD6"))
       {
-        if (cast != "")
-          cast += EPG_STRING_TOKEN_SEPARATOR;
-        cast += Utils::JsonStringOrEmpty(credits[i], "personName");
+        if (program.cast != "")
+          program.cast += EPG_STRING_TOKEN_SEPARATOR;
+        program.cast += Utils::JsonStringOrEmpty(credits[i], "personName");
       } else if (creditType == "PRODUCER")
       {
 
       } else
       {
-        kodi::Log(ADDON_LOG_DEBUG, "Unknown Credit Type: %s Person Name: %s", creditType.c_str(), Utils::JsonStringOrEmpty(credits[i], "personName").c_str());
+        DEBUG_LOG_LIMITED(1, 20, "Unknown Credit Type: %s Person Name: %s", creditType.c_str(), Utils::JsonStringOrEmpty(credits[i], "personName").c_str());
       }
     }
-    tag.SetCast(cast);
-    tag.SetDirector(director);
-    tag.SetWriter(writer);
   }
 /*
   std::string programType = Utils::JsonStringOrEmpty(epgItem, "programType");
   if ((programType != "episode") && (programType != "movie"))
-    kodi::Log(ADDON_LOG_DEBUG, "Unknown program type %s", programType.c_str());
+    DEBUG_LOG("Unknown program type %s", programType.c_str());
 */
   std::string genre_primary = "";
   std::string genre_secondary = "";
   SetGenreTypes(epgItem, genre_primary, genre_secondary);
-  int primaryType;
-  int secondaryType;
-  if (GetGenre(primaryType, secondaryType, genre_primary, genre_secondary))
+  program.genreDescription = "";
+  if (!GetGenre(program.genreType, program.genreSubType, genre_primary, genre_secondary))
   {
-    tag.SetGenreType(primaryType);
-    tag.SetGenreSubType(secondaryType);
-  } else
+    DEBUG_LOG("Primary Genres: %s", genre_primary.c_str());
+    DEBUG_LOG("Secondary Genres: %s", genre_secondary.c_str());
+    program.genreType = EPG_GENRE_USE_STRING;
+    program.genreSubType = 0;
+    program.genreDescription = genre_secondary;
+  }
+
+  program.flags = epg_tag_flags;
+  return true;
+}
+
+void CPVRMagenta2::AddEPGEntry(const int& channelNumber, const Magenta2Program& program,
+                               const Magenta2Listing& listing, kodi::addon::PVREPGTagsResultSet& results)
+{
+  kodi::addon::PVREPGTag tag;
+
+  tag.SetUniqueBroadcastId(program.broadcastId);
+  tag.SetUniqueChannelId(static_cast<unsigned int>(channelNumber));
+  tag.SetTitle(program.title);
+  DEBUG_LOG_LIMITED(1, 20, "Adding EPG item: %s", program.title.c_str());
+
+  tag.SetPlot(program.plot);
+  tag.SetPlotOutline(program.plotOutline);
+  if (!program.iconPath.empty())
+    tag.SetIconPath(program.iconPath);
+  if (program.seriesNumber != 0)
+    tag.SetSeriesNumber(program.seriesNumber);
+  if (program.episodeNumber != 0)
+    tag.SetEpisodeNumber(program.episodeNumber);
+  tag.SetYear(program.year);
+  tag.SetEpisodeName(program.episodeName);
+  if (!program.seriesLink.empty())
+    tag.SetSeriesLink(program.seriesLink);
+  if (program.parentalRating > 0)
+    tag.SetParentalRating(program.parentalRating);
+  if (!program.imdbNumber.empty())
+    tag.SetIMDBNumber(program.imdbNumber);
+  tag.SetCast(program.cast);
+  tag.SetDirector(program.director);
+  tag.SetWriter(program.writer);
+  tag.SetGenreType(program.genreType);
+  if (program.genreType == EPG_GENRE_USE_STRING)
+    tag.SetGenreDescription(program.genreDescription);
+  else
+    tag.SetGenreSubType(program.genreSubType);
+  tag.SetFlags(program.flags);
+  tag.SetStartTime(listing.startTime);
+  tag.SetEndTime(listing.endTime);
+  results.Add(tag);
+}
+
+bool CPVRMagenta2::GetPrograms(const std::vector<std::string>& guids)
+{
+  std::string guidList = "";
+  for (const auto& guid : guids)
+    guidList += guid + "|";
+  if (guidList.empty())
+    return true;
+  guidList.erase(guidList.end() - 1);
+
+  std::string programsUrl = m_allProgramsFeedUrl + "?form=cjson" +
+                                                   "&byGuid=" + Utils::UrlEncode(guidList) +
+                                                   "&range=1-" + std::to_string(guids.size()) +
+                                                   "&fields=guid,title,description,"
+                                                   "thumbnails,tvSeasonNumber,tvSeasonEpisodeNumber,"
+                                                   "year,secondaryTitle,seriesId,ratings,dt$originalIds,"
+                                                   "credits.creditType,credits.personName,shortDescription,tags,"
+                                                   "media.publicUrl,media.availableDate,media.expirationDate"; //programType
+
+  rapidjson::Document doc;
+  if (!GetPostJson(programsUrl, "", doc)) {
+    return false;
+  }
+
+  if (!doc.HasMember("entries") || (doc["entries"].GetType() == 0))
   {
-    kodi::Log(ADDON_LOG_DEBUG, "Primary Genres: %s", genre_primary.c_str());
-    kodi::Log(ADDON_LOG_DEBUG, "Secondary Genres: %s", genre_secondary.c_str());
-    tag.SetGenreType(EPG_GENRE_USE_STRING);
-    tag.SetGenreDescription(genre_secondary);
+    kodi::Log(ADDON_LOG_ERROR, "Failed to get Programs feed");
+    return false;
   }
 
-  tag.SetFlags(epg_tag_flags);
+  const rapidjson::Value& entries = doc["entries"];
+  for (rapidjson::SizeType i = 0; i < entries.Size(); i++)
+  {
+    Magenta2Program program;
+    if (ParseProgram(entries[i], program))
+      m_programCache.Put(program);
+  }
+  return true;
+}
+
+bool CPVRMagenta2::GetProgramMedia(const std::vector<std::string>& guids)
+{
+  std::string guidList = "";
+  for (const auto& guid : guids)
+    guidList += guid + "|";
+  if (guidList.empty())
+    return true;
+  guidList.erase(guidList.end() - 1);
+
+  std::string programsUrl = m_allProgramsFeedUrl + "?form=cjson" +
+                                                   "&byGuid=" + Utils::UrlEncode(guidList) +
+                                                   "&range=1-" + std::to_string(guids.size()) +
+                                                   "&fields=guid,media.publicUrl,media.availableDate,media.expirationDate";
 
-  if (epgItem.HasMember("listings") && epgItem["listings"].GetType() != 0) {
-    const rapidjson::Value& listings = epgItem["listings"];
-    for (rapidjson::SizeType i = 0; i < listings.Size(); i++) {
-      tag.SetStartTime((time_t) (Utils::JsonInt64OrZero(listings[i], "startTime") / 1000));
-      tag.SetEndTime((time_t) (Utils::JsonInt64OrZero(listings[i], "endTime") / 1000));
-      results.Add(tag);
+  rapidjson::Document doc;
+  if (!GetPostJson(programsUrl, "", doc)) {
+    return false;
+  }
+
+  if (!doc.HasMember("entries") || (doc["entries"].GetType() == 0))
+  {
+    kodi::Log(ADDON_LOG_ERROR, "Failed to get Programs feed");
+    return false;
+  }
+
+  std::set<std::string> pending(guids.begin(), guids.end());
+  const rapidjson::Value& entries = doc["entries"];
+  for (rapidjson::SizeType i = 0; i < entries.Size(); i++)
+  {
+    std::string guid = Utils::JsonStringOrEmpty(entries[i], "guid");
+    std::string publicUrl;
+    time_t availableFrom = 0;
+    time_t availableUntil = 0;
+    if (entries[i].HasMember("media") && entries[i]["media"].IsArray() && (entries[i]["media"].Size() > 0))
+    {
+      const rapidjson::Value& media = entries[i]["media"][0];
+      publicUrl = Utils::JsonStringOrEmpty(media, "publicUrl");
+      availableFrom = (time_t) (Utils::JsonInt64OrZero(media, "availableDate") / 1000);
+      availableUntil = (time_t) (Utils::JsonInt64OrZero(media, "expirationDate") / 1000);
     }
+    m_programCache.UpdateMedia(guid, publicUrl, availableFrom, availableUntil);
+    pending.erase(guid);
   }
+  // programs the feed left out have no media yet, remember that they were checked
+  for (const auto& guid : pending)
+    m_programCache.UpdateMedia(guid, "", 0, 0);
+  return true;
+}
+
+bool CPVRMagenta2::IsMediaOutdated(const Magenta2Program& program, const time_t startTime)
+{
+  // media is attached once the broadcast started, a check from before that is outdated
+  return program.publicUrl.empty() && (program.mediaCheckedAt < startTime) && (time(nullptr) > startTime);
 }
 
 bool CPVRMagenta2::GetEPGFeed(const int& channelNumber, const std::string& baseUrl, kodi::addon::PVREPGTagsResultSet& results)
 {
-  kodi::Log(ADDON_LOG_DEBUG, "function call: [%s]", __FUNCTION__);
+  DEBUG_LOG("function call: [%s]", __FUNCTION__);
 
   rapidjson::Document doc;
   if (!GetPostJson(baseUrl, "", doc)) {
@@ -1310,60 +1723,69 @@ bool CPVRMagenta2::GetEPGFeed(const int& channelNumber, const std::string& baseU
     return false;
   }
 
-  std::string guids = "";
-  int entryCount = 0;
+  std::vector<Magenta2Listing> listingItems;
+  std::vector<std::string> unknownGuids;
+  std::vector<std::string> outdatedGuids;
+  std::set<std::string> requestedGuids;
+  Magenta2Program program;
   const rapidjson::Value& entries = doc["entries"];
   for (rapidjson::SizeType i = 0; i < entries.Size(); i++)
   {
     if (!entries[i].HasMember("listings") || (entries[i]["listings"].GetType() == 0))
     {
       kodi::Log(ADDON_LOG_ERROR, "Failed to get EPG listings");
-      //return false;
+      continue;
     }
     const rapidjson::Value& listings = entries[i]["listings"];
     for (rapidjson::SizeType j = 0; j < listings.Size(); j++)
     {
-  //    AddEPGEntry(channelNumber, listings[j], results);
-      if (listings[j].HasMember("program") && listings[j]["program"].GetType() != 0) {
-        const rapidjson::Value& program = listings[j]["program"];
-        guids += Utils::JsonStringOrEmpty(program, "guid") + "|";
-        entryCount++;
-      }
-      if ((entryCount == 300) || (j == listings.Size()-1))
-      {
-        guids.erase(guids.end() - 1);
-      //  kodi::Log(ADDON_LOG_DEBUG, "Guids found %s", guids.c_str());
-
-        std::string programsUrl = m_allProgramsFeedUrl + "?form=cjson" +
-                                                         "&byGuid=" + Utils::UrlEncode(guids) +
-                                                         "&range=1-" + std::to_string(entryCount) +
-                                                         "&fields=guid,title,description,listings.startTime,"
-                                                         "listings.endTime,thumbnails,tvSeasonNumber,tvSeasonEpisodeNumber,"
-                                                         "year,secondaryTitle,seriesId,ratings,dt$originalIds,"
-                                                         "credits.creditType,credits.personName,shortDescription,tags"; //programType
-
-        rapidjson::Document doc2;
-        if (!GetPostJson(programsUrl, "", doc2)) {
-          return false;
-        }
-
-        if (!doc2.HasMember("entries") || (doc2["entries"].GetType() == 0))
-        {
-          kodi::Log(ADDON_LOG_ERROR, "Failed to get Programs feed");
-          return false;
-        }
+      if (!listings[j].HasMember("program") || listings[j]["program"].GetType() == 0)
+        continue;
+      Magenta2Listing listing;
+      listing.guid = Utils::JsonStringOrEmpty(listings[j]["program"], "guid");
+      if (listing.guid.empty())
+        continue;
+      listing.startTime = static_cast<time_t>(Utils::JsonInt64OrZero(listings[j], "startTime") / 1000);
+      listing.endTime = static_cast<time_t>(Utils::JsonInt64OrZero(listings[j], "endTime") / 1000);
+      listingItems.emplace_back(listing);
+      if (!requestedGuids.insert(listing.guid).second)
+        continue;
+      if (!m_programCache.Get(listing.guid, program))
+        unknownGuids.emplace_back(listing.guid);
+      else if (IsMediaOutdated(program, listing.startTime))
+        outdatedGuids.emplace_back(listing.guid);
+    }
+  }
+  DEBUG_LOG("Channel %i has %i listings, %i programs not cached, %i without current media", channelNumber,
+            static_cast<int>(listingItems.size()), static_cast<int>(unknownGuids.size()),
+            static_cast<int>(outdatedGuids.size()));
 
-        const rapidjson::Value& entries2 = doc2["entries"];
-        for (rapidjson::SizeType k = 0; k < entries2.Size(); k++)
-        {
-          AddEPGEntry(channelNumber, entries2[k], results);
-        }
-        guids = "";
-        entryCount = 0;
-      }
+  bool success = true;
+  for (size_t first = 0; first < unknownGuids.size(); first += MAX_PROGRAM_GUIDS)
+  {
+    size_t last = std::min(first + MAX_PROGRAM_GUIDS, unknownGuids.size());
+    std::vector<std::string> batch(unknownGuids.begin() + first, unknownGuids.begin() + last);
+    if (!GetPrograms(batch))
+    {
+      success = false;
+      break;
     }
   }
-  return true;
+  // refresh the media of past broadcasts here, so the playable checks are answered from the cache
+  for (size_t first = 0; success && (first < outdatedGuids.size()); first += MAX_PROGRAM_GUIDS)
+  {
+    size_t last = std::min(first + MAX_PROGRAM_GUIDS, outdatedGuids.size());
+    std::vector<std::string> batch(outdatedGuids.begin() + first, outdatedGuids.begin() + last);
+    if (!GetProgramMedia(batch))
+      success = false;
+  }
+
+  for (const auto& listing : listingItems)
+  {
+    if (m_programCache.Get(listing.guid, program))
+      AddEPGEntry(channelNumber, program, listing, results);
+  }
+  return success;
 }
 
 PVR_ERROR CPVRMagenta2::GetEPGForChannel(int channelUid,
@@ -1371,132 +1793,130 @@ PVR_ERROR CPVRMagenta2::GetEPGForChannel(int channelUid,
                                          time_t end,
                                          kodi::addon::PVREPGTagsResultSet& results)
 {
-  kodi::Log(ADDON_LOG_DEBUG, "function call: [%s]", __FUNCTION__);
+  TRACE_SCOPE("magenta2", __FUNCTION__);
+  DEBUG_LOG("function call: [%s]", __FUNCTION__);
+  m_startup.Wait("auth");
+  m_startup.Wait("genres");
 
-  kodi::Log(ADDON_LOG_DEBUG, "Start %u End %u", start, end);
+  DEBUG_LOG("Start %u End %u", start, end);
 //  kodi::Log(ADDON_LOG_DEBUG, "EPG Request for channel %i from %s to %s", channelUid, startTime.c_str(), endTime.c_str());
 
   std::string baseUrl = m_allChannelSchedulesFeed + "?form=cjson&byLocationId=" + Utils::UrlEncode(m_locationIdUri) +
                                                     "&byListingTime=" + Utils::UrlEncode(Utils::TimeToString2(start) + "~" + Utils::TimeToString2(end)) +
                                                     "&byChannelNumber=" + std::to_string(channelUid) +
                                                     "&range=1-1" +
-                                                    "&fields=listings.program.guid";
+                                                    "&fields=listings.startTime,listings.endTime,listings.program.guid";
   GetEPGFeed(channelUid, baseUrl, results);
   return PVR_ERROR_NO_ERROR;
 }
 
-PVR_ERROR CPVRMagenta2::IsEPGTagPlayable(const kodi::addon::PVREPGTag& tag, bool& bIsPlayable)
+bool CPVRMagenta2::GetPlaybackInfo(const unsigned int broadcastId, PlaybackInfo& info)
 {
-  kodi::Log(ADDON_LOG_DEBUG, "function call: [%s]", __FUNCTION__);
-  bIsPlayable = false;
-
-  std::stringstream ss;
-  ss<< std::hex << tag.GetUniqueBroadcastId(); // int decimal_value
-  std::string epgId ( ss.str() );
+  std::string guid = GetProgramGuid(broadcastId);
+  if (m_playbackCache.Get(guid, info))
+    return true;
 
-  while (epgId.size() < 8)
-    epgId.insert(0, "0");
+  Magenta2Program program;
+  if (m_programCache.Get(guid, program) && !program.publicUrl.empty())
+  {
+    info.url = program.publicUrl;
+    info.availableFrom = program.availableFrom;
+    info.availableUntil = program.availableUntil;
+    m_playbackCache.Put(guid, info);
+    return true;
+  }
 
-  kodi::Log(ADDON_LOG_DEBUG, "Checking if EPGTag with UID: %s is playable", epgId.c_str());
+  DEBUG_LOG("Get playback info for %s", guid.c_str());
 
   std::string programsUrl = m_allProgramsFeedUrl + "?form=cjson" +
-                                                   "&byGuid=" + "telekom.de-" + epgId +
+                                                   "&byGuid=" + guid +
                                                    "&range=1-1" +
                                                    "&fields=media.publicUrl,media.availableDate," +
                                                    "media.expirationDate"; //programType
 
   rapidjson::Document doc;
   if (!GetPostJson(programsUrl, "", doc)) {
-    return PVR_ERROR_NO_ERROR;
+    return false;
   }
 
   if (!doc.HasMember("entries"))
   {
     kodi::Log(ADDON_LOG_ERROR, "Failed to get Programs feed");
-    return PVR_ERROR_NO_ERROR;
+    return false;
   }
 
   const rapidjson::Value& entries = doc["entries"];
 
-  if (entries.Size() != 1)
-    return PVR_ERROR_NO_ERROR;
-
-  if (!entries[0].HasMember("media"))
-    return PVR_ERROR_NO_ERROR;
-
-  const rapidjson::Value& media = entries[0]["media"];
-
-  if (media.Size() == 0)
-    return PVR_ERROR_NO_ERROR;
-
-  if (!media[0].HasMember("publicUrl") || !media[0].HasMember("availableDate") || !media[0].HasMember("expirationDate"))
-    return PVR_ERROR_NO_ERROR;
-
-  time_t availableDate = (time_t) (Utils::JsonInt64OrZero(media[0], "availableDate") / 1000);
-  time_t expirationDate = (time_t) (Utils::JsonInt64OrZero(media[0], "expirationDate") / 1000);
-  std::string publicUrl = Utils::JsonStringOrEmpty(media[0], "publicUrl");
-  auto current_time = time(NULL);
-
-  if (current_time > availableDate && current_time < expirationDate && !publicUrl.empty())
+  info.url.clear();
+  info.availableFrom = 0;
+  info.availableUntil = 0;
+  if ((entries.Size() == 1) && entries[0].HasMember("media"))
   {
-    kodi::Log(ADDON_LOG_DEBUG, "Found public URL: %s", publicUrl.c_str());
-    bIsPlayable = true;
+    const rapidjson::Value& media = entries[0]["media"];
+    if (media.Size() != 0)
+    {
+      info.url = Utils::JsonStringOrEmpty(media[0], "publicUrl");
+      info.availableFrom = (time_t) (Utils::JsonInt64OrZero(media[0], "availableDate") / 1000);
+      info.availableUntil = (time_t) (Utils::JsonInt64OrZero(media[0], "expirationDate") / 1000);
+    }
   }
-
-  return PVR_ERROR_NO_ERROR;
+  // a program without media is cached as well, Kodi asks again right away
+  m_playbackCache.Put(guid, info);
+  m_programCache.UpdateMedia(guid, info.url, info.availableFrom, info.availableUntil);
+  return true;
 }
 
-PVR_ERROR CPVRMagenta2::GetEPGTagStreamProperties(
-    const kodi::addon::PVREPGTag& tag, std::vector<kodi::addon::PVRStreamProperty>& properties)
+std::string CPVRMagenta2::GetProgramGuid(const unsigned int broadcastId)
 {
-  kodi::Log(ADDON_LOG_DEBUG, "function call: [%s]", __FUNCTION__);
-
   std::stringstream ss;
-  ss<< std::hex << tag.GetUniqueBroadcastId(); // int decimal_value
-  std::string epgId ( ss.str() );
-
-  while (epgId.size() < 8)
-    epgId.insert(0, "0");
-
-  kodi::Log(ADDON_LOG_DEBUG, "Get stream parameters for %s", epgId.c_str());
+  ss << std::hex << std::setw(8) << std::setfill('0') << broadcastId;
+  return "telekom.de-" + ss.str();
+}
 
-  std::string programsUrl = m_allProgramsFeedUrl + "?form=cjson" +
-                                                   "&byGuid=" + "telekom.de-" + epgId +
-                                                   "&range=1-1" +
-                                                   "&fields=media.publicUrl"; //programType
+PVR_ERROR CPVRMagenta2::IsEPGTagPlayable(const kodi::addon::PVREPGTag& tag, bool& bIsPlayable)
+{
+  TRACE_SCOPE("magenta2", __FUNCTION__);
+  DEBUG_LOG("function call: [%s]", __FUNCTION__);
+  m_startup.Wait("channels");
+  bIsPlayable = false;
 
-  rapidjson::Document doc;
-  if (!GetPostJson(programsUrl, "", doc)) {
-    return PVR_ERROR_FAILED;
-  }
+  std::string guid = GetProgramGuid(tag.GetUniqueBroadcastId());
+  auto current_time = time(NULL);
 
-  if (!doc.HasMember("entries"))
+  Magenta2Program program;
+  if (!m_programCache.Get(guid, program) || IsMediaOutdated(program, tag.GetStartTime()))
   {
-    kodi::Log(ADDON_LOG_ERROR, "Failed to get Programs feed");
-    return PVR_ERROR_FAILED;
+    // Kodi does not ask again, so a cache miss has to be answered right away,
+    // GetPlaybackInfo writes the result back into the program cache
+    PlaybackInfo info;
+    if (!GetPlaybackInfo(tag.GetUniqueBroadcastId(), info))
+      return PVR_ERROR_NO_ERROR;
+    program.publicUrl = info.url;
+    program.availableFrom = info.availableFrom;
+    program.availableUntil = info.availableUntil;
   }
 
-  const rapidjson::Value& entries = doc["entries"];
-
-  if (entries.Size() != 1)
-    return PVR_ERROR_FAILED;
-
-  if (!entries[0].HasMember("media"))
-    return PVR_ERROR_FAILED;
+  if (current_time > program.availableFrom && current_time < program.availableUntil && !program.publicUrl.empty())
+    bIsPlayable = true;
 
-  const rapidjson::Value& media = entries[0]["media"];
+  return PVR_ERROR_NO_ERROR;
+}
 
-  if (media.Size() == 0)
-    return PVR_ERROR_FAILED;
+PVR_ERROR CPVRMagenta2::GetEPGTagStreamProperties(
+    const kodi::addon::PVREPGTag& tag, std::vector<kodi::addon::PVRStreamProperty>& properties)
+{
+  TRACE_SCOPE("magenta2", __FUNCTION__);
+  DEBUG_LOG("function call: [%s]", __FUNCTION__);
+  m_startup.Wait("channels");
 
-  if (!media[0].HasMember("publicUrl"))
+  PlaybackInfo info;
+  if (!GetPlaybackInfo(tag.GetUniqueBroadcastId(), info))
     return PVR_ERROR_FAILED;
 
-  std::string publicUrl = Utils::JsonStringOrEmpty(media[0], "publicUrl");
-  if (!publicUrl.empty())
+  if (!info.url.empty())
   {
-    kodi::Log(ADDON_LOG_DEBUG, "Timeshift URL: %s", publicUrl.c_str());
-    return SetStreamProperties(properties, publicUrl, false, true, false);
+    DEBUG_LOG("Timeshift URL: %s", info.url.c_str());
+    return SetStreamProperties(properties, info.url, false, true, false, tag.GetUniqueChannelId());
   }
 
   return PVR_ERROR_FAILED;
@@ -1508,18 +1928,22 @@ PVR_ERROR CPVRMagenta2::GetEPGTagStreamProperties(
 
 PVR_ERROR CPVRMagenta2::GetChannelGroupsAmount(int& amount)
 {
-  kodi::Log(ADDON_LOG_DEBUG, "function call: [%s]", __FUNCTION__);
+  TRACE_SCOPE("magenta2", __FUNCTION__);
+  DEBUG_LOG("function call: [%s]", __FUNCTION__);
+  m_startup.Wait("channels");
 
   amount = static_cast<int>(m_categories.size());
   std::string amount_str = std::to_string(amount);
-  kodi::Log(ADDON_LOG_DEBUG, "Groups Amount: [%s]", amount_str.c_str());
+  DEBUG_LOG("Groups Amount: [%s]", amount_str.c_str());
 
   return PVR_ERROR_NO_ERROR;
 }
 
 PVR_ERROR CPVRMagenta2::GetChannelGroups(bool bRadio, kodi::addon::PVRChannelGroupsResultSet& results)
 {
-  kodi::Log(ADDON_LOG_DEBUG, "function call: [%s]", __FUNCTION__);
+  TRACE_SCOPE("magenta2", __FUNCTION__);
+  DEBUG_LOG("function call: [%s]", __FUNCTION__);
+  m_startup.Wait("channels");
 
   for (const auto& category : m_categories)
   {
@@ -1532,7 +1956,7 @@ PVR_ERROR CPVRMagenta2::GetChannelGroups(bool bRadio, kodi::addon::PVRChannelGro
       kodiGroup.SetGroupName(category.description);
 
       results.Add(kodiGroup);
-      kodi::Log(ADDON_LOG_DEBUG, "Group added: %s at position %u level %u", category.description.c_str(), category.order, category.level);
+      DEBUG_LOG("Group added: %s at position %u level %u", category.description.c_str(), category.order, category.level);
     }
   }
 
@@ -1542,7 +1966,9 @@ PVR_ERROR CPVRMagenta2::GetChannelGroups(bool bRadio, kodi::addon::PVRChannelGro
 PVR_ERROR CPVRMagenta2::GetChannelGroupMembers(const kodi::addon::PVRChannelGroup& group,
                                            kodi::addon::PVRChannelGroupMembersResultSet& results)
 {
-  kodi::Log(ADDON_LOG_DEBUG, "function call: [%s]", __FUNCTION__);
+  TRACE_SCOPE("magenta2", __FUNCTION__);
+  DEBUG_LOG("function call: [%s]", __FUNCTION__);
+  m_startup.Wait("channels");
 
   for (const auto& cgroup : m_categories)
   {
@@ -1570,32 +1996,147 @@ PVR_ERROR CPVRMagenta2::GetChannelGroupMembers(const kodi::addon::PVRChannelGrou
 *                                                              Recordings                                                                              *
 *******************************************************************************************************************************************************/
 
-int CPVRMagenta2::CountTimersRecordings(const bool& isRecording)
+bool CPVRMagenta2::ParseRecording(const rapidjson::Value& recordingItem, Magenta2Recording& recording)
 {
-  std::string url = m_pvrBaseUrl + "/get-recordings?limit=500";
+  recording.id = Utils::JsonStringOrEmpty(recordingItem, "id");
+  if (recording.id.empty())
+    return false;
+  recording.status = Utils::JsonStringOrEmpty(recordingItem, "recordingStatus");
+  recording.playbackUrl = Utils::JsonStringOrEmpty(recordingItem, "playbackUrl");
+  recording.startTime = Utils::StringToTime2(Utils::JsonStringOrEmpty(recordingItem, "startDateTime"));
+  recording.expirationTime = Utils::StringToTime2(Utils::JsonStringOrEmpty(recordingItem, "expirationDateTime"));
+  recording.seriesRecordingId = Utils::JsonStringOrEmpty(recordingItem, "seriesRecordingId");
+  if (!recordingItem.HasMember("program") || !recordingItem.HasMember("listing"))
+  {
+    recording.hasDetails = false;
+    return true;
+  }
+  recording.hasDetails = true;
+
+  const rapidjson::Value& program = recordingItem["program"];
+  const rapidjson::Value& listing = recordingItem["listing"];
+  recording.title = Utils::JsonStringOrEmpty(program, "title");
+  recording.year = Utils::JsonIntOrZero(program, "year");
+  recording.plot = Utils::JsonStringOrEmpty(program, "description");
+  recording.plotOutline = Utils::JsonStringOrEmpty(program, "shortDescription");
+  recording.duration = static_cast<int>(Utils::JsonDoubleOrZero(program, "runtime"));
+  recording.endTime = static_cast<time_t>(Utils::JsonInt64OrZero(listing, "endTime") / 1000);
+  if (recording.endTime == 0)
+    recording.endTime = recording.startTime + recording.duration;
+  recording.programGuid = Utils::JsonStringOrEmpty(program, "guid");
+  recording.broadcastId = 0;
+  try {
+    recording.broadcastId = static_cast<unsigned int>(stoi(recording.programGuid.substr(11, std::string::npos), 0, 16));
+  }
+  catch (const std::exception& e) {}
+  recording.seriesId = Utils::JsonStringOrEmpty(program, "seriesId");
+  recording.stationId = Utils::JsonStringOrEmpty(listing, "stationId");
+  recording.channelUid = GetChannelUidByStationId(recording.stationId);
+  recording.channelName = "";
+  GetChannelNamebyId(recording.stationId, recording.channelName);
 
-  rapidjson::Document doc;
-  if (!GetPostJson(url, "", doc)) {
-    return 0;
+  std::string genre_primary = "";
+  std::string genre_secondary = "";
+  SetGenreTypes(program, genre_primary, genre_secondary);
+  recording.genreDescription = "";
+  if (!GetGenre(recording.genreType, recording.genreSubType, genre_primary, genre_secondary))
+  {
+    DEBUG_LOG("Primary Genres: %s", genre_primary.c_str());
+    DEBUG_LOG("Secondary Genres: %s", genre_secondary.c_str());
+    recording.genreType = EPG_GENRE_USE_STRING;
+    recording.genreSubType = 0;
+    recording.genreDescription = genre_secondary;
   }
 
-  if (!doc.HasMember("recordings"))
+  recording.iconPath = "";
+  if (program.HasMember("thumbnails"))
+  {
+    const rapidjson::Value& thumbnails = program["thumbnails"];
+    rapidjson::Value::ConstMemberIterator itr = thumbnails.MemberBegin();
+    ++itr;
+    if (itr != thumbnails.MemberEnd())
+    {
+      const rapidjson::Value& thumbnailsItem = (itr->value);
+      if (!thumbnailsItem.IsNull())
+      {
+        int width = Utils::JsonIntOrZero(thumbnailsItem, "width");
+        int height = Utils::JsonIntOrZero(thumbnailsItem, "height");
+        recording.iconPath = Utils::JsonStringOrEmpty(thumbnailsItem, "url");
+        if ((width != 0) || (height != 0))
+          recording.iconPath = GetNgissUrl(recording.iconPath, width, height);
+      }
+    }
+  }
+  return true;
+}
+
+bool CPVRMagenta2::LoadRecordings()
+{
+  if (m_recordingsValidUntil > time(NULL))
+    return true;
+
+  std::vector<Magenta2Recording> recordings;
+  std::unordered_map<std::string, size_t> index;
+  int offset = 0;
+  rapidjson::SizeType received = 0;
+  do
+  {
+    std::string url = m_pvrBaseUrl + "/get-recordings?limit=" + std::to_string(MAX_RECORDING_ENTRIES) +
+                                     "&offset=" + std::to_string(offset);
+
+    rapidjson::Document doc;
+    if (!GetPostJson(url, "", doc)) {
+      return false;
+    }
+
+    if (!doc.HasMember("recordings"))
+      return false;
+
+    const rapidjson::Value& recordingItems = doc["recordings"];
+    received = recordingItems.Size();
+    size_t before = recordings.size();
+    for (rapidjson::SizeType i = 0; i < recordingItems.Size(); i++)
+    {
+      Magenta2Recording recording;
+      if (ParseRecording(recordingItems[i], recording) &&
+          index.emplace(recording.id, recordings.size()).second)
+        recordings.emplace_back(recording);
+    }
+    if (recordings.size() == before)
+      break; // backend ignored the offset
+    offset += static_cast<int>(received);
+  } while (static_cast<int>(received) == MAX_RECORDING_ENTRIES);
+
+  m_recordings.swap(recordings);
+  RebuildRecordingIndexes();
+  m_recordingsValidUntil = time(NULL) + RECORDINGS_TTL;
+  DEBUG_LOG("Loaded %i recordings and timers", static_cast<int>(m_recordings.size()));
+  return true;
+}
+
+void CPVRMagenta2::InvalidateRecordings()
+{
+  std::lock_guard<std::mutex> lock(m_recordingsMutex);
+  m_recordingsValidUntil = 0;
+}
+
+int CPVRMagenta2::CountTimersRecordings(const bool& isRecording)
+{
+  std::lock_guard<std::mutex> lock(m_recordingsMutex);
+  if (!LoadRecordings())
     return 0;
 
   int count = 0;
-  const rapidjson::Value& recordings = doc["recordings"];
-
-  for (rapidjson::SizeType i = 0; i < recordings.Size(); i++)
+  for (const auto& status : m_recordingsByStatus)
   {
-    std::string recordingStatus = Utils::JsonStringOrEmpty(recordings[i], "recordingStatus");
     if (isRecording)
     {
-      if (recordingStatus == "RECORDING" || recordingStatus == "GENERATED")
-        count++;
+      if (status.first == "RECORDING" || status.first == "GENERATED")
+        count += static_cast<int>(status.second.size());
     } else
     {
-      if (recordingStatus == "SCHEDULED")
-        count++;
+      if (status.first == "SCHEDULED")
+        count += static_cast<int>(status.second.size());
     }
   }
   return count;
@@ -1603,158 +2144,287 @@ int CPVRMagenta2::CountTimersRecordings(const bool& isRecording)
 
 PVR_ERROR CPVRMagenta2::GetRecordingsAmount(bool deleted, int& amount)
 {
-  kodi::Log(ADDON_LOG_DEBUG, "function call: [%s]", __FUNCTION__);
+  TRACE_SCOPE("magenta2", __FUNCTION__);
+  DEBUG_LOG("function call: [%s]", __FUNCTION__);
+  m_startup.Wait("channels");
+  m_startup.Wait("genres");
 
   amount = static_cast<int>(CountTimersRecordings(true));
 //  amount += GetGroupRecordingsAmount();
   std::string amount_str = std::to_string(amount);
-  kodi::Log(ADDON_LOG_DEBUG, "Recordings Amount: [%s]", amount_str.c_str());
+  DEBUG_LOG("Recordings Amount: [%s]", amount_str.c_str());
 
   return PVR_ERROR_NO_ERROR;
 }
 
-void CPVRMagenta2::FillPVRRecording(const rapidjson::Value& recordingItem, kodi::addon::PVRRecording& kodiRecording)
+void CPVRMagenta2::FillPVRRecording(const Magenta2Recording& recording, kodi::addon::PVRRecording& kodiRecording)
 {
-  if (!recordingItem.HasMember("program") || !recordingItem.HasMember("listing"))
-    return;
-  std::string recordingStatus = Utils::JsonStringOrEmpty(recordingItem, "recordingStatus");
-  if (recordingStatus == "RECORDING" || recordingStatus == "GENERATED")
-  {
-    const rapidjson::Value& program = recordingItem["program"];
-    const rapidjson::Value& listing = recordingItem["listing"];
-    kodiRecording.SetRecordingId(Utils::JsonStringOrEmpty(recordingItem, "id"));
-    kodiRecording.SetTitle(Utils::JsonStringOrEmpty(program, "title"));
-    kodiRecording.SetYear(Utils::JsonIntOrZero(program, "year"));
-    kodiRecording.SetPlot(Utils::JsonStringOrEmpty(program, "description"));
-    kodiRecording.SetPlotOutline(Utils::JsonStringOrEmpty(program, "shortDescription"));
-//    kodiRecording.SetChannelName();
-    kodiRecording.SetDuration(static_cast<int>(Utils::JsonDoubleOrZero(program, "runtime")));
-    time_t expirationDateTime = Utils::StringToTime2(Utils::JsonStringOrEmpty(recordingItem, "expirationDateTime"));
-
-    kodiRecording.SetLifetime(static_cast<int>((expirationDateTime - time(NULL))/(60*60*24)));
+  kodiRecording.SetRecordingId(recording.id);
+  kodiRecording.SetTitle(recording.title);
+  kodiRecording.SetYear(recording.year);
+  kodiRecording.SetPlot(recording.plot);
+  kodiRecording.SetPlotOutline(recording.plotOutline);
+  kodiRecording.SetDuration(recording.duration);
+  kodiRecording.SetLifetime(static_cast<int>((recording.expirationTime - time(NULL))/(60*60*24)));
 //    kodi::Log(ADDON_LOG_DEBUG, "Lifetime: %i", kodiRecording.GetLifetime());
 //    kodiRecording.SetEPGUid();
-    kodiRecording.SetRecordingTime(Utils::StringToTime2(Utils::JsonStringOrEmpty(recordingItem,"startDateTime")));
-    kodiRecording.SetChannelType(PVR_RECORDING_CHANNEL_TYPE_TV);
-
-    std::string channelName;
-    if (GetChannelNamebyId(Utils::JsonStringOrEmpty(listing, "stationId"), channelName))
-      kodiRecording.SetChannelName(channelName);
-
-    std::string genre_primary = "";
-    std::string genre_secondary = "";
-    SetGenreTypes(program, genre_primary, genre_secondary);
-    int primaryType;
-    int secondaryType;
-    if (GetGenre(primaryType, secondaryType, genre_primary, genre_secondary))
-    {
-      kodiRecording.SetGenreType(primaryType);
-      kodiRecording.SetGenreSubType(secondaryType);
-    } else
+  kodiRecording.SetRecordingTime(recording.startTime);
+  kodiRecording.SetChannelType(PVR_RECORDING_CHANNEL_TYPE_TV);
+  if (!recording.channelName.empty())
+    kodiRecording.SetChannelName(recording.channelName);
+
+  kodiRecording.SetGenreType(recording.genreType);
+  if (recording.genreType == EPG_GENRE_USE_STRING)
+    kodiRecording.SetGenreDescription(recording.genreDescription);
+  else
+    kodiRecording.SetGenreSubType(recording.genreSubType);
+
+  if (!recording.iconPath.empty())
+  {
+    kodiRecording.SetIconPath(recording.iconPath);
+    kodiRecording.SetFanartPath(recording.iconPath);
+    kodiRecording.SetThumbnailPath(recording.iconPath);
+  }
+}
+
+PVR_ERROR CPVRMagenta2::GetRecordings(bool deleted, kodi::addon::PVRRecordingsResultSet& results)
+{
+  TRACE_SCOPE("magenta2", __FUNCTION__);
+  DEBUG_LOG("function call: [%s]", __FUNCTION__);
+  m_startup.Wait("channels");
+  m_startup.Wait("genres");
+
+  std::lock_guard<std::mutex> lock(m_recordingsMutex);
+  if (!LoadRecordings())
+    return PVR_ERROR_FAILED;
+
+  for (const auto& status : {"RECORDING", "GENERATED"})
+  {
+    auto it = m_recordingsByStatus.find(status);
+    if (it == m_recordingsByStatus.end())
+      continue;
+    for (const auto& index : it->second)
     {
-      kodi::Log(ADDON_LOG_DEBUG, "Primary Genres: %s", genre_primary.c_str());
-      kodi::Log(ADDON_LOG_DEBUG, "Secondary Genres: %s", genre_secondary.c_str());
-      kodiRecording.SetGenreType(EPG_GENRE_USE_STRING);
-      kodiRecording.SetGenreDescription(genre_secondary);
+      const Magenta2Recording& recording = m_recordings[index];
+      if (!recording.hasDetails)
+        continue;
+
+      kodi::addon::PVRRecording kodiRecording;
+      FillPVRRecording(recording, kodiRecording);
+      results.Add(kodiRecording);
+      DEBUG_LOG("Recording added: %s", recording.title.c_str());
     }
+  }
+
+  return PVR_ERROR_NO_ERROR;
+}
+
+bool CPVRMagenta2::GetRecordingPlaybackUrl(const std::string& id, std::string& playbackUrl)
+{
+  std::lock_guard<std::mutex> lock(m_recordingsMutex);
+  for (int attempt = 0; attempt < 2; attempt++)
+  {
+    if (!LoadRecordings())
+      return false;
 
-    if (program.HasMember("thumbnails"))
+    auto it = m_recordingIndex.find(id);
+    if (it != m_recordingIndex.end())
     {
-      const rapidjson::Value& thumbnails = program["thumbnails"];
-      rapidjson::Value::ConstMemberIterator itr = thumbnails.MemberBegin();
-      ++itr;
-      if (itr != thumbnails.MemberEnd())
-      {
-        const rapidjson::Value& thumbnailsItem = (itr->value);
-        if (!thumbnailsItem.IsNull())
-        {
-          int width = Utils::JsonIntOrZero(thumbnailsItem, "width");
-          int height = Utils::JsonIntOrZero(thumbnailsItem, "height");
-          std::string iconUrl = Utils::JsonStringOrEmpty(thumbnailsItem, "url");
-          if ((width == 0) && (height == 0))
-          {
-            kodiRecording.SetIconPath(iconUrl);
-            kodiRecording.SetFanartPath(iconUrl);
-            kodiRecording.SetThumbnailPath(iconUrl);
-          }
-          else
-          {
-            kodiRecording.SetIconPath(GetNgissUrl(iconUrl, width, height));
-            kodiRecording.SetFanartPath(GetNgissUrl(iconUrl, width, height));
-            kodiRecording.SetThumbnailPath(GetNgissUrl(iconUrl, width, height));
-          }
-        }
-      }
+      playbackUrl = m_recordings[it->second].playbackUrl;
+      return true;
     }
-
+    // unknown id, the snapshot might predate the recording
+    m_recordingsValidUntil = 0;
   }
+  return false;
 }
 
-PVR_ERROR CPVRMagenta2::GetRecordings(bool deleted, kodi::addon::PVRRecordingsResultSet& results)
+PVR_ERROR CPVRMagenta2::GetRecordingStreamProperties(
+    const kodi::addon::PVRRecording& recording,
+    std::vector<kodi::addon::PVRStreamProperty>& properties)
 {
-  kodi::Log(ADDON_LOG_DEBUG, "function call: [%s]", __FUNCTION__);
+  TRACE_SCOPE("magenta2", __FUNCTION__);
+  DEBUG_LOG("function call: [%s]", __FUNCTION__);
+  m_startup.Wait("channels");
+  m_startup.Wait("genres");
 
-  std::string url = m_pvrBaseUrl + "/get-recordings?limit=500";
-
-  rapidjson::Document doc;
-  if (!GetPostJson(url, "", doc)) {
+  std::string playUrl;
+  if (!GetRecordingPlaybackUrl(recording.GetRecordingId(), playUrl))
     return PVR_ERROR_FAILED;
-  }
 
-  if (!doc.HasMember("recordings"))
-    return PVR_ERROR_FAILED;
+  DEBUG_LOG("[PLAY RECORDING] url: %s", playUrl.c_str());
+
+  SetStreamProperties(properties, playUrl, false, false, false);
+  return PVR_ERROR_NO_ERROR;
+}
 
-  const rapidjson::Value& recordings = doc["recordings"];
+/*******************************************************************************************************************************************************
+*                                                              Timers                                                                                  *
+*******************************************************************************************************************************************************/
 
-  for (rapidjson::SizeType i = 0; i < recordings.Size(); i++)
+namespace
+{
+struct Magenta2TimerType : kodi::addon::PVRTimerType
+{
+  Magenta2TimerType(unsigned int id, unsigned int attributes, const std::string& description)
   {
-    kodi::addon::PVRRecording kodiRecording;
-
-    FillPVRRecording(recordings[i], kodiRecording);
-//    if (!current_recording.periodPVRTaskName.empty())
-//      kodiRecording.SetDirectory(current_recording.periodPVRTaskName);
+    SetId(id);
+    SetAttributes(attributes);
+    SetDescription(description);
+  }
+};
+} // unnamed namespace
 
-    results.Add(kodiRecording);
-    kodi::Log(ADDON_LOG_DEBUG, "Recording added: %s", kodiRecording.GetTitle().c_str());
+void CPVRMagenta2::RebuildRecordingIndexes()
+{
+  m_recordingIndex.clear();
+  m_recordingsByStatus.clear();
+  for (size_t i = 0; i < m_recordings.size(); i++)
+  {
+    m_recordingIndex[m_recordings[i].id] = i;
+    m_recordingsByStatus[m_recordings[i].status].emplace_back(i);
   }
+}
 
-  return PVR_ERROR_NO_ERROR;
+unsigned int CPVRMagenta2::GetTimerIndex(const std::string& key)
+{
+  auto it = m_timerIndexes.find(key);
+  if (it != m_timerIndexes.end())
+    return it->second;
+  m_timerIndexes[key] = m_nextTimerIndex;
+  return m_nextTimerIndex++;
 }
 
-PVR_ERROR CPVRMagenta2::GetRecordingStreamProperties(
-    const kodi::addon::PVRRecording& recording,
-    std::vector<kodi::addon::PVRStreamProperty>& properties)
+int CPVRMagenta2::GetChannelUidByStationId(const std::string& stationId)
 {
-  kodi::Log(ADDON_LOG_DEBUG, "function call: [%s]", __FUNCTION__);
+  for (const auto& thisChannel : m_channels)
+  {
+    if (thisChannel.stationsId == stationId)
+      return thisChannel.iUniqueId;
+  }
+  return PVR_TIMER_ANY_CHANNEL;
+}
 
-  std::string url = m_pvrBaseUrl + "/get-recordings?limit=500";
+PVR_ERROR CPVRMagenta2::GetTimerTypes(std::vector<kodi::addon::PVRTimerType>& types)
+{
+  TRACE_SCOPE("magenta2", __FUNCTION__);
+  DEBUG_LOG("function call: [%s]", __FUNCTION__);
 
-  rapidjson::Document doc;
-  if (!GetPostJson(url, "", doc)) {
-    return PVR_ERROR_FAILED;
+  // scheduled recordings are only listed, creating and deleting them is not supported on 2.0
+  unsigned int TIMER_ONCE_EPG_ATTRIBS =
+       PVR_TIMER_TYPE_IS_READONLY | PVR_TIMER_TYPE_FORBIDS_NEW_INSTANCES |
+       PVR_TIMER_TYPE_SUPPORTS_CHANNELS;
+  types.emplace_back(Magenta2TimerType(TIMER_ONCE_EPG, TIMER_ONCE_EPG_ATTRIBS, "Einzelaufnahme"));
+
+  unsigned int TIMER_SERIES_EPG_ATTRIBS =
+      PVR_TIMER_TYPE_IS_READONLY | PVR_TIMER_TYPE_FORBIDS_NEW_INSTANCES |
+      PVR_TIMER_TYPE_SUPPORTS_CHANNELS | PVR_TIMER_TYPE_IS_REPEATING;
+  types.emplace_back(Magenta2TimerType(TIMER_SERIES_EPG, TIMER_SERIES_EPG_ATTRIBS, "Serienaufnahme"));
+
+  return PVR_ERROR_NO_ERROR;
+}
+
+PVR_ERROR CPVRMagenta2::GetTimersAmount(int& amount)
+{
+  TRACE_SCOPE("magenta2", __FUNCTION__);
+  DEBUG_LOG("function call: [%s]", __FUNCTION__);
+  m_startup.Wait("channels");
+  m_startup.Wait("genres");
+
+  std::lock_guard<std::mutex> lock(m_recordingsMutex);
+  if (!LoadRecordings())
+    return PVR_ERROR_SERVER_ERROR;
+
+  amount = 0;
+  auto it = m_recordingsByStatus.find("SCHEDULED");
+  if (it != m_recordingsByStatus.end())
+  {
+    std::set<std::string> series;
+    for (const auto& index : it->second)
+    {
+      if (!m_recordings[index].seriesRecordingId.empty())
+        series.insert(m_recordings[index].seriesRecordingId);
+    }
+    amount = static_cast<int>(it->second.size() + series.size());
   }
+  DEBUG_LOG("Timers Amount: [%i]", amount);
+  return PVR_ERROR_NO_ERROR;
+}
 
-  if (!doc.HasMember("recordings"))
-    return PVR_ERROR_FAILED;
+PVR_ERROR CPVRMagenta2::GetTimers(kodi::addon::PVRTimersResultSet& results)
+{
+  TRACE_SCOPE("magenta2", __FUNCTION__);
+  DEBUG_LOG("function call: [%s]", __FUNCTION__);
+  m_startup.Wait("channels");
+  m_startup.Wait("genres");
 
-  const rapidjson::Value& recordings = doc["recordings"];
+  std::lock_guard<std::mutex> lock(m_recordingsMutex);
+  if (!LoadRecordings())
+    return PVR_ERROR_SERVER_ERROR;
+
+  auto it = m_recordingsByStatus.find("SCHEDULED");
+  if (it == m_recordingsByStatus.end())
+    return PVR_ERROR_NO_ERROR;
 
-  for (rapidjson::SizeType i = 0; i < recordings.Size(); i++)
+  std::map<std::string, unsigned int> seriesIndexes;
+  for (const auto& index : it->second)
   {
-    if (recording.GetRecordingId() != Utils::JsonStringOrEmpty(recordings[i], "id"))
+    const Magenta2Recording& recording = m_recordings[index];
+    if (recording.seriesRecordingId.empty() ||
+        seriesIndexes.find(recording.seriesRecordingId) != seriesIndexes.end())
       continue;
 
-    std::string playUrl = Utils::JsonStringOrEmpty(recordings[i], "playbackUrl");
-    kodi::Log(ADDON_LOG_DEBUG, "[PLAY RECORDING] url: %s", playUrl.c_str());
+    kodi::addon::PVRTimer tagGroup;
+    unsigned int groupIndex = GetTimerIndex("series:" + recording.seriesRecordingId);
+    seriesIndexes[recording.seriesRecordingId] = groupIndex;
+    tagGroup.SetClientIndex(groupIndex);
+    tagGroup.SetTimerType(TIMER_SERIES_EPG);
+    tagGroup.SetState(PVR_TIMER_STATE_SCHEDULED);
+    tagGroup.SetTitle(recording.title);
+    tagGroup.SetClientChannelUid(recording.channelUid);
+    tagGroup.SetStartAnyTime(true);
+    tagGroup.SetEndAnyTime(true);
+    tagGroup.SetSeriesLink(recording.seriesId);
 
-    SetStreamProperties(properties, playUrl, false, false, false);
+    results.Add(tagGroup);
+    DEBUG_LOG("Timer Group added: %s with index: %u", recording.title.c_str(), groupIndex);
   }
+
+  for (const auto& index : it->second)
+  {
+    const Magenta2Recording& recording = m_recordings[index];
+    kodi::addon::PVRTimer kodiTimer;
+
+    kodiTimer.SetClientIndex(GetTimerIndex(recording.id));
+    kodiTimer.SetTimerType(TIMER_ONCE_EPG);
+    kodiTimer.SetState(PVR_TIMER_STATE_SCHEDULED);
+    kodiTimer.SetTitle(recording.title);
+    kodiTimer.SetSummary(recording.plot);
+    kodiTimer.SetStartTime(recording.startTime);
+    kodiTimer.SetEndTime(recording.endTime);
+    kodiTimer.SetClientChannelUid(recording.channelUid);
+    if (recording.broadcastId != 0)
+      kodiTimer.SetEPGUid(recording.broadcastId);
+    if (!recording.seriesRecordingId.empty())
+    {
+      kodiTimer.SetSeriesLink(recording.seriesId);
+      kodiTimer.SetParentClientIndex(seriesIndexes[recording.seriesRecordingId]);
+    } else {
+      kodiTimer.SetParentClientIndex(PVR_TIMER_NO_PARENT);
+    }
+
+    results.Add(kodiTimer);
+    DEBUG_LOG("Timer added: %s, Program: %s", recording.title.c_str(), recording.programGuid.c_str());
+  }
+
   return PVR_ERROR_NO_ERROR;
 }
 
 PVR_ERROR CPVRMagenta2::GetDriveSpace(uint64_t& total, uint64_t& used)
 {
-  kodi::Log(ADDON_LOG_DEBUG, "function call: [%s]", __FUNCTION__);
+  TRACE_SCOPE("magenta2", __FUNCTION__);
+  DEBUG_LOG("function call: [%s]", __FUNCTION__);
+  m_startup.Wait("auth");
 
   std::string url = m_pvrBaseUrl + "/get-npvr-info";
 
@@ -1768,6 +2438,6 @@ PVR_ERROR CPVRMagenta2::GetDriveSpace(uint64_t& total, uint64_t& used)
 
   total = quotaAllocated * KBM2; //convert hours to MB
   used = quotaUsed * KBM2; //convert hours to MB
-  kodi::Log(ADDON_LOG_DEBUG, "Reported %llu/%llu used/total", used, total);
+  DEBUG_LOG("Reported %llu/%llu used/total", used, total);
   return PVR_ERROR_NO_ERROR;
 }
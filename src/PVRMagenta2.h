@@ -5,7 +5,11 @@
  *  SPDX-License-Identifier: GPL-2.0-or-later
  *  See LICENSE.md for more information.
  */
+#include <map>
+#include <mutex>
+#include <set>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include <kodi/addon-instance/PVR.h>
@@ -13,6 +17,13 @@
 #include "http/HttpClient.h"
 #include "sam3/Sam3Client.h"
 #include "taa/TaaClient.h"
+#include "epg/ProgramCache.h"
+#include "epg/PlaybackCache.h"
+#include "epg/TimeshiftWindow.h"
+#include "task/TaskQueue.h"
+#include "task/TaskGraph.h"
+#include "concurrency/ConcurrencyClient.h"
+#include "auth/AuthState.h"
 #include "rapidjson/document.h"
 #include <tinyxml2.h>
 
@@ -34,10 +45,21 @@ static const std::string APPVERSION = "104180";
 static const std::string FIRMWARE = "API level 30";
 static const std::string RUNTIMEVERSION = "1";
 */
+#define TIMER_ONCE_EPG (PVR_TIMER_TYPE_NONE + 1)
+#define TIMER_SERIES_EPG (PVR_TIMER_TYPE_NONE + 2)
+
 static const int MAX_CHANNEL_ENTRIES = 100;
 static const uint64_t TIMEBUFFER2 = 4 * 60 * 60; //4h time buffer
 static const long KBM2 = 150000; // 150 MB
 static const int CUTOFF = 1000;
+static const size_t MAX_PROGRAM_GUIDS = 300;
+static const int MAX_RECORDING_ENTRIES = 500;
+static const time_t RECORDINGS_TTL = 60;
+static const int ZAP_PREFETCH_NEIGHBOURS = 1;
+static const int ZAP_PREFETCH_MOST_USED = 1;
+static const int ZAP_PREFETCH_DELAY = 2000; //ms
+static const time_t ZAP_PREFETCH_TTL = 30;
+static const size_t MAX_NGISS_URLS = 4096; //scaled image urls kept in memory
 
 static const std::vector<std::string> Magenta2StationThumbnailTypes
                   = { "stationBackground", "stationBarker", "stationLogo", "stationLogoColored" };
@@ -61,15 +83,12 @@ struct Magenta2Genre
   int genreSubType;
 };
 
-struct Magenta2Lock
+struct Magenta2Stream
 {
-  std::string instance;
-  std::string token;
-  std::string id;
-  std::string lock;
-  std::string sequenceToken;
-  std::string serviceUrl;
-  int updateInterval;
+  std::string src;
+  std::string releasePid;
+  Magenta2Lock lock;
+  time_t validUntil;
 };
 
 struct Magenta2KV
@@ -110,6 +129,13 @@ struct Magenta2Channel
 //  bool isEntitled;
 };
 
+struct Magenta2Listing
+{
+  std::string guid;
+  time_t startTime;
+  time_t endTime;
+};
+
 struct Magenta2Category
 {
   std::string id;
@@ -120,12 +146,32 @@ struct Magenta2Category
   int level;
   std::vector<int> channelUids;
 };
-/*
 struct Magenta2Recording
 {
-
+  std::string id;
+  std::string status;
+  std::string playbackUrl;
+  bool hasDetails;
+  std::string title;
+  int year;
+  std::string plot;
+  std::string plotOutline;
+  int duration;
+  time_t startTime;
+  time_t endTime;
+  time_t expirationTime;
+  std::string programGuid;
+  unsigned int broadcastId;
+  std::string seriesId;
+  std::string seriesRecordingId;
+  std::string stationId;
+  int channelUid;
+  std::string channelName;
+  int genreType;
+  int genreSubType;
+  std::string genreDescription;
+  std::string iconPath;
 };
-*/
 class CPVRMagenta2
 {
 public:
@@ -141,6 +187,8 @@ public:
   PVR_ERROR GetChannelStreamProperties(
       const kodi::addon::PVRChannel& channel,
       std::vector<kodi::addon::PVRStreamProperty>& properties);
+  void CloseStream();
+  void UpdateChannelIcons();
   //EPG
   PVR_ERROR GetEPGForChannel(int channelUid,
                              time_t start,
@@ -155,7 +203,7 @@ public:
   PVR_ERROR GetChannelGroups(bool bRadio, kodi::addon::PVRChannelGroupsResultSet& results);
   PVR_ERROR GetChannelGroupMembers(const kodi::addon::PVRChannelGroup& group,
                                    kodi::addon::PVRChannelGroupMembersResultSet& results);
-  //Timers
+  //Timers (read-only: only get-recordings is known on the 2.0 pvr api)
   PVR_ERROR GetTimerTypes(std::vector<kodi::addon::PVRTimerType>& types);
   PVR_ERROR GetTimersAmount(int& amount);
   PVR_ERROR GetTimers(kodi::addon::PVRTimersResultSet& results);
@@ -170,20 +218,44 @@ public:
 private:
   PVR_ERROR SetStreamProperties(std::vector<kodi::addon::PVRStreamProperty>& properties,
                                 const std::string& url,
-                                bool realtime, bool playTimeshiftBuffer, bool epgplayback);
+                                bool realtime, bool playTimeshiftBuffer, bool epgplayback,
+                                const int channelUid = TIMESHIFT_ANY_CHANNEL);
+  PVR_ERROR SetStreamProperties(std::vector<kodi::addon::PVRStreamProperty>& properties,
+                                const Magenta2Stream& stream,
+                                bool realtime, bool playTimeshiftBuffer, bool epgplayback,
+                                const int channelUid = TIMESHIFT_ANY_CHANNEL);
 
   std::vector<Magenta2Channel> m_channels;
+  std::mutex m_channelsMutex; //settings and zap prefetch touch the list off the startup thread
   std::vector<std::string> m_distributionRights;
+  AuthState m_authState;
   std::vector<Magenta2KV> m_parameters;
   std::vector<Magenta2Genre> m_genres;
   std::vector<Magenta2Category> m_categories;
-//  std::vector<Magenta2Recording> m_recordings;
-//  std::vector<Magenta2Recording> m_timers;
+  ProgramCache m_programCache;
+  PlaybackCache m_playbackCache;
+  TimeshiftWindow m_timeshiftWindow;
+  std::vector<Magenta2Recording> m_recordings;
+  std::unordered_map<std::string, size_t> m_recordingIndex;
+  std::map<std::string, std::vector<size_t>> m_recordingsByStatus;
+  time_t m_recordingsValidUntil;
+  std::mutex m_recordingsMutex;
+  std::map<std::string, unsigned int> m_timerIndexes;
+  unsigned int m_nextTimerIndex;
+  std::map<int, Magenta2Stream> m_zapStreams;
+  std::map<int, int> m_zapCounts;
+  std::set<int> m_lockedChannels;
+  std::mutex m_zapMutex;
+  TaskQueue m_taskQueue;
+  StartupProfiler m_profiler;
+  TaskGraph m_startup;
+  bool m_warmStart;
 
   HttpClient* m_httpClient;
   CSettings* m_settings;
   Sam3Client* m_sam3Client;
   AuthClient* m_authClient;
+  ConcurrencyClient* m_concurrencyClient;
 
   bool XMLGetString(const tinyxml2::XMLNode* pRootNode,
                               const std::string& strTag,
@@ -191,13 +263,25 @@ private:
 
   bool GetMyGenres();
   bool GetPostJson(const std::string& url, const std::string& body, rapidjson::Document& doc);
-  bool GetSmil(const std::string& url, tinyxml2::XMLDocument& smilDoc);
-  bool GetStreamParameters(const std::string& url, std::string& src, std::string& releasePid);
+  bool GetSmil(const std::string& url, std::string& smil);
+  bool GetStreamParameters(const std::string& url, std::string& src, std::string& releasePid, Magenta2Lock& lock,
+                           const bool silent);
+  bool ResolveStream(const std::string& mediaUrl, Magenta2Stream& stream, const bool silent);
+  void ActivateStream(const Magenta2Stream& stream);
+  bool TakePrefetchedStream(const int& channelUid, Magenta2Stream& stream);
+  void ReleasePrefetchedStreams(const std::set<int>& keep);
+  void PrefetchStreams(const int channelUid);
+  std::string GetChannelMediaUrl(const Magenta2Channel& channel);
   bool GetParameter(const std::string& key, std::string& value);
   bool Bootstrap();
-  bool DeviceManifest();
-  bool Manifest();
-  bool GetDistributionRights();
+  bool FetchManifest(rapidjson::Document& doc, std::string& type);
+  bool ApplyManifest(const rapidjson::Value& doc, const std::string& type);
+  bool DeviceManifest(const rapidjson::Value& doc);
+  bool Manifest(const rapidjson::Value& doc);
+  bool RestoreAuthState();
+  void SaveAuthState();
+  void RevalidateAuthState();
+  bool GetDistributionRights(std::vector<std::string>& rights);
   bool GetCategories();
   std::string GetNgissUrl(const std::string& url, const int& width, const int& height);
   void AddChannelEntry(const rapidjson::Value& entry);
@@ -206,17 +290,32 @@ private:
   bool GetFeed(/*const int& feed,*/ const int& maxEntries, /*const std::string& params,*/ std::string& baseUrl/*, kodi::addon::PVREPGTagsResultSet& results*/,
                 handleentry_t HandleEntry);
   bool GetGenre(int& primaryType, int& secondaryType, const std::string& primaryGenre, const std::string& secondaryGenre);
-  void AddEPGEntry(const int& channelNumber, const rapidjson::Value& entry, kodi::addon::PVREPGTagsResultSet& results);
+  bool ParseProgram(const rapidjson::Value& epgItem, Magenta2Program& program);
+  bool GetPrograms(const std::vector<std::string>& guids);
+  bool GetProgramMedia(const std::vector<std::string>& guids);
+  bool IsMediaOutdated(const Magenta2Program& program, const time_t startTime);
+  void AddEPGEntry(const int& channelNumber, const Magenta2Program& program,
+                   const Magenta2Listing& listing, kodi::addon::PVREPGTagsResultSet& results);
+  bool GetPlaybackInfo(const unsigned int broadcastId, PlaybackInfo& info);
+  std::string GetProgramGuid(const unsigned int broadcastId);
   bool GetEPGFeed(const int& channelNumber, const std::string& baseUrl, kodi::addon::PVREPGTagsResultSet& results);
   bool GetChannelByNumber(const unsigned int number, Magenta2Channel& myChannel);
   bool GetChannelNamebyId(const std::string& id, std::string& name);
   bool AddDistributionRight(const unsigned int number, const std::string& right);
 //  bool IsChannelNumberExist(const unsigned int number);
   bool HideDuplicateChannels();
+  bool LoadChannels();
+  void SetChannelIcons();
 //  bool SingleSignOn();
-  bool ReleaseLock();
   int CountTimersRecordings(const bool& isRecording);
-  void FillPVRRecording(const rapidjson::Value& recordingItem, kodi::addon::PVRRecording& kodiRecording);
+  bool ParseRecording(const rapidjson::Value& recordingItem, Magenta2Recording& recording);
+  bool LoadRecordings();
+  void InvalidateRecordings();
+  void RebuildRecordingIndexes();
+  unsigned int GetTimerIndex(const std::string& key);
+  int GetChannelUidByStationId(const std::string& stationId);
+  bool GetRecordingPlaybackUrl(const std::string& id, std::string& playbackUrl);
+  void FillPVRRecording(const Magenta2Recording& recording, kodi::addon::PVRRecording& kodiRecording);
   void SetGenreTypes(const rapidjson::Value& item, std::string& primary, std::string& secondary);
 
   std::string m_deviceId;
@@ -246,4 +345,6 @@ private:
   int m_platform;
   Magenta2Lock m_currentLock;
   Magenta2Ngiss m_ngiss;
+  std::unordered_map<std::string, std::string> m_ngissUrls;
+  std::mutex m_ngissMutex;
 };
@@ -7,9 +7,18 @@
 
 #include "Settings.h"
 #include <kodi/General.h>
+#include "log/DebugLog.h"
 
 bool CSettings::Load()
 {
+  if (!kodi::addon::CheckSettingBoolean("debuglog", m_debuglog))
+  {
+    /* If setting is unknown fallback to defaults */
+    kodi::Log(ADDON_LOG_ERROR, "Couldn't get 'debuglog' setting");
+    return false;
+  }
+  DebugLog::SetEnabled(m_debuglog);
+
   if (!kodi::addon::CheckSettingString("username", m_userName))
   {
     /* If setting is unknown fallback to defaults */
@@ -160,13 +169,19 @@ bool CSettings::Load()
   return true;
 }
 
+std::string CSettings::GetMagentaCSRFToken() const
+{
+  std::lock_guard<std::mutex> lock(m_csrfMutex);
+  return m_csrfToken;
+}
+
 ADDON_STATUS CSettings::SetSetting(const std::string& settingName,
                                    const std::string& settingValue)
 {
   if (settingName == "epg_token")
   {
     std::string tmp_sToken;
-    kodi::Log(ADDON_LOG_DEBUG, "Changed Setting 'epg_token'");
+    DEBUG_LOG("Changed Setting 'epg_token'");
     tmp_sToken = m_epgToken;
     m_epgToken = settingValue;
     if (tmp_sToken != m_epgToken)
@@ -178,7 +193,7 @@ ADDON_STATUS CSettings::SetSetting(const std::string& settingName,
   else if (settingName == "openid_token")
   {
     std::string tmp_oToken;
-    kodi::Log(ADDON_LOG_DEBUG, "Changed Setting 'openid_token'");
+    DEBUG_LOG("Changed Setting 'openid_token'");
     tmp_oToken = m_openidToken;
     m_openidToken = settingValue;
     if (tmp_oToken != m_openidToken)
@@ -190,7 +205,7 @@ ADDON_STATUS CSettings::SetSetting(const std::string& settingName,
   else if (settingName == "tv_token")
   {
     std::string tmp_tToken;
-    kodi::Log(ADDON_LOG_DEBUG, "Changed Setting 'tv_token'");
+    DEBUG_LOG("Changed Setting 'tv_token'");
     tmp_tToken = m_tvToken;
     m_tvToken = settingValue;
     if (tmp_tToken != m_tvToken)
@@ -202,7 +217,7 @@ ADDON_STATUS CSettings::SetSetting(const std::string& settingName,
   else if (settingName == "refresh_token")
   {
     std::string tmp_rToken;
-    kodi::Log(ADDON_LOG_DEBUG, "Changed Setting 'refresh_token'");
+    DEBUG_LOG("Changed Setting 'refresh_token'");
     tmp_rToken = m_refreshToken;
     m_refreshToken = settingValue;
     if (tmp_rToken != m_refreshToken)
@@ -214,19 +229,22 @@ ADDON_STATUS CSettings::SetSetting(const std::string& settingName,
   else if (settingName == "csrftoken")
   {
     std::string tmp_cToken;
-    kodi::Log(ADDON_LOG_DEBUG, "Changed Setting 'csrftoken'");
-    tmp_cToken = m_csrfToken;
-    m_csrfToken = settingValue;
-    if (tmp_cToken != m_csrfToken)
+    DEBUG_LOG("Changed Setting 'csrftoken'");
     {
-      kodi::addon::SetSettingString("csrftoken", m_csrfToken);
+      std::lock_guard<std::mutex> lock(m_csrfMutex);
+      tmp_cToken = m_csrfToken;
+      m_csrfToken = settingValue;
+    }
+    if (tmp_cToken != settingValue)
+    {
+      kodi::addon::SetSettingString("csrftoken", settingValue);
   //      return ADDON_STATUS_NEED_RESTART;
     }
   }
   else if (settingName == "personaltoken")
   {
     std::string tmp_pToken;
-    kodi::Log(ADDON_LOG_DEBUG, "Changed Setting 'personaltoken'");
+    DEBUG_LOG("Changed Setting 'personaltoken'");
     tmp_pToken = m_personalToken;
     m_personalToken = settingValue;
     if (tmp_pToken != m_personalToken)
@@ -235,10 +253,25 @@ ADDON_STATUS CSettings::SetSetting(const std::string& settingName,
   //      return ADDON_STATUS_NEED_RESTART;
     }
   }
+  else if (settingName == "whitelogos")
+  {
+    DEBUG_LOG("Changed Setting 'whitelogos'");
+    m_whitelogos = settingValue == "true";
+  }
+  else if (settingName == "higherresolution")
+  {
+    DEBUG_LOG("Changed Setting 'higherresolution'");
+    m_higherresolution = settingValue == "true";
+  }
+  else if (settingName == "debuglog")
+  {
+    m_debuglog = settingValue == "true";
+    DebugLog::SetEnabled(m_debuglog);
+  }
   else if (settingName == "deviceid")
   {
     std::string tmp_sDeviceID;
-    kodi::Log(ADDON_LOG_DEBUG, "Changed Setting 'deviceid'");
+    DEBUG_LOG("Changed Setting 'deviceid'");
     tmp_sDeviceID = m_magentaDeviceID;
     m_magentaDeviceID = settingValue;
     if (tmp_sDeviceID != m_magentaDeviceID)
@@ -8,6 +8,7 @@
 #pragma once
 
 #include <kodi/AddonBase.h>
+#include <mutex>
 
 class ATTR_DLL_LOCAL CSettings
 {
@@ -26,7 +27,7 @@ public:
   const std::string& GetMagentaOpenIDToken() const { return m_openidToken; }
   const std::string& GetMagentaTVToken() const { return m_tvToken; }
   const std::string& GetMagentaRefreshToken() const { return m_refreshToken; }
-  const std::string& GetMagentaCSRFToken() const { return m_csrfToken; }
+  std::string GetMagentaCSRFToken() const;
   const std::string& GetMagenta2PersonaToken() const { return m_personalToken; }
   const std::string& GetMagentaDeviceID() const { return m_magentaDeviceID; }
   const std::string& GetMagentaUsername() const { return m_userName; }
@@ -40,6 +41,7 @@ public:
   const bool PreferHigherResolution() const { return m_higherresolution; }
   const bool IsGroupsenabled() const  { return m_enablegroups; }
   const bool IsMagenta2() const { return m_ismagenta2; }
+  const bool IsDebugLogEnabled() const { return m_debuglog; }
 
 private:
   std::string m_epgToken;
@@ -47,6 +49,7 @@ private:
   std::string m_tvToken;
   std::string m_refreshToken;
   std::string m_csrfToken;
+  mutable std::mutex m_csrfMutex; //rewritten on re-auth while requests read it
   std::string m_personalToken;
   std::string m_magentaDeviceID;
   std::string m_userName;
@@ -63,4 +66,5 @@ private:
   bool m_higherresolution;
   bool m_enablegroups;
   bool m_ismagenta2;
+  bool m_debuglog;
 };
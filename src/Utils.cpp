@@ -150,6 +150,28 @@ time_t Utils::StringToTime2(const std::string &timeString)
   return ret;
 }
 
+//Time format in Magenta2 Playback urls (UTC)
+time_t Utils::StringToTime3(const std::string &timeString)
+{
+  struct tm tm{};
+
+  int year, month, day, h, m, s;
+  if (sscanf(timeString.c_str(), "%4d%2d%2dT%2d%2d%2d", &year, &month, &day, &h,
+      &m, &s) < 6)
+  {
+    return 0;
+  }
+
+  tm.tm_year = year - 1900;
+  tm.tm_mon = month - 1;
+  tm.tm_mday = day;
+  tm.tm_hour = h;
+  tm.tm_min = m;
+  tm.tm_sec = s;
+
+  return timegm(&tm);
+}
+
 std::string Utils::TimeToString(const time_t time)
 {
   char time_str[21] = "";
@@ -18,6 +18,7 @@ public:
       const char &delim, int maxParts = 0);
   static time_t StringToTime(const std::string &timeString);
   static time_t StringToTime2(const std::string &timeString);
+  static time_t StringToTime3(const std::string &timeString);
   static std::string TimeToString(time_t time);
   static std::string TimeToString2(time_t time);
   static std::string TimeToString3(time_t time);
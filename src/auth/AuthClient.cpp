@@ -15,6 +15,7 @@
 #include "../taa/TaaClient.h"
 #include "../sam3/Sam3Client.h"
 #include "../sso/SsoClient.h"
+#include "../log/DebugLog.h"
 
 void AuthClient::SetSam3Url(const std::string& url) {
   m_sam3Client->SetSam3Url(url);
@@ -46,7 +47,7 @@ void AuthClient::SetTaaUrl(const std::string& url) {
 
 void AuthClient::SetAccountUri(const std::string& accountUri) {
   m_accountUri = accountUri;
-  kodi::Log(ADDON_LOG_DEBUG, "[Auth] AccountURI set to: %s", m_accountUri.c_str());
+  DEBUG_LOG("[Auth] AccountURI set to: %s", m_accountUri.c_str());
 }
 
 
@@ -59,71 +60,154 @@ AuthClient::AuthClient(CSettings* setting, HttpClient* httpclient):
   m_taaClient = new TaaClient(m_settings, m_httpClient, m_sam3Client);
 
   m_personaToken = m_settings->GetMagenta2PersonaToken();
+  m_personaTokenExpiry = GetPersonaTokenExpiry(m_personaToken);
 //  m_deviceId = m_settings->GetMagentaDeviceID();
 }
 
 
 AuthClient::~AuthClient()
 {
-
+  m_taskQueue.Stop(false);
+  delete m_taaClient;
+  delete m_sam3Client;
+  delete m_ssoClient;
 }
 
-void AuthClient::ComposePersonaToken(const std::string& dcCtsPersonaToken)
+std::string AuthClient::ComposePersonaToken(const std::string& dcCtsPersonaToken)
 {
-  kodi::Log(ADDON_LOG_DEBUG, "function call: [%s]", __FUNCTION__);
+  DEBUG_LOG("function call: [%s]", __FUNCTION__);
   std::string rawToken = m_accountUri + ":" + dcCtsPersonaToken;
-  m_personaToken = base64_encode(rawToken.c_str(), rawToken.length());
-  kodi::Log(ADDON_LOG_DEBUG, "[Auth] reported new personaToken: %s", m_personaToken.c_str());
-  m_settings->SetSetting("personaltoken", m_personaToken);
+  std::string personaToken = base64_encode(rawToken.c_str(), rawToken.length());
+  DEBUG_LOG("[Auth] reported new personaToken: %s", DebugLog::Redact(personaToken).c_str());
+  return personaToken;
 }
 
-bool AuthClient::IsPersonaTokenExpired(const std::string& personaToken)
+time_t AuthClient::GetPersonaTokenExpiry(const std::string& personaToken)
 {
-  kodi::Log(ADDON_LOG_DEBUG, "function call: [%s]", __FUNCTION__);
-
   std::string strToken = base64_decode(personaToken);
 //  kodi::Log(ADDON_LOG_DEBUG, "[Taa] decoded persona token: %s", strToken.c_str());
   std::vector<std::string> persona_arr = kodi::tools::StringUtils::Split(strToken, ":", 3);
   if (persona_arr.size() != 3)
-    return true;
+    return 0;
 
 //  kodi::Log(ADDON_LOG_DEBUG, "[Taa] decoded persona token part 2: %s", persona_arr.at(2).c_str());
 
-  return IsJWTexpired(persona_arr.at(2));
+  return GetJWTExpiry(persona_arr.at(2));
 }
 
-bool AuthClient::GetPersonaToken(std::string& personaToken)
+bool AuthClient::IsPersonaTokenExpired()
 {
-  kodi::Log(ADDON_LOG_DEBUG, "function call: [%s]", __FUNCTION__);
+  return time(nullptr) > m_personaTokenExpiry;
+}
 
-  if (m_personaToken.empty() || IsPersonaTokenExpired(m_personaToken))
+bool AuthClient::RefreshPersonaToken(std::string& personaToken)
+{
+  if (m_settings->GetTerminalType() == TERMINAL_WEB)
   {
-    kodi::Log(ADDON_LOG_DEBUG, "[Auth] Persona is empty or expired!");
-    if (m_settings->GetTerminalType() == TERMINAL_WEB)
+    if (!m_sam3Client->Sam3Login(personaToken))
     {
-      if (!m_sam3Client->Sam3Login(m_personaToken))
-      {
-        kodi::Log(ADDON_LOG_ERROR, "[Auth] Sam3Login failed!");
-        return false;
-      }
-    } else
+      kodi::Log(ADDON_LOG_ERROR, "[Auth] Sam3Login failed!");
+      return false;
+    }
+  } else
+  {
+    std::string dcCtsPersonaToken;
+    if (!m_taaClient->UpdateTaa(dcCtsPersonaToken))
     {
-      std::string dcCtsPersonaToken;
-      if (!m_taaClient->UpdateTaa(dcCtsPersonaToken))
-      {
-        kodi::Log(ADDON_LOG_ERROR, "[Auth] TAAUpdate failed!");
-        return false;
-      }
-      ComposePersonaToken(dcCtsPersonaToken);
+      kodi::Log(ADDON_LOG_ERROR, "[Auth] TAAUpdate failed!");
+      return false;
     }
-    m_settings->SetSetting("personaltoken", m_personaToken);
+    personaToken = ComposePersonaToken(dcCtsPersonaToken);
+  }
+  {
+    std::lock_guard<std::mutex> lock(m_tokenMutex);
+    m_personaToken = personaToken;
+    m_personaTokenExpiry = GetPersonaTokenExpiry(personaToken);
+  }
+  m_settings->SetSetting("personaltoken", personaToken);
+  SchedulePersonaRefresh();
+  return true;
+}
+
+bool AuthClient::RefreshOnce(std::string& personaToken)
+{
+  // callers noticing the expiry together share one TAA/SAM3 exchange
+  return m_refreshFlight.Do([this](std::string& token) { return RefreshPersonaToken(token); },
+                            personaToken);
+}
+
+void AuthClient::SchedulePersonaRefresh()
+{
+  // the persona token is derived from the TAA token, which in turn needs a
+  // SAM3 access token, so refreshing ahead of the earliest expiry renews all three
+  time_t expiry;
+  {
+    std::lock_guard<std::mutex> lock(m_tokenMutex);
+    expiry = m_personaTokenExpiry;
+  }
+  time_t taaExpiry = m_taaClient->GetTokenExpiry();
+  if ((taaExpiry > 0) && (taaExpiry < expiry))
+    expiry = taaExpiry;
+  time_t refreshAt = expiry - PERSONA_REFRESH_MARGIN;
+  time_t now = time(nullptr);
+  // an expired token is renewed by the next caller anyway, one that is about
+  // to expire (e.g. restored on a warm start) is renewed right away
+  if (expiry <= now)
+    return;
+  if (refreshAt <= now)
+  {
+    ScheduleRefresh(0);
+    return;
   }
 
-  personaToken = m_personaToken;
+  ScheduleRefresh(static_cast<int>(refreshAt - now) * 1000);
+}
+
+void AuthClient::ScheduleRefresh(const int delayMs)
+{
+  // playback should find a valid token instead of waiting for TAA/SAM3
+  m_taskQueue.Schedule("persona", delayMs, [this]() {
+    DEBUG_LOG("[Auth] Refreshing persona token ahead of expiry");
+    std::string personaToken;
+    if (!RefreshOnce(personaToken))
+      ScheduleRefresh(PERSONA_REFRESH_RETRY);
+  });
+}
+
+bool AuthClient::GetPersonaToken(std::string& personaToken)
+{
+  DEBUG_LOG("function call: [%s]", __FUNCTION__);
+
+  bool isValid = false;
+  {
+    std::lock_guard<std::mutex> lock(m_tokenMutex);
+    isValid = !m_personaToken.empty() && !IsPersonaTokenExpired();
+    if (isValid)
+      personaToken = m_personaToken;
+  }
+  if (!isValid)
+  {
+    DEBUG_LOG("[Auth] Persona is empty or expired!");
+    return RefreshOnce(personaToken);
+  }
+  if (!m_taskQueue.IsPending("persona"))
+    SchedulePersonaRefresh();
 
   return true;
 }
 
+void AuthClient::SaveState(AuthState& state)
+{
+  m_sam3Client->SaveState(state);
+  m_taaClient->SaveState(state);
+}
+
+void AuthClient::RestoreState(const AuthState& state)
+{
+  m_sam3Client->RestoreState(state);
+  m_taaClient->RestoreState(state);
+}
+
 bool AuthClient::ReLogin()
 {
   return m_sam3Client->ReAuthenticate(GRANTREMOTELOGIN);
@@ -7,9 +7,17 @@
 
 #pragma once
 
+#include <ctime>
+#include <mutex>
 #include "../Settings.h"
 #include "../http/HttpClient.h"
 #include "../sam3/Sam3Client.h"
+#include "../task/TaskQueue.h"
+#include "AuthState.h"
+#include "SingleFlight.h"
+
+static const time_t PERSONA_REFRESH_MARGIN = 5 * 60; //5min before expiry
+static const int PERSONA_REFRESH_RETRY = 60 * 1000; //ms
 
 class TaaClient;
 class SsoClient;
@@ -30,13 +38,20 @@ public:
   void SetTaaUrl(const std::string& url);
   void SetAccountUri(const std::string& accountUri);
   bool ReLogin();
+  void SaveState(AuthState& state);
+  void RestoreState(const AuthState& state);
 
 //  std::string SSOLogin();
 //  bool SSOAuthenticate(const std::string& code, const std::string& state);
 
 private:
-  bool IsPersonaTokenExpired(const std::string& personaToken);
-  void ComposePersonaToken(const std::string& dcCtsPersonaToken);
+  bool IsPersonaTokenExpired();
+  time_t GetPersonaTokenExpiry(const std::string& personaToken);
+  std::string ComposePersonaToken(const std::string& dcCtsPersonaToken);
+  bool RefreshPersonaToken(std::string& personaToken);
+  bool RefreshOnce(std::string& personaToken);
+  void SchedulePersonaRefresh();
+  void ScheduleRefresh(const int delayMs);
 
   CSettings* m_settings;
   HttpClient* m_httpClient;
@@ -45,5 +60,9 @@ private:
   Sam3Client* m_sam3Client;
 
   std::string m_personaToken;
+  time_t m_personaTokenExpiry;
   std::string m_accountUri;
+  std::mutex m_tokenMutex;
+  SingleFlight<std::string> m_refreshFlight;
+  TaskQueue m_taskQueue;
 };
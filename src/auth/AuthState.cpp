@@ -0,0 +1,220 @@
+/*
+ *  Copyright (C) 2020 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#include "AuthState.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <kodi/AddonBase.h>
+#include <kodi/Filesystem.h>
+#include "../Utils.h"
+#include "rapidjson/document.h"
+#include "rapidjson/writer.h"
+#include "rapidjson/stringbuffer.h"
+#include "../log/DebugLog.h"
+
+#ifdef TARGET_WINDOWS
+#ifdef DeleteFile
+#undef DeleteFile
+#endif
+#endif
+
+constexpr char AUTH_STATE_FILE[] = "special://profile/addon_data/pvr.magenta/authstate.json";
+constexpr char AUTH_STATE_TMP_FILE[] = "special://profile/addon_data/pvr.magenta/authstate.json.tmp";
+
+AuthState::AuthState()
+  : m_validUntil(0)
+{
+}
+
+AuthState::~AuthState()
+{
+}
+
+bool AuthState::Load(const std::string& deviceId)
+{
+  if (!kodi::vfs::FileExists(AUTH_STATE_FILE, true))
+    return false;
+
+  std::string jsonString = Utils::ReadFile(AUTH_STATE_FILE);
+  rapidjson::Document doc;
+  doc.Parse(jsonString.c_str());
+  if (doc.GetParseError() || !doc.IsObject())
+  {
+    kodi::Log(ADDON_LOG_ERROR, "[AuthState] Parsing %s failed", AUTH_STATE_FILE);
+    return false;
+  }
+  if (Utils::JsonStringOrEmpty(doc, "deviceId") != deviceId)
+  {
+    DEBUG_LOG("[AuthState] Ignoring state of another device");
+    return false;
+  }
+  time_t validUntil = static_cast<time_t>((doc.HasMember("validUntil") && doc["validUntil"].IsUint64()) ? doc["validUntil"].GetUint64() : 0);
+  if (validUntil < time(nullptr))
+  {
+    DEBUG_LOG("[AuthState] Ignoring expired state");
+    return false;
+  }
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_validUntil = validUntil;
+  m_values.clear();
+  m_lists.clear();
+  if (doc.HasMember("values"))
+  {
+    const rapidjson::Value& values = doc["values"];
+    for (rapidjson::Value::ConstMemberIterator itr = values.MemberBegin(); itr != values.MemberEnd(); ++itr)
+    {
+      if (itr->value.IsString())
+        m_values[itr->name.GetString()] = itr->value.GetString();
+    }
+  }
+  if (doc.HasMember("lists"))
+  {
+    const rapidjson::Value& lists = doc["lists"];
+    for (rapidjson::Value::ConstMemberIterator itr = lists.MemberBegin(); itr != lists.MemberEnd(); ++itr)
+    {
+      if (!itr->value.IsArray())
+        continue;
+      std::vector<std::string>& list = m_lists[itr->name.GetString()];
+      for (rapidjson::SizeType i = 0; i < itr->value.Size(); i++)
+      {
+        if (itr->value[i].IsString())
+          list.emplace_back(itr->value[i].GetString());
+      }
+    }
+  }
+  DEBUG_LOG("[AuthState] Loaded state valid until %u", static_cast<unsigned int>(validUntil));
+
+  return true;
+}
+
+bool AuthState::Save(const std::string& deviceId)
+{
+  rapidjson::StringBuffer buffer;
+  rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+  writer.StartObject();
+  writer.Key("deviceId");
+  writer.String(deviceId.c_str());
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    // saving alone does not make the snapshot any fresher
+    writer.Key("validUntil");
+    writer.Uint64(static_cast<uint64_t>(m_validUntil));
+    writer.Key("values");
+    writer.StartObject();
+    for (const auto& value : m_values)
+    {
+      writer.Key(value.first.c_str());
+      writer.String(value.second.c_str());
+    }
+    writer.EndObject();
+    writer.Key("lists");
+    writer.StartObject();
+    for (const auto& list : m_lists)
+    {
+      writer.Key(list.first.c_str());
+      writer.StartArray();
+      for (const auto& value : list.second)
+        writer.String(value.c_str());
+      writer.EndArray();
+    }
+    writer.EndObject();
+  }
+  writer.EndObject();
+
+  // write aside and rename, a crash mid-write must not leave a truncated state behind
+  {
+    kodi::vfs::CFile file;
+    if (!file.OpenFileForWrite(AUTH_STATE_TMP_FILE, true))
+    {
+      kodi::Log(ADDON_LOG_ERROR, "[AuthState] Could not write %s", AUTH_STATE_TMP_FILE);
+      return false;
+    }
+    const char* output = buffer.GetString();
+    if (file.Write(output, strlen(output)) != static_cast<ssize_t>(strlen(output)))
+    {
+      kodi::Log(ADDON_LOG_ERROR, "[AuthState] Short write to %s", AUTH_STATE_TMP_FILE);
+      return false;
+    }
+  }
+  if (!kodi::vfs::RenameFile(AUTH_STATE_TMP_FILE, AUTH_STATE_FILE))
+  {
+    // some platforms refuse to rename onto an existing file
+    kodi::vfs::DeleteFile(AUTH_STATE_FILE);
+    if (!kodi::vfs::RenameFile(AUTH_STATE_TMP_FILE, AUTH_STATE_FILE))
+    {
+      kodi::Log(ADDON_LOG_ERROR, "[AuthState] Could not replace %s", AUTH_STATE_FILE);
+      return false;
+    }
+  }
+
+  return true;
+}
+
+void AuthState::Clear()
+{
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_values.clear();
+    m_lists.clear();
+    m_validUntil = 0;
+  }
+  if (kodi::vfs::FileExists(AUTH_STATE_FILE, true))
+    kodi::vfs::DeleteFile(AUTH_STATE_FILE);
+}
+
+void AuthState::MarkValidated()
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_validUntil = time(nullptr) + AUTH_STATE_TTL;
+}
+
+bool AuthState::GetString(const std::string& key, std::string& value) const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  auto it = m_values.find(key);
+  if (it == m_values.end())
+    return false;
+  value = it->second;
+  return true;
+}
+
+void AuthState::SetString(const std::string& key, const std::string& value)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_values[key] = value;
+}
+
+time_t AuthState::GetTime(const std::string& key) const
+{
+  std::string value;
+  if (!GetString(key, value) || value.empty())
+    return 0;
+  return static_cast<time_t>(strtoll(value.c_str(), nullptr, 10));
+}
+
+void AuthState::SetTime(const std::string& key, const time_t value)
+{
+  SetString(key, std::to_string(static_cast<long long>(value)));
+}
+
+bool AuthState::GetList(const std::string& key, std::vector<std::string>& values) const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  auto it = m_lists.find(key);
+  if (it == m_lists.end())
+    return false;
+  values = it->second;
+  return true;
+}
+
+void AuthState::SetList(const std::string& key, const std::vector<std::string>& values)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_lists[key] = values;
+}
@@ -0,0 +1,45 @@
+/*
+ *  Copyright (C) 2020 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#pragma once
+
+#include <ctime>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+static const time_t AUTH_STATE_TTL = 24 * 60 * 60; //1 day after the last revalidation
+
+// Snapshot of everything the backend handed out during login (manifest,
+// endpoints, tokens, distribution rights), persisted to the profile so a
+// restart can skip those round trips while the snapshot is fresh.
+class AuthState
+{
+public:
+  AuthState();
+  ~AuthState();
+
+  bool Load(const std::string& deviceId);
+  bool Save(const std::string& deviceId);
+  void Clear();
+  // the snapshot was just fetched or checked against the backend, trust it for AUTH_STATE_TTL
+  void MarkValidated();
+
+  bool GetString(const std::string& key, std::string& value) const;
+  void SetString(const std::string& key, const std::string& value);
+  time_t GetTime(const std::string& key) const;
+  void SetTime(const std::string& key, const time_t value);
+  bool GetList(const std::string& key, std::vector<std::string>& values) const;
+  void SetList(const std::string& key, const std::vector<std::string>& values);
+
+private:
+  mutable std::mutex m_mutex;
+  std::map<std::string, std::string> m_values;
+  std::map<std::string, std::vector<std::string>> m_lists;
+  time_t m_validUntil;
+};
@@ -6,6 +6,10 @@
  */
 
 #include "JWT.h"
+
+#include <mutex>
+#include <unordered_map>
+
 #include "kodi/tools/StringUtils.h"
 #include "rapidjson/document.h"
 #include "../Base64.h"
@@ -27,10 +31,10 @@ bool ParseToken(const std::string& token, std::string& header, std::string& payl
   return true;
 }
 
-bool IsJWTexpired(const std::string& token)
+JWT::JWT(const std::string& token)
+  : m_valid(false),
+    m_claims()
 {
-//  kodi::Log(ADDON_LOG_DEBUG, "function call: [%s]", __FUNCTION__);
-
   std::string header;
   std::string payload;
   std::string signature;
@@ -40,7 +44,7 @@ bool IsJWTexpired(const std::string& token)
   if (!ParseToken(token, header, payload, signature))
   {
 //    kodi::Log(ADDON_LOG_ERROR, "[Auth] Token Parse error");
-    return true;
+    return;
   }
 
   std::string decPayload = base64_decode(payload);
@@ -49,19 +53,49 @@ bool IsJWTexpired(const std::string& token)
 
   rapidjson::Document doc;
   doc.Parse(decPayload.c_str());
-  if (doc.GetParseError())
+  if (doc.GetParseError() || !doc.IsObject())
   {
 //    kodi::Log(ADDON_LOG_ERROR, "[Auth] JWTexpired JSON parse error for %s", decPayload.c_str());
-    return true;
+    return;
   }
 
-  time_t tokenExp = Utils::JsonIntOrZero(doc, "exp");
+  m_claims.iat = Utils::JsonIntOrZero(doc, "iat");
+  m_claims.exp = Utils::JsonIntOrZero(doc, "exp");
+  m_claims.personaToken = Utils::JsonStringOrEmpty(doc, "dc_cts_personaToken");
+  m_claims.accountToken = Utils::JsonStringOrEmpty(doc, "dc_cts_accountToken");
+  m_claims.personaId = Utils::JsonStringOrEmpty(doc, "dc_cts_personaId");
+  m_claims.consumerId = Utils::JsonStringOrEmpty(doc, "dc_cts_consumerId");
+  m_claims.accountId = Utils::JsonStringOrEmpty(doc, "dc_cts_accountId");
+  m_claims.tvAccountId = Utils::JsonStringOrEmpty(doc, "dc_tvAccountId");
+  m_valid = true;
+}
+
+std::shared_ptr<const JWT> JWT::Get(const std::string& token)
+{
+  // a handful of tokens are live at any time and checked on every request
+  static std::mutex cacheMutex;
+  static std::unordered_map<std::string, std::shared_ptr<const JWT>> cache;
+
+  std::lock_guard<std::mutex> lock(cacheMutex);
+  auto it = cache.find(token);
+  if (it != cache.end())
+    return it->second;
+
+  if (cache.size() >= JWT_CACHE_SIZE)
+    cache.clear();
+  std::shared_ptr<const JWT> jwt = std::make_shared<const JWT>(token);
+  cache.emplace(token, jwt);
+  return jwt;
+}
 
-//  kodi::Log(ADDON_LOG_DEBUG, "[Auth] Test if expired: %u", tokenExp);
+time_t GetJWTExpiry(const std::string& token)
+{
+  return JWT::Get(token)->GetExpiry();
+}
 
-  bool isExpired = (time(NULL) > tokenExp);
-//  if (isExpired)
-//    kodi::Log(ADDON_LOG_DEBUG, "[Auth] JWT is expired!");
+bool IsJWTexpired(const std::string& token)
+{
+//  kodi::Log(ADDON_LOG_DEBUG, "function call: [%s]", __FUNCTION__);
 
-  return isExpired;
+  return JWT::Get(token)->IsExpired(time(NULL));
 }
@@ -1,4 +1,41 @@
+#pragma once
+
+#include <ctime>
+#include <memory>
 #include <string>
 
+static const size_t JWT_CACHE_SIZE = 16;
+
+struct JWTClaims
+{
+  time_t iat;
+  time_t exp;
+  std::string personaToken;
+  std::string accountToken;
+  std::string personaId;
+  std::string consumerId;
+  std::string accountId;
+  std::string tvAccountId;
+};
+
+// Decoded token, the payload is parsed once on construction
+class JWT
+{
+public:
+  JWT(const std::string& token);
+
+  static std::shared_ptr<const JWT> Get(const std::string& token);
+
+  bool IsValid() const { return m_valid; }
+  time_t GetExpiry() const { return m_claims.exp; }
+  bool IsExpired(const time_t now) const { return now > m_claims.exp; }
+  const JWTClaims& GetClaims() const { return m_claims; }
+
+private:
+  bool m_valid;
+  JWTClaims m_claims;
+};
+
 bool ParseToken(const std::string& token, std::string& header, std::string& payload, std::string& signature);
+time_t GetJWTExpiry(const std::string& token);
 bool IsJWTexpired(const std::string& token);
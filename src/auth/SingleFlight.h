@@ -0,0 +1,90 @@
+/*
+ *  Copyright (C) 2020 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+// Collapses concurrent calls of the same operation into one. The first caller
+// runs it, callers arriving while it is in flight wait and share its result.
+// A nested call from the running thread is executed directly, as it would
+// otherwise wait for itself.
+template <typename T = bool>
+class SingleFlight
+{
+public:
+  SingleFlight() : m_inFlight(false), m_generation(0), m_ok(false), m_result() {}
+
+  bool Do(const std::function<bool(T&)>& fn, T& result)
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if (m_inFlight)
+    {
+      if (m_owner == std::this_thread::get_id())
+      {
+        lock.unlock();
+        return fn(result);
+      }
+      uint64_t generation = m_generation;
+      m_cond.wait(lock, [this, generation]() { return m_generation != generation; });
+      result = m_result;
+      return m_ok;
+    }
+    m_inFlight = true;
+    m_owner = std::this_thread::get_id();
+    lock.unlock();
+
+    T value = T();
+    bool ok = false;
+    try
+    {
+      ok = fn(value);
+    }
+    catch (...)
+    {
+      // the waiting callers see a failure, the exception stays with the caller that ran it
+      Finish(false, T());
+      throw;
+    }
+    Finish(ok, value);
+
+    result = value;
+    return ok;
+  }
+
+  bool Do(const std::function<bool()>& fn)
+  {
+    T unused;
+    return Do([&fn](T&) { return fn(); }, unused);
+  }
+
+private:
+  void Finish(const bool ok, const T& value)
+  {
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_result = value;
+      m_ok = ok;
+      m_inFlight = false;
+      m_owner = std::thread::id();
+      m_generation++;
+    }
+    m_cond.notify_all();
+  }
+
+  std::mutex m_mutex;
+  std::condition_variable m_cond;
+  bool m_inFlight;
+  std::thread::id m_owner;
+  uint64_t m_generation;
+  bool m_ok;
+  T m_result;
+};
@@ -0,0 +1,158 @@
+/*
+ *  Copyright (C) 2020 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#include "ConcurrencyClient.h"
+
+#include <kodi/AddonBase.h>
+#include <vector>
+#include "../Utils.h"
+#include "../log/DebugLog.h"
+
+ConcurrencyClient::ConcurrencyClient(HttpClient* httpclient, const std::string& clientId)
+  : m_httpClient(httpclient),
+    m_clientId(clientId)
+{
+}
+
+ConcurrencyClient::~ConcurrencyClient()
+{
+  // pending keep-alive updates are pointless now, but queued unlocks of
+  // already released locks must still go out
+  std::vector<std::string> ids;
+  {
+    std::lock_guard<std::mutex> guard(m_mutex);
+    for (const auto& tracked : m_locks)
+      ids.emplace_back(tracked.first);
+  }
+  for (const auto& id : ids)
+    m_taskQueue.Cancel("update:" + id);
+  m_taskQueue.Stop(true);
+  ReleaseAll();
+}
+
+void ConcurrencyClient::Track(const Magenta2Lock& lock, const bool keepAlive)
+{
+  if (lock.serviceUrl.empty() || lock.id.empty())
+    return;
+
+  {
+    std::lock_guard<std::mutex> guard(m_mutex);
+    m_locks[lock.id] = {lock, keepAlive};
+  }
+  if (keepAlive)
+    ScheduleUpdate(lock.id, lock.updateInterval);
+}
+
+void ConcurrencyClient::Release(const Magenta2Lock& lock)
+{
+  if (lock.serviceUrl.empty())
+    return;
+
+  Magenta2Lock current = lock;
+  {
+    std::lock_guard<std::mutex> guard(m_mutex);
+    auto it = m_locks.find(lock.id);
+    if (it != m_locks.end())
+    {
+      // an update may have rotated the sequence token in the meantime
+      current = it->second.lock;
+      m_locks.erase(it);
+    }
+  }
+  m_taskQueue.Cancel("update:" + current.id);
+  m_taskQueue.Post([this, current]() { Unlock(current); });
+}
+
+void ConcurrencyClient::ReleaseAll()
+{
+  std::vector<Magenta2Lock> locks;
+  {
+    std::lock_guard<std::mutex> guard(m_mutex);
+    for (const auto& tracked : m_locks)
+      locks.emplace_back(tracked.second.lock);
+    m_locks.clear();
+  }
+  for (const auto& lock : locks)
+  {
+    m_taskQueue.Cancel("update:" + lock.id);
+    Unlock(lock);
+  }
+}
+
+size_t ConcurrencyClient::Count()
+{
+  std::lock_guard<std::mutex> guard(m_mutex);
+  return m_locks.size();
+}
+
+void ConcurrencyClient::ScheduleUpdate(const std::string& id, const int updateInterval)
+{
+  if (updateInterval <= LOCK_UPDATE_MARGIN)
+    return;
+
+  m_taskQueue.Schedule("update:" + id, (updateInterval - LOCK_UPDATE_MARGIN) * 1000,
+                       [this, id]() { Update(id); });
+}
+
+void ConcurrencyClient::Update(const std::string& id)
+{
+  Magenta2Lock lock;
+  {
+    std::lock_guard<std::mutex> guard(m_mutex);
+    auto it = m_locks.find(id);
+    if ((it == m_locks.end()) || !it->second.keepAlive)
+      return;
+    lock = it->second.lock;
+  }
+
+  rapidjson::Document doc;
+  if (!Request(lock, "update", doc) || !doc.HasMember("updateResponse"))
+  {
+    kodi::Log(ADDON_LOG_ERROR, "Failed to update concurrency lock %s", id.c_str());
+    return;
+  }
+  const rapidjson::Value& response = doc["updateResponse"];
+
+  std::lock_guard<std::mutex> guard(m_mutex);
+  auto it = m_locks.find(id);
+  if (it == m_locks.end())
+    return;
+  std::string token = Utils::JsonStringOrEmpty(response, "sequenceToken");
+  if (!token.empty())
+    it->second.lock.token = token;
+  std::string encryptedLock = Utils::JsonStringOrEmpty(response, "encryptedLock");
+  if (!encryptedLock.empty())
+    it->second.lock.lock = encryptedLock;
+  ScheduleUpdate(id, it->second.lock.updateInterval);
+}
+
+bool ConcurrencyClient::Unlock(const Magenta2Lock& lock)
+{
+  DEBUG_LOG("function call: [%s]", __FUNCTION__);
+  rapidjson::Document doc;
+  return Request(lock, "unlock", doc);
+}
+
+bool ConcurrencyClient::Request(const Magenta2Lock& lock, const std::string& method, rapidjson::Document& doc)
+{
+  std::string url = lock.serviceUrl + "/web/Concurrency/" + method + "?_clientId=" + m_clientId +
+                                      "&_encryptedLock=" + Utils::UrlEncode(lock.lock) +
+                                      "&_id=" + Utils::UrlEncode(lock.id) +
+                                      "&_sequenceToken=" + Utils::UrlEncode(lock.token) +
+                                      "&form=json&schema=1.0";
+
+  int statusCode = 0;
+  std::string result = m_httpClient->HttpGet(url, statusCode);
+  doc.Parse(result.c_str());
+  if ((doc.GetParseError()) || (statusCode != 200) || doc.HasMember("isException"))
+  {
+    kodi::Log(ADDON_LOG_ERROR, "Concurrency %s failed for lock %s status code: %i",
+              method.c_str(), lock.id.c_str(), statusCode);
+    return false;
+  }
+  return true;
+}
@@ -0,0 +1,61 @@
+/*
+ *  Copyright (C) 2020 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#pragma once
+
+#include <map>
+#include <mutex>
+#include <string>
+#include "../http/HttpClient.h"
+#include "../task/TaskQueue.h"
+#include "rapidjson/document.h"
+
+static const int LOCK_UPDATE_MARGIN = 10; //s before the interval runs out
+
+struct Magenta2Lock
+{
+  std::string instance;
+  std::string token;
+  std::string id;
+  std::string lock;
+  std::string sequenceToken;
+  std::string serviceUrl;
+  int updateInterval;
+};
+
+// Owns every concurrency lock handed out by the media selector. Unlocks
+// and keep-alive updates run on a background queue so playback never
+// waits on the concurrency service.
+class ConcurrencyClient
+{
+public:
+  ConcurrencyClient(HttpClient* httpclient, const std::string& clientId);
+  ~ConcurrencyClient();
+
+  void Track(const Magenta2Lock& lock, const bool keepAlive);
+  void Release(const Magenta2Lock& lock);
+  void ReleaseAll();
+  size_t Count();
+
+private:
+  struct TrackedLock
+  {
+    Magenta2Lock lock;
+    bool keepAlive;
+  };
+
+  void ScheduleUpdate(const std::string& id, const int updateInterval);
+  void Update(const std::string& id);
+  bool Unlock(const Magenta2Lock& lock);
+  bool Request(const Magenta2Lock& lock, const std::string& method, rapidjson::Document& doc);
+
+  HttpClient* m_httpClient;
+  std::string m_clientId;
+  std::mutex m_mutex;
+  std::map<std::string, TrackedLock> m_locks;
+  TaskQueue m_taskQueue;
+};
@@ -0,0 +1,55 @@
+/*
+ *  Copyright (C) 2020 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#include "PlaybackCache.h"
+
+PlaybackCache::PlaybackCache(const time_t ttl)
+  : m_ttl(ttl)
+{
+}
+
+PlaybackCache::~PlaybackCache()
+{
+}
+
+bool PlaybackCache::Get(const std::string& key, PlaybackInfo& info)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  auto it = m_entries.find(key);
+  if (it == m_entries.end())
+    return false;
+  if (it->second.validUntil <= time(nullptr))
+  {
+    m_entries.erase(it);
+    return false;
+  }
+  info = it->second;
+  return true;
+}
+
+void PlaybackCache::Put(const std::string& key, PlaybackInfo& info)
+{
+  time_t now = time(nullptr);
+  info.validUntil = now + m_ttl;
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+  // entries live for seconds, dropping stale ones on write keeps the map tiny
+  for (auto it = m_entries.begin(); it != m_entries.end();)
+  {
+    if (it->second.validUntil <= now)
+      it = m_entries.erase(it);
+    else
+      ++it;
+  }
+  m_entries[key] = info;
+}
+
+void PlaybackCache::Remove(const std::string& key)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_entries.erase(key);
+}
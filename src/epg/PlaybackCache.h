@@ -0,0 +1,41 @@
+/*
+ *  Copyright (C) 2020 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#pragma once
+
+#include <ctime>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+static const time_t PLAYBACK_CACHE_TTL = 60;
+
+struct PlaybackInfo
+{
+  std::string url;
+  time_t availableFrom;
+  time_t availableUntil;
+  time_t validUntil;
+};
+
+// Short lived store for resolved playback urls, keyed by broadcast guid or
+// pvrId, so "is it playable" and "play it" share one backend round trip.
+class PlaybackCache
+{
+public:
+  PlaybackCache(const time_t ttl = PLAYBACK_CACHE_TTL);
+  ~PlaybackCache();
+
+  bool Get(const std::string& key, PlaybackInfo& info);
+  void Put(const std::string& key, PlaybackInfo& info);
+  void Remove(const std::string& key);
+
+private:
+  std::mutex m_mutex;
+  std::unordered_map<std::string, PlaybackInfo> m_entries;
+  time_t m_ttl;
+};
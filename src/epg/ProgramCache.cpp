@@ -0,0 +1,91 @@
+/*
+ *  Copyright (C) 2020 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#include "ProgramCache.h"
+
+#include <kodi/AddonBase.h>
+#include "../log/DebugLog.h"
+
+ProgramCache::ProgramCache(const time_t ttl)
+  : m_ttl(ttl),
+    m_lastCleanup(time(nullptr))
+{
+}
+
+ProgramCache::~ProgramCache()
+{
+}
+
+bool ProgramCache::Contains(const std::string& guid)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  auto it = m_programs.find(guid);
+  return (it != m_programs.end()) && (it->second.validUntil > time(nullptr));
+}
+
+bool ProgramCache::Get(const std::string& guid, Magenta2Program& program)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  auto it = m_programs.find(guid);
+  if ((it == m_programs.end()) || (it->second.validUntil <= time(nullptr)))
+    return false;
+  program = it->second;
+  return true;
+}
+
+void ProgramCache::Put(Magenta2Program& program)
+{
+  time_t now = time(nullptr);
+  program.validUntil = now + m_ttl;
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_programs[program.guid] = program;
+  if (m_lastCleanup + m_ttl < now)
+    Cleanup(now);
+}
+
+bool ProgramCache::UpdateMedia(const std::string& guid, const std::string& publicUrl,
+                               const time_t availableFrom, const time_t availableUntil)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  auto it = m_programs.find(guid);
+  if (it == m_programs.end())
+    return false;
+  // only the media changes, the metadata keeps its own expiry
+  it->second.publicUrl = publicUrl;
+  it->second.availableFrom = availableFrom;
+  it->second.availableUntil = availableUntil;
+  it->second.mediaCheckedAt = time(nullptr);
+  return true;
+}
+
+void ProgramCache::Clear()
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_programs.clear();
+}
+
+size_t ProgramCache::Size()
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_programs.size();
+}
+
+void ProgramCache::Cleanup(const time_t now)
+{
+  size_t before = m_programs.size();
+  for (auto it = m_programs.begin(); it != m_programs.end();)
+  {
+    if (it->second.validUntil <= now)
+      it = m_programs.erase(it);
+    else
+      ++it;
+  }
+  m_lastCleanup = now;
+  DEBUG_LOG("Program cache cleanup removed %i of %i entries",
+            static_cast<int>(before - m_programs.size()), static_cast<int>(before));
+}
@@ -0,0 +1,67 @@
+/*
+ *  Copyright (C) 2020 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#pragma once
+
+#include <ctime>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+static const time_t PROGRAM_CACHE_TTL = 6 * 60 * 60; //6h
+
+struct Magenta2Program
+{
+  std::string guid;
+  unsigned int broadcastId;
+  std::string title;
+  std::string plot;
+  std::string plotOutline;
+  std::string iconPath;
+  int seriesNumber;
+  int episodeNumber;
+  int year;
+  std::string episodeName;
+  std::string seriesLink;
+  int parentalRating;
+  std::string imdbNumber;
+  std::string cast;
+  std::string director;
+  std::string writer;
+  int genreType;
+  int genreSubType;
+  std::string genreDescription;
+  unsigned int flags;
+  std::string publicUrl;
+  time_t availableFrom;
+  time_t availableUntil;
+  time_t mediaCheckedAt;
+  time_t validUntil;
+};
+
+class ProgramCache
+{
+public:
+  ProgramCache(const time_t ttl = PROGRAM_CACHE_TTL);
+  ~ProgramCache();
+
+  bool Contains(const std::string& guid);
+  bool Get(const std::string& guid, Magenta2Program& program);
+  void Put(Magenta2Program& program);
+  bool UpdateMedia(const std::string& guid, const std::string& publicUrl,
+                   const time_t availableFrom, const time_t availableUntil);
+  void Clear();
+  size_t Size();
+
+private:
+  void Cleanup(const time_t now);
+
+  std::mutex m_mutex;
+  std::unordered_map<std::string, Magenta2Program> m_programs;
+  time_t m_ttl;
+  time_t m_lastCleanup;
+};
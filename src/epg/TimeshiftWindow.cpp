@@ -0,0 +1,102 @@
+/*
+ *  Copyright (C) 2020 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#include "TimeshiftWindow.h"
+
+#include <algorithm>
+
+TimeshiftWindow::TimeshiftWindow(const time_t buffer)
+  : m_clock([]() { return time(nullptr); }),
+    m_buffer(buffer)
+{
+}
+
+TimeshiftWindow::~TimeshiftWindow()
+{
+}
+
+void TimeshiftWindow::SetClock(const timeshiftclock_t& clock)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_clock = clock;
+}
+
+time_t TimeshiftWindow::Now() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_clock();
+}
+
+void TimeshiftWindow::UpdateLiveEdge(const int& channelUid, const time_t liveEdge)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  time_t delay = m_clock() - liveEdge;
+  if (delay > 0)
+    m_delays[channelUid] = delay;
+  else
+    m_delays.erase(channelUid);
+}
+
+void TimeshiftWindow::ResetLiveEdge(const int& channelUid)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_delays.erase(channelUid);
+}
+
+time_t TimeshiftWindow::GetDelay(const int& channelUid) const
+{
+  auto it = m_delays.find(channelUid);
+  return (it != m_delays.end()) ? it->second : 0;
+}
+
+time_t TimeshiftWindow::GetLiveEdge(const int& channelUid) const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_clock() - GetDelay(channelUid);
+}
+
+TimeshiftBounds TimeshiftWindow::GetBounds(const int& channelUid) const
+{
+  time_t liveEdge = GetLiveEdge(channelUid);
+  return {liveEdge - m_buffer, liveEdge};
+}
+
+bool TimeshiftWindow::IsPlayable(const int& channelUid, const time_t startTime) const
+{
+  TimeshiftBounds bounds = GetBounds(channelUid);
+  return (startTime > bounds.start) && (startTime < bounds.end);
+}
+
+void TimeshiftWindow::GetEdl(const int& channelUid, const time_t startTime, const time_t endTime,
+                             std::vector<kodi::addon::PVREDLEntry>& edl) const
+{
+  // the stream covers the whole window, offsets are relative to its start
+  TimeshiftBounds bounds = GetBounds(channelUid);
+  time_t length = bounds.end - bounds.start;
+
+  kodi::addon::PVREDLEntry entry;
+  entry.SetStart(0);
+  entry.SetEnd(std::min(std::max(startTime - bounds.start, time_t(0)), length) * 1000);
+  entry.SetType(PVR_EDL_TYPE_COMBREAK);
+  edl.emplace_back(entry);
+
+  if ((endTime > bounds.start) && (endTime < bounds.end))
+  {
+    entry.SetStart((endTime - bounds.start) * 1000);
+    entry.SetEnd(length * 1000);
+    entry.SetType(PVR_EDL_TYPE_COMBREAK);
+    edl.emplace_back(entry);
+  }
+}
+
+time_t TimeshiftWindow::ClampBegin(const int& channelUid, const time_t begin) const
+{
+  TimeshiftBounds bounds = GetBounds(channelUid);
+  if (begin < bounds.start)
+    return bounds.start + TIMESHIFT_BEGIN_MARGIN;
+  return begin;
+}
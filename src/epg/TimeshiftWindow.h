@@ -0,0 +1,59 @@
+/*
+ *  Copyright (C) 2020 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#pragma once
+
+#include <ctime>
+#include <functional>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include <kodi/addon-instance/PVR.h>
+
+static const time_t TIMESHIFT_BEGIN_MARGIN = 10; //s
+static const int TIMESHIFT_ANY_CHANNEL = -1;
+
+typedef std::function<time_t()> timeshiftclock_t;
+
+struct TimeshiftBounds
+{
+  time_t start;
+  time_t end;
+};
+
+// Playable window of the backend timeshift buffer. The live edge is tracked
+// per channel as a delay behind the clock, so every query is a single clock
+// read plus one map lookup. The clock can be replaced to run the window math
+// without wall-clock calls.
+class TimeshiftWindow
+{
+public:
+  TimeshiftWindow(const time_t buffer);
+  ~TimeshiftWindow();
+
+  void SetClock(const timeshiftclock_t& clock);
+  time_t Now() const;
+
+  void UpdateLiveEdge(const int& channelUid, const time_t liveEdge);
+  void ResetLiveEdge(const int& channelUid);
+  time_t GetLiveEdge(const int& channelUid) const;
+
+  TimeshiftBounds GetBounds(const int& channelUid) const;
+  bool IsPlayable(const int& channelUid, const time_t startTime) const;
+  void GetEdl(const int& channelUid, const time_t startTime, const time_t endTime,
+              std::vector<kodi::addon::PVREDLEntry>& edl) const;
+  time_t ClampBegin(const int& channelUid, const time_t begin) const;
+
+private:
+  time_t GetDelay(const int& channelUid) const;
+
+  mutable std::mutex m_mutex;
+  std::unordered_map<int, time_t> m_delays;
+  timeshiftclock_t m_clock;
+  time_t m_buffer;
+};
@@ -4,6 +4,7 @@
 #include "../Utils.h"
 #include "rapidjson/writer.h"
 #include "rapidjson/stringbuffer.h"
+#include "../log/DebugLog.h"
 
 #ifdef TARGET_WINDOWS
 #include "../windows.h"
@@ -46,12 +47,12 @@ bool Cache::Read(const std::string& key, std::string& data)
 
   if (!IsStillValid(doc))
   {
-    kodi::Log(ADDON_LOG_DEBUG, "Ignoring cache file [%s] due to expiry.",
+    DEBUG_LOG("Ignoring cache file [%s] due to expiry.",
         cacheFile.c_str());
     return false;
   }
 
-  kodi::Log(ADDON_LOG_DEBUG, "Load from cache file [%s].", cacheFile.c_str());
+  DEBUG_LOG("Load from cache file [%s].", cacheFile.c_str());
   data = doc["data"].GetString();
   return !data.empty();
 }
@@ -130,10 +131,10 @@ void Cache::Cleanup()
 
     if (!IsStillValid(doc))
     {
-      kodi::Log(ADDON_LOG_DEBUG, "Deleting expired cache file [%s].", path.c_str());
+      DEBUG_LOG("Deleting expired cache file [%s].", path.c_str());
       if (!kodi::vfs::DeleteFile(path))
       {
-        kodi::Log(ADDON_LOG_DEBUG, "Deletion of file [%s] failed.", path.c_str());
+        DEBUG_LOG("Deletion of file [%s] failed.", path.c_str());
       }
     }
   }
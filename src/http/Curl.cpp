@@ -2,6 +2,7 @@
 #include <kodi/Filesystem.h>
 #include <utility>
 #include "../Utils.h"
+#include "../log/DebugLog.h"
 
 Curl::Curl()
 = default;
@@ -106,7 +107,7 @@ std::string Curl::Request(const std::string& action, const std::string& url, con
       continue;
     }
     m_cookies[parts[0]] = parts[1];
-    kodi::Log(ADDON_LOG_DEBUG, "Got cookie: %s.", parts[0].c_str());
+    DEBUG_LOG("Got cookie: %s.", DebugLog::Redact(parts[0]).c_str());
   }
 
   m_location = file.GetPropertyValue(ADDON_FILE_PROPERTY_RESPONSE_HEADER, "Location");
@@ -7,6 +7,9 @@
 #include <kodi/AddonBase.h>
 #include "../Settings.h"
 #include "../auth/AuthClient.h"
+#include "../task/StartupProfiler.h"
+#include "../trace/Trace.h"
+#include "../log/DebugLog.h"
 /*
 static const std::string MAGENTA_USER_AGENT = std::string("Kodi/")
     + std::string(STR(KODI_VERSION)) + std::string(" pvr.magenta/")
@@ -14,8 +17,9 @@ static const std::string MAGENTA_USER_AGENT = std::string("Kodi/")
 */
 static const std::string SSO_USER_AGENT = "Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 (KHTML, like Gecko) Chrome/120.0.0.0 Safari/537.36";
 
-HttpClient::HttpClient(CSettings* settings):
-  m_settings(settings)
+HttpClient::HttpClient(CSettings* settings, HttpMetrics* metrics):
+  m_settings(settings),
+  m_metrics(metrics)
 {
   m_sessionId = "";
   m_platform = m_settings->GetTerminalType();
@@ -27,20 +31,25 @@ HttpClient::~HttpClient()
 }
 
 void HttpClient::SetSessionId(const std::string& id) {
+  std::lock_guard<std::mutex> lock(m_mutex);
   m_sessionId = id;
 }
 
 void HttpClient::SetDeviceToken(const std::string& token) {
-  m_deviceToken = token;
-  kodi::Log(ADDON_LOG_DEBUG, "Device Token set to: %s", token.c_str());
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_deviceToken = token;
+  }
+  DEBUG_LOG("Device Token set to: %s", DebugLog::Redact(token).c_str());
 }
 
 void HttpClient::ClearSession() {
-  m_uuid = GetUUID();
+  GetUUID();
 }
 
 std::string HttpClient::GetUUID()
 {
+  std::lock_guard<std::mutex> lock(m_mutex);
   if (!m_uuid.empty())
   {
     return m_uuid;
@@ -75,8 +84,13 @@ std::string HttpClient::HttpGetCached(const std::string& url, time_t cacheDurati
   std::string content;
   std::string cacheKey = md5(url);
   statusCode = 200;
-  if (!Cache::Read(cacheKey, content))
+  if (Cache::Read(cacheKey, content))
+  {
+    m_metrics->AddCacheHit(url);
+  }
+  else
   {
+    m_metrics->AddCacheMiss(url);
     content = HttpGet(url, statusCode);
     if (!content.empty())
     {
@@ -91,22 +105,38 @@ std::string HttpClient::HttpGetCached(const std::string& url, time_t cacheDurati
 
 std::string HttpClient::HttpGet(const std::string& url, int &statusCode)
 {
-  return HttpRequest("GET", url, "", statusCode);
+  std::string effectiveUrl;
+  return HttpRequest("GET", url, "", statusCode, effectiveUrl);
 }
 
 std::string HttpClient::HttpDelete(const std::string& url, int &statusCode)
 {
-  return HttpRequest("DELETE", url, "", statusCode);
+  std::string effectiveUrl;
+  return HttpRequest("DELETE", url, "", statusCode, effectiveUrl);
 }
 
 std::string HttpClient::HttpPost(const std::string& url, const std::string& postData, int &statusCode)
 {
-  return HttpRequest("POST", url, postData, statusCode);
+  std::string effectiveUrl;
+  return HttpRequest("POST", url, postData, statusCode, effectiveUrl);
 }
 
-std::string HttpClient::HttpRequest(const std::string& action, const std::string& url, const std::string& postData, int &statusCode)
+std::string HttpClient::HttpPost(const std::string& url, const std::string& postData, int &statusCode, std::string& effectiveUrl)
+{
+  return HttpRequest("POST", url, postData, statusCode, effectiveUrl);
+}
+
+std::string HttpClient::HttpRequest(const std::string& action, const std::string& url, const std::string& postData, int &statusCode,
+                                    std::string& effectiveUrl)
 {
   Curl curl;
+  std::string sessionId;
+  std::string deviceToken;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    sessionId = m_sessionId;
+    deviceToken = m_deviceToken;
+  }
 
   if (url.find("ssom") != std::string::npos)
     curl.AddHeader("User-Agent", SSO_USER_AGENT);
@@ -118,7 +148,7 @@ std::string HttpClient::HttpRequest(const std::string& action, const std::string
     curl.AddHeader("Content-Type", "application/json");
   }
 
-  if (m_sessionId.empty())
+  if (sessionId.empty())
   {
     //MagentaTV 1
     std::string csrftoken = m_settings->GetMagentaCSRFToken();
@@ -142,13 +172,13 @@ std::string HttpClient::HttpRequest(const std::string& action, const std::string
     } else if (url.find("ssom") != std::string::npos) {
       curl.AddHeader("origin", "https://web2.magentatv.de");
       curl.AddHeader("referer", "https://web2.magentatv.de/");
-      curl.AddHeader("session-id", m_sessionId);
+      curl.AddHeader("session-id", sessionId);
       curl.AddHeader("device-id", m_settings->GetMagentaDeviceID());
     } else if (url.find("prod.dcm.telekom-dienste.de") != std::string::npos) {
-      curl.AddHeader("x-dt-session-id", m_sessionId);
+      curl.AddHeader("x-dt-session-id", sessionId);
       curl.AddHeader("x-dt-call-id", Utils::CreateUUID());
     } else if (url.find("cvss/IPTV2015%40ACC/vodclient") != std::string::npos) {
-      curl.AddHeader("x-device-authorization", "TAuth realm=\"device\",device_token=\"" + m_deviceToken + "\"");
+      curl.AddHeader("x-device-authorization", "TAuth realm=\"device\",device_token=\"" + deviceToken + "\"");
     } else if (url.find("oauth2/auth?") != std::string::npos) {
       curl.AddHeader("referer", "https://web2.magentatv.de/");
     }
@@ -160,12 +190,12 @@ std::string HttpClient::HttpRequest(const std::string& action, const std::string
     }
     if (url.find("wcps.t-online.de") != std::string::npos && (action == "GET")) {
       curl.AddHeader("x-stbserialnumber", m_settings->GetMagentaDeviceID());
-      curl.AddHeader("dt-session-id", m_sessionId);
+      curl.AddHeader("dt-session-id", sessionId);
       curl.AddHeader("dt-call-id", Utils::CreateUUID());
     }
   }
 
-  std::string content = HttpRequestToCurl(curl, action, url, postData, statusCode);
+  std::string content = HttpRequestToCurl(curl, action, url, postData, statusCode, effectiveUrl);
 
   if (statusCode >= 400 || statusCode < 200) {
     kodi::Log(ADDON_LOG_ERROR, "Open URL failed with %i.", statusCode);
@@ -178,10 +208,12 @@ std::string HttpClient::HttpRequest(const std::string& action, const std::string
 }
 
 std::string HttpClient::HttpRequestToCurl(Curl &curl, const std::string& action,
-    const std::string& url, const std::string& postData, int &statusCode)
+    const std::string& url, const std::string& postData, int &statusCode, std::string& effectiveUrl)
 {
-  kodi::Log(ADDON_LOG_DEBUG, "Http-Request: %s %s.", action.c_str(), url.c_str());
+  DEBUG_LOG("Http-Request: %s %s.", action.c_str(), DebugLog::RedactParameters(url).c_str());
+  TRACE_SCOPE("http", action + " " + HttpMetrics::GetEndpointClass(url));
   std::string content;
+  profiletime_t requestStart = std::chrono::steady_clock::now();
   if (action == "POST")
   {
     content = curl.Post(url, postData, statusCode);
@@ -194,7 +226,11 @@ std::string HttpClient::HttpRequestToCurl(Curl &curl, const std::string& action,
   {
     content = curl.Get(url, statusCode);
   }
-  m_effectiveUrl = curl.GetEffectiveUrl();
+  StartupProfiler::AddNetwork(requestStart, content.size());
+  m_metrics->AddRequest(url, statusCode,
+                       std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - requestStart).count(),
+                       postData.size(), content.size());
+  effectiveUrl = curl.GetEffectiveUrl();
   return content;
 
 }
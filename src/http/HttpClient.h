@@ -3,22 +3,25 @@
 
 #pragma once
 
+#include <mutex>
 #include "Curl.h"
 #include "../Settings.h"
 //#include "../sql/ParameterDB.h"
 #include "HttpStatusCodeHandler.h"
+#include "HttpMetrics.h"
 
 class AuthClient;
 
 class HttpClient
 {
 public:
-  HttpClient(CSettings* settings);
+  HttpClient(CSettings* settings, HttpMetrics* metrics);
   ~HttpClient();
   std::string HttpGetCached(const std::string& url, time_t cacheDuration, int &statusCode);
   std::string HttpGet(const std::string& url, int &statusCode);
   std::string HttpDelete(const std::string& url, int &statusCode);
   std::string HttpPost(const std::string& url, const std::string& postData, int &statusCode);
+  std::string HttpPost(const std::string& url, const std::string& postData, int &statusCode, std::string& effectiveUrl);
   void ClearSession();
   std::string GetUUID();
   void SetSessionId(const std::string& id);
@@ -29,13 +32,15 @@ public:
   void SetAuthClient(AuthClient* authclient) {
     m_authClient = authclient;
   }
-  std::string GetEffectiveUrl() {
-    return m_effectiveUrl;
+  HttpMetrics& GetMetrics() {
+    return *m_metrics;
   }
 
 private:
-  std::string HttpRequest(const std::string& action, const std::string& url, const std::string& postData, int &statusCode);
-  std::string HttpRequestToCurl(Curl &curl, const std::string& action, const std::string& url, const std::string& postData, int &statusCode);
+  std::string HttpRequest(const std::string& action, const std::string& url, const std::string& postData, int &statusCode,
+                          std::string& effectiveUrl);
+  std::string HttpRequestToCurl(Curl &curl, const std::string& action, const std::string& url, const std::string& postData, int &statusCode,
+                                std::string& effectiveUrl);
   std::string GenerateUUID();
   std::string m_uuid;
   CSettings* m_settings;
@@ -43,7 +48,8 @@ private:
   HttpStatusCodeHandler *m_statusCodeHandler = nullptr;
   std::string m_sessionId;
   std::string m_deviceToken;
-  std::string m_effectiveUrl;
+  std::mutex m_mutex; //requests run in parallel, the session can change meanwhile
+  HttpMetrics* m_metrics; //owned by the addon instance, reports once it shuts down
   int m_platform;
 };
 
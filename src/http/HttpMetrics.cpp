@@ -0,0 +1,248 @@
+/*
+ *  Copyright (C) 2020 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#include "HttpMetrics.h"
+
+#include <algorithm>
+#include <cstring>
+#include <kodi/AddonBase.h>
+#include <kodi/Filesystem.h>
+#include "rapidjson/writer.h"
+#include "rapidjson/stringbuffer.h"
+
+constexpr char HTTP_METRICS_FILE[] = "special://profile/addon_data/pvr.magenta/httpmetrics.json";
+static const int HTTP_ENDPOINT_SEGMENTS = 3;
+
+HttpMetrics::HttpMetrics()
+  : m_since(time(nullptr)),
+    m_changed(false)
+{
+  ScheduleReport();
+}
+
+HttpMetrics::~HttpMetrics()
+{
+  m_taskQueue.Stop(false);
+  Report();
+}
+
+std::string HttpMetrics::GetEndpointClass(const std::string& url)
+{
+  std::string endpoint = url.substr(0, url.find_first_of("?#"));
+  size_t scheme = endpoint.find("://");
+  if (scheme != std::string::npos)
+    endpoint = endpoint.substr(scheme + 3);
+
+  // keep the host and the leading path segments, ids further down would split the classes
+  size_t pos = endpoint.find('/');
+  for (int i = 0; (i < HTTP_ENDPOINT_SEGMENTS) && (pos != std::string::npos); i++)
+    pos = endpoint.find('/', pos + 1);
+  if (pos != std::string::npos)
+    endpoint = endpoint.substr(0, pos);
+
+  return endpoint;
+}
+
+HttpEndpointStats& HttpMetrics::GetStats(const std::string& url)
+{
+  HttpEndpointStats& stats = m_stats[GetEndpointClass(url)];
+  if (stats.latencies.empty())
+  {
+    stats = {0, 0, 0, 0, 0, 0, 0, 0, 0, {}, {}};
+    stats.latencies.resize(HTTP_LATENCY_BUCKETS.size() + 1, 0);
+  }
+  m_changed = true;
+  return stats;
+}
+
+void HttpMetrics::AddRequest(const std::string& url, const int statusCode, const int64_t latency,
+                             const size_t bytesOut, const size_t bytesIn)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  HttpEndpointStats& stats = GetStats(url);
+  stats.requests++;
+  if (statusCode >= 400 || statusCode < 200)
+    stats.errors++;
+  stats.bytesOut += bytesOut;
+  stats.bytesIn += bytesIn;
+  stats.statusCodes[statusCode]++;
+  if (latency > stats.maxLatency)
+    stats.maxLatency = latency;
+
+  size_t bucket = 0;
+  while ((bucket < HTTP_LATENCY_BUCKETS.size()) && (latency > HTTP_LATENCY_BUCKETS[bucket]))
+    bucket++;
+  stats.latencies[bucket]++;
+}
+
+void HttpMetrics::AddCacheHit(const std::string& url)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  GetStats(url).cacheHits++;
+}
+
+void HttpMetrics::AddCacheMiss(const std::string& url)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  GetStats(url).cacheMisses++;
+}
+
+void HttpMetrics::AddRetry(const std::string& url)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  GetStats(url).retries++;
+}
+
+void HttpMetrics::AddReauth(const std::string& url)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  GetStats(url).reauths++;
+}
+
+int64_t HttpMetrics::GetPercentile(const HttpEndpointStats& stats, const double percentile) const
+{
+  // upper bound of the bucket holding the percentile, good enough to spot a slow endpoint
+  uint64_t count = 0;
+  for (const auto& latency : stats.latencies)
+    count += latency;
+  if (count == 0)
+    return 0;
+
+  uint64_t rank = static_cast<uint64_t>(percentile * count + 0.5);
+  if (rank == 0)
+    rank = 1;
+  uint64_t seen = 0;
+  for (size_t i = 0; i < HTTP_LATENCY_BUCKETS.size(); i++)
+  {
+    seen += stats.latencies[i];
+    if (seen >= rank)
+      return std::min(HTTP_LATENCY_BUCKETS[i], stats.maxLatency);
+  }
+  return stats.maxLatency;
+}
+
+void HttpMetrics::Report()
+{
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_changed)
+      return;
+    m_changed = false;
+
+    for (const auto& endpoint : m_stats)
+    {
+      const HttpEndpointStats& stats = endpoint.second;
+      kodi::Log(ADDON_LOG_INFO, "[HttpMetrics] %s: requests=%llu errors=%llu p50=%lldms p90=%lldms p99=%lldms in=%llu out=%llu cache=%llu/%llu retries=%llu reauths=%llu",
+                endpoint.first.c_str(),
+                static_cast<unsigned long long>(stats.requests),
+                static_cast<unsigned long long>(stats.errors),
+                static_cast<long long>(GetPercentile(stats, 0.5)),
+                static_cast<long long>(GetPercentile(stats, 0.9)),
+                static_cast<long long>(GetPercentile(stats, 0.99)),
+                static_cast<unsigned long long>(stats.bytesIn),
+                static_cast<unsigned long long>(stats.bytesOut),
+                static_cast<unsigned long long>(stats.cacheHits),
+                static_cast<unsigned long long>(stats.cacheHits + stats.cacheMisses),
+                static_cast<unsigned long long>(stats.retries),
+                static_cast<unsigned long long>(stats.reauths));
+    }
+  }
+  WriteDump();
+}
+
+bool HttpMetrics::WriteDump()
+{
+  rapidjson::StringBuffer buffer;
+  rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+  writer.StartObject();
+  writer.Key("since");
+  writer.Uint64(static_cast<uint64_t>(m_since));
+  writer.Key("written");
+  writer.Uint64(static_cast<uint64_t>(time(nullptr)));
+  writer.Key("endpoints");
+  writer.StartObject();
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (const auto& endpoint : m_stats)
+    {
+      const HttpEndpointStats& stats = endpoint.second;
+      writer.Key(endpoint.first.c_str());
+      writer.StartObject();
+      writer.Key("requests");
+      writer.Uint64(stats.requests);
+      writer.Key("errors");
+      writer.Uint64(stats.errors);
+      writer.Key("bytesIn");
+      writer.Uint64(stats.bytesIn);
+      writer.Key("bytesOut");
+      writer.Uint64(stats.bytesOut);
+      writer.Key("cacheHits");
+      writer.Uint64(stats.cacheHits);
+      writer.Key("cacheMisses");
+      writer.Uint64(stats.cacheMisses);
+      writer.Key("retries");
+      writer.Uint64(stats.retries);
+      writer.Key("reauths");
+      writer.Uint64(stats.reauths);
+      writer.Key("latency");
+      writer.StartObject();
+      writer.Key("p50");
+      writer.Int64(GetPercentile(stats, 0.5));
+      writer.Key("p90");
+      writer.Int64(GetPercentile(stats, 0.9));
+      writer.Key("p99");
+      writer.Int64(GetPercentile(stats, 0.99));
+      writer.Key("max");
+      writer.Int64(stats.maxLatency);
+      writer.Key("buckets");
+      writer.StartArray();
+      for (size_t i = 0; i < stats.latencies.size(); i++)
+      {
+        writer.StartObject();
+        writer.Key("le");
+        if (i < HTTP_LATENCY_BUCKETS.size())
+          writer.Int64(HTTP_LATENCY_BUCKETS[i]);
+        else
+          writer.Null();
+        writer.Key("count");
+        writer.Uint64(stats.latencies[i]);
+        writer.EndObject();
+      }
+      writer.EndArray();
+      writer.EndObject();
+      writer.Key("status");
+      writer.StartObject();
+      for (const auto& status : stats.statusCodes)
+      {
+        writer.Key(std::to_string(status.first).c_str());
+        writer.Uint64(status.second);
+      }
+      writer.EndObject();
+      writer.EndObject();
+    }
+  }
+  writer.EndObject();
+  writer.EndObject();
+
+  kodi::vfs::CFile file;
+  if (!file.OpenFileForWrite(HTTP_METRICS_FILE, true))
+  {
+    kodi::Log(ADDON_LOG_ERROR, "[HttpMetrics] Could not write %s", HTTP_METRICS_FILE);
+    return false;
+  }
+  const char* output = buffer.GetString();
+  file.Write(output, strlen(output));
+  return true;
+}
+
+void HttpMetrics::ScheduleReport()
+{
+  m_taskQueue.Schedule("report", HTTP_METRICS_INTERVAL * 1000, [this]() {
+    Report();
+    ScheduleReport();
+  });
+}
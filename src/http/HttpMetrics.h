@@ -0,0 +1,66 @@
+/*
+ *  Copyright (C) 2020 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <ctime>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "../task/TaskQueue.h"
+
+static const int HTTP_METRICS_INTERVAL = 15 * 60; //s between summaries
+static const std::vector<int64_t> HTTP_LATENCY_BUCKETS = { 10, 25, 50, 100, 250, 500, 1000, 2500, 5000, 10000 }; //ms
+
+struct HttpEndpointStats
+{
+  uint64_t requests;
+  uint64_t errors;
+  uint64_t bytesIn;
+  uint64_t bytesOut;
+  uint64_t cacheHits;
+  uint64_t cacheMisses;
+  uint64_t retries;
+  uint64_t reauths;
+  int64_t maxLatency;
+  std::vector<uint64_t> latencies; //one counter per bucket plus overflow
+  std::map<int, uint64_t> statusCodes;
+};
+
+// Request statistics per endpoint class (host and leading path, never the
+// query), summarized to the log periodically and dumped as json to the profile.
+// The last summary is written when the addon instance owning it goes away.
+class HttpMetrics
+{
+public:
+  HttpMetrics();
+  ~HttpMetrics();
+
+  static std::string GetEndpointClass(const std::string& url);
+
+  void AddRequest(const std::string& url, const int statusCode, const int64_t latency,
+                  const size_t bytesOut, const size_t bytesIn);
+  void AddCacheHit(const std::string& url);
+  void AddCacheMiss(const std::string& url);
+  void AddRetry(const std::string& url);
+  void AddReauth(const std::string& url);
+  void Report();
+
+private:
+  HttpEndpointStats& GetStats(const std::string& url);
+  int64_t GetPercentile(const HttpEndpointStats& stats, const double percentile) const;
+  bool WriteDump();
+  void ScheduleReport();
+
+  std::mutex m_mutex;
+  std::map<std::string, HttpEndpointStats> m_stats;
+  time_t m_since;
+  bool m_changed;
+  TaskQueue m_taskQueue;
+};
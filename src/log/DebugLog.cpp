@@ -0,0 +1,126 @@
+/*
+ *  Copyright (C) 2020 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#include "DebugLog.h"
+
+#include <cstring>
+#include <vector>
+
+static const size_t REDACT_KEEP = 4;
+static const std::vector<std::string> REDACT_PARAMETERS = { "token=", "code=", "password=", "secret=", "pw_pwd=" };
+static const std::vector<std::string> REDACT_JSON_FIELDS = { "\"accessToken\"", "\"password\"", "\"token\"" };
+
+std::atomic<bool> DebugLog::g_enabled(false);
+
+void DebugLog::SetEnabled(const bool enabled)
+{
+  g_enabled.store(enabled, std::memory_order_relaxed);
+}
+
+std::string DebugLog::Redact(const std::string& secret)
+{
+  if (secret.empty())
+    return secret;
+  if (secret.size() <= 2 * REDACT_KEEP)
+    return "***";
+  return secret.substr(0, REDACT_KEEP) + "***(" + std::to_string(secret.size()) + ")";
+}
+
+namespace
+{
+// unlike a token, no part of a password is worth keeping
+std::string RedactValue(const std::string& name, const std::string& value)
+{
+  if ((name.find("pwd") != std::string::npos) || (name.find("password") != std::string::npos))
+    return value.empty() ? value : "***";
+  return DebugLog::Redact(value);
+}
+}
+
+std::string DebugLog::RedactParameters(const std::string& text)
+{
+  std::string redacted = text;
+  for (const auto& parameter : REDACT_PARAMETERS)
+  {
+    size_t pos = 0;
+    while ((pos = redacted.find(parameter, pos)) != std::string::npos)
+    {
+      size_t begin = pos + parameter.size();
+      size_t end = redacted.find_first_of("&|\"; ", begin);
+      if (end == std::string::npos)
+        end = redacted.size();
+      std::string value = RedactValue(parameter, redacted.substr(begin, end - begin));
+      redacted.replace(begin, end - begin, value);
+      pos = begin + value.size();
+    }
+  }
+  // the same for string fields of a json body
+  for (const auto& field : REDACT_JSON_FIELDS)
+  {
+    size_t pos = 0;
+    while ((pos = redacted.find(field, pos)) != std::string::npos)
+    {
+      pos += field.size();
+      size_t colon = redacted.find_first_not_of(" \t", pos);
+      if ((colon == std::string::npos) || (redacted[colon] != ':'))
+        continue;
+      size_t quote = redacted.find_first_not_of(" \t", colon + 1);
+      if ((quote == std::string::npos) || (redacted[quote] != '"'))
+        continue;
+      size_t begin = quote + 1;
+      size_t end = redacted.find('"', begin);
+      if (end == std::string::npos)
+        end = redacted.size();
+      std::string value = RedactValue(field, redacted.substr(begin, end - begin));
+      redacted.replace(begin, end - begin, value);
+      pos = begin + value.size();
+    }
+  }
+  return redacted;
+}
+
+DebugLogSite::DebugLogSite(const char* file, const int line, const unsigned int sampleEvery, const unsigned int maxPerSecond)
+  : m_file(file),
+    m_line(line),
+    m_sampleEvery(sampleEvery > 0 ? sampleEvery : 1),
+    m_maxPerSecond(maxPerSecond),
+    m_calls(0),
+    m_window(0),
+    m_logged(0),
+    m_suppressed(0)
+{
+  const char* name = strrchr(m_file, '/');
+  if (name)
+    m_file = name + 1;
+}
+
+bool DebugLogSite::Allow()
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  if ((m_calls++ % m_sampleEvery) != 0)
+  {
+    m_suppressed++;
+    return false;
+  }
+
+  time_t now = time(nullptr);
+  if (now != m_window)
+  {
+    if (m_suppressed > 0)
+      kodi::Log(ADDON_LOG_DEBUG, "[%s:%i] %lu similar messages suppressed", m_file, m_line, m_suppressed);
+    m_window = now;
+    m_logged = 0;
+    m_suppressed = 0;
+  }
+  if (m_maxPerSecond > 0 && m_logged >= m_maxPerSecond)
+  {
+    m_suppressed++;
+    return false;
+  }
+  m_logged++;
+  return true;
+}
@@ -0,0 +1,68 @@
+/*
+ *  Copyright (C) 2020 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <ctime>
+#include <mutex>
+#include <string>
+#include <kodi/AddonBase.h>
+
+// Debug output of the addon, enabled by the "debuglog" setting. The macros
+// test the switch first, so their arguments are not even evaluated while it
+// is off.
+#define DEBUG_LOG(...) \
+  do \
+  { \
+    if (DebugLog::IsEnabled()) \
+      kodi::Log(ADDON_LOG_DEBUG, __VA_ARGS__); \
+  } while (0)
+
+// For per-item output in loops: logs every sampleEvery-th call and at most
+// maxPerSecond calls per second of this site, then reports what was dropped.
+#define DEBUG_LOG_LIMITED(sampleEvery, maxPerSecond, ...) \
+  do \
+  { \
+    if (DebugLog::IsEnabled()) \
+    { \
+      static DebugLogSite debugLogSite(__FILE__, __LINE__, sampleEvery, maxPerSecond); \
+      if (debugLogSite.Allow()) \
+        kodi::Log(ADDON_LOG_DEBUG, __VA_ARGS__); \
+    } \
+  } while (0)
+
+namespace DebugLog
+{
+extern std::atomic<bool> g_enabled;
+
+inline bool IsEnabled() { return g_enabled.load(std::memory_order_relaxed); }
+void SetEnabled(const bool enabled);
+// Keeps only the head of a token, key or cookie, enough to tell two apart
+std::string Redact(const std::string& secret);
+// Same for the values of token-like parameters inside an url, form or json body
+std::string RedactParameters(const std::string& text);
+}
+
+class DebugLogSite
+{
+public:
+  DebugLogSite(const char* file, const int line, const unsigned int sampleEvery, const unsigned int maxPerSecond);
+
+  bool Allow();
+
+private:
+  const char* m_file;
+  int m_line;
+  unsigned int m_sampleEvery;
+  unsigned int m_maxPerSecond;
+  std::mutex m_mutex;
+  unsigned long m_calls;
+  time_t m_window;
+  unsigned int m_logged;
+  unsigned long m_suppressed;
+};
@@ -8,9 +8,11 @@
 #include "Sam3Client.h"
 #include "../Settings.h"
 #include "../Utils.h"
+#include "../auth/JWT.h"
 #include "rapidjson/document.h"
 #include <kodi/gui/dialogs/OK.h>
 #include "../sso/SsoClient.h"
+#include "../log/DebugLog.h"
 //#include <tinyxml2.h>
 //#include "../tixml2ex.h"
 
@@ -30,27 +32,27 @@ std::string GetAttribute(const std::string& line, const std::string& str)
 
 void Sam3Client::SetSam3Url(const std::string& url) {
   m_sam3Url = url;
-  kodi::Log(ADDON_LOG_DEBUG, "[Sam3] Url set to: %s", m_sam3Url.c_str());
+  DEBUG_LOG("[Sam3] Url set to: %s", m_sam3Url.c_str());
 }
 
 void Sam3Client::SetClientId(const std::string& id) {
   m_sam3ClientId = id;
-  kodi::Log(ADDON_LOG_DEBUG, "[Sam3] Client Id set to: %s", m_sam3ClientId.c_str());
+  DEBUG_LOG("[Sam3] Client Id set to: %s", m_sam3ClientId.c_str());
 }
 
 void Sam3Client::SetLineAuthUrl(const std::string& url) {
   m_lineAuthUrl = url;
-  kodi::Log(ADDON_LOG_DEBUG, "[Sam3] LineAuthUrl set to: %s", m_lineAuthUrl.c_str());
+  DEBUG_LOG("[Sam3] LineAuthUrl set to: %s", m_lineAuthUrl.c_str());
 }
 
 void Sam3Client::SetAuthorizeTokenUrl(const std::string& url) {
   m_authorizeTokensUrl = url;
-  kodi::Log(ADDON_LOG_DEBUG, "[Sam3] AuthorizeTokensUrl set to: %s", m_authorizeTokensUrl.c_str());
+  DEBUG_LOG("[Sam3] AuthorizeTokensUrl set to: %s", m_authorizeTokensUrl.c_str());
 }
 
 void Sam3Client::SetDeviceToken(const std::string& token) {
   m_deviceToken = token;
-  kodi::Log(ADDON_LOG_DEBUG, "[Sam3] Device Token set to: %s", m_deviceToken.c_str());
+  DEBUG_LOG("[Sam3] Device Token set to: %s", DebugLog::Redact(m_deviceToken).c_str());
 }
 
 void Sam3Client::ParseHtml(const std::string& result)
@@ -69,7 +71,7 @@ void Sam3Client::ParseHtml(const std::string& result)
     Sam3KV sam3Attribute;
     sam3Attribute.name = GetAttribute(line, "name");
     sam3Attribute.value = GetAttribute(line, "value");
-    kodi::Log(ADDON_LOG_DEBUG, "[Sam3] Added Attribute Name %s Value %s", sam3Attribute.name.c_str(), sam3Attribute.value.c_str());
+    DEBUG_LOG("[Sam3] Added Attribute Name %s Value %s", sam3Attribute.name.c_str(), sam3Attribute.value.c_str());
     m_attributes.emplace_back(sam3Attribute);
     startpos = endline;
   }
@@ -91,7 +93,7 @@ bool Sam3Client::GetAuthMethods()
   doc.Parse(result.c_str());
   if ((doc.GetParseError()) || (statusCode != 200 && statusCode != 206))
   {
-    kodi::Log(ADDON_LOG_DEBUG, "[Sam3] GetAuthMethods failed");
+    DEBUG_LOG("[Sam3] GetAuthMethods failed");
     return false;
   }
 
@@ -106,7 +108,7 @@ bool Sam3Client::GetAuthMethods()
     for (rapidjson::SizeType i = 0; i < authkinds.Size(); i++)
     {
       std::string method = authkinds[i].GetString();
-      kodi::Log(ADDON_LOG_DEBUG, "Method: %s", method.c_str());
+      DEBUG_LOG("Method: %s", method.c_str());
       if (method == GRANTPASSWORD)
         m_authMethods.password = true;
       else if (method == GRANTAUTHCODE)
@@ -127,19 +129,25 @@ Sam3Client::Sam3Client(CSettings* setting, HttpClient* httpclient, SsoClient* ss
   m_authMethods.password = false;
   m_authMethods.code = false;
   m_authMethods.line = false;
+  m_authMethodsKnown = false;
+  m_sam3AccessTokens.taaExpiry = 0;
 //  m_personaToken = m_settings->GetMagenta2PersonaToken();
   m_refreshToken = m_settings->GetMagentaRefreshToken();
 }
 
 bool Sam3Client::ReAuthenticate(const std::string& grant)
 {
-  kodi::Log(ADDON_LOG_DEBUG, "[Sam3] function call: [%s]", __FUNCTION__);
+  DEBUG_LOG("[Sam3] function call: [%s]", __FUNCTION__);
 
   if (grant == GRANTREMOTELOGIN)
   {
     if (BackChannelAuth())
     {
-      return RefreshToken("taa", m_sam3AccessTokens.taa);
+      std::string accessToken;
+      if (!RefreshToken("taa", accessToken))
+        return false;
+      SetAccessToken(accessToken);
+      return true;
     }
     else
       return false;
@@ -155,9 +163,10 @@ Sam3Client::~Sam3Client()
 
 bool Sam3Client::InitSam3()
 {
-  kodi::Log(ADDON_LOG_DEBUG, "[Sam3] function call: [%s]", __FUNCTION__);
+  DEBUG_LOG("[Sam3] function call: [%s]", __FUNCTION__);
 
-  GetAuthMethods();
+  if (!m_authMethodsKnown)
+    m_authMethodsKnown = GetAuthMethods();
   //TODO: Remove call to LineAuth
 //  if (m_authMethods.line)
 //  {
@@ -176,15 +185,15 @@ bool Sam3Client::InitSam3()
     return false;
   }
   m_authorization_endpoint = Utils::JsonStringOrEmpty(doc, "authorization_endpoint");
-  kodi::Log(ADDON_LOG_DEBUG, "[Sam3] Authorization endpoint: %s", m_authorization_endpoint.c_str());
+  DEBUG_LOG("[Sam3] Authorization endpoint: %s", m_authorization_endpoint.c_str());
   m_token_endpoint =  Utils::JsonStringOrEmpty(doc, "token_endpoint");
-  kodi::Log(ADDON_LOG_DEBUG, "[Sam3] Token endpoint: %s", m_token_endpoint.c_str());
+  DEBUG_LOG("[Sam3] Token endpoint: %s", m_token_endpoint.c_str());
   m_userinfo_endpoint =  Utils::JsonStringOrEmpty(doc, "userinfo_endpoint");
-  kodi::Log(ADDON_LOG_DEBUG, "[Sam3] UserInfo endpoint: %s", m_userinfo_endpoint.c_str());
+  DEBUG_LOG("[Sam3] UserInfo endpoint: %s", m_userinfo_endpoint.c_str());
   m_issuer =  Utils::JsonStringOrEmpty(doc, "issuer");
-  kodi::Log(ADDON_LOG_DEBUG, "[Sam3] Issuer: %s", m_issuer.c_str());
+  DEBUG_LOG("[Sam3] Issuer: %s", m_issuer.c_str());
   m_bcAuthStart = Utils::JsonStringOrEmpty(doc, "backchannel_auth_start");
-  kodi::Log(ADDON_LOG_DEBUG, "[Sam3] Back Channel Auth Start: %s", m_bcAuthStart.c_str());
+  DEBUG_LOG("[Sam3] Back Channel Auth Start: %s", m_bcAuthStart.c_str());
 
   //TODO: Remove call to LineAuth
 //  if (m_authMethods.code)
@@ -198,7 +207,7 @@ bool Sam3Client::InitSam3()
 
 bool Sam3Client::Sam3Login(std::string& personaToken)
 {
-  kodi::Log(ADDON_LOG_DEBUG, "[Sam3] function call: [%s]", __FUNCTION__);
+  DEBUG_LOG("[Sam3] function call: [%s]", __FUNCTION__);
   int statusCode = 0;
   std::string result;
 //  std::string url = m_authorization_endpoint +
@@ -229,9 +238,9 @@ bool Sam3Client::Sam3Login(std::string& personaToken)
 
   if (auto div = tinyxml2::find_element(*doc, "/body/div[@class='container-fixed']/div[@class='tbs-container']/div[@class='login-box']/div[@class='offset-bottom-1']"))
   {
-    kodi::Log(ADDON_LOG_DEBUG, "[Sam3] Login found");
+    DEBUG_LOG("[Sam3] Login found");
   } else {
-    kodi::Log(ADDON_LOG_DEBUG, "[Sam3] Login not found");
+    DEBUG_LOG("[Sam3] Login not found");
   }
 */
 /*
@@ -263,7 +272,7 @@ bool Sam3Client::Sam3Login(std::string& personaToken)
 //  kodi::Log(ADDON_LOG_DEBUG, "[Sam3] PostData %s", postData.c_str());
   if ((statusCode != 200) && (statusCode != 206))
   {
-    kodi::Log(ADDON_LOG_ERROR, "Failed to post factorx %s body: %s status code: %i", url.c_str(), postData.c_str(), statusCode);
+    kodi::Log(ADDON_LOG_ERROR, "Failed to post factorx %s body: %s status code: %i", url.c_str(), DebugLog::RedactParameters(postData).c_str(), statusCode);
     return false;
   }
 
@@ -278,13 +287,13 @@ bool Sam3Client::Sam3Login(std::string& personaToken)
               "&pw_pwd=" + Utils::UrlEncode(m_settings->GetMagentaPassword()) +
               "&pw_submit=";
 
-  result = m_httpClient->HttpPost(url, postData, statusCode);
+  std::string effectiveUrl;
+  result = m_httpClient->HttpPost(url, postData, statusCode, effectiveUrl);
   if ((statusCode != 200) && (statusCode != 206))
   {
-    kodi::Log(ADDON_LOG_ERROR, "Failed to post factorx %s body: %s status code: %i", url.c_str(), postData.c_str(), statusCode);
+    kodi::Log(ADDON_LOG_ERROR, "Failed to post factorx %s body: %s status code: %i", url.c_str(), DebugLog::RedactParameters(postData).c_str(), statusCode);
     return false;
   }
-  std::string effectiveUrl = m_httpClient->GetEffectiveUrl();
   int codePos = effectiveUrl.find("code");
   if (codePos != std::string::npos)
     codePos += 5;
@@ -299,14 +308,14 @@ bool Sam3Client::Sam3Login(std::string& personaToken)
   std::string code = effectiveUrl.substr(codePos, 8);
   std::string state = effectiveUrl.substr(statePos, 10);
 //  kodi::Log(ADDON_LOG_DEBUG, "URL: %s, Code: %s, State: %s", effectiveUrl.c_str(), code.c_str(), state.c_str());
-  kodi::Log(ADDON_LOG_DEBUG, "URL: %s, Code: %s, State: %s", effectiveUrl.c_str(), code.c_str(), state.c_str());
+  DEBUG_LOG("URL: %s, Code: %s, State: %s", DebugLog::RedactParameters(effectiveUrl).c_str(), DebugLog::Redact(code).c_str(), state.c_str());
 
   return m_ssoClient->SSOAuthenticate(code, state, personaToken);
 }
 
 bool Sam3Client::LineAuth()
 {
-  kodi::Log(ADDON_LOG_DEBUG, "[Sam3] function call: [%s]", __FUNCTION__);
+  DEBUG_LOG("[Sam3] function call: [%s]", __FUNCTION__);
 
   if (m_authorizeTokensUrl.empty() || m_deviceToken.empty())
     return false;
@@ -326,9 +335,9 @@ bool Sam3Client::LineAuth()
   if ((doc.GetParseError()) || (statusCode != 200 && statusCode != 206))
   {
     if (!doc.GetParseError())
-      kodi::Log(ADDON_LOG_DEBUG, "[Sam3] LineAuth returned: %s", result.c_str());
+      DEBUG_LOG("[Sam3] LineAuth returned: %s", result.c_str());
     else
-      kodi::Log(ADDON_LOG_DEBUG, "[Sam3] LineAuth failed");
+      DEBUG_LOG("[Sam3] LineAuth failed");
     return false;
   }
   if (doc.HasMember("refresh_token"))
@@ -342,7 +351,7 @@ bool Sam3Client::LineAuth()
 
 bool Sam3Client::BackChannelAuth()
 {
-  kodi::Log(ADDON_LOG_DEBUG, "[Sam3] function call: [%s]", __FUNCTION__);
+  DEBUG_LOG("[Sam3] function call: [%s]", __FUNCTION__);
 
   if (m_bcAuthStart.empty())
     return false;
@@ -361,9 +370,9 @@ bool Sam3Client::BackChannelAuth()
   if ((doc.GetParseError()) || (statusCode != 200 && statusCode != 206))
   {
     if (!doc.GetParseError())
-      kodi::Log(ADDON_LOG_DEBUG, "[Sam3] BackChannel Auth start returned: %s", result.c_str());
+      DEBUG_LOG("[Sam3] BackChannel Auth start returned: %s", result.c_str());
     else
-      kodi::Log(ADDON_LOG_DEBUG, "[Sam3] Failed to start BackChannel Auth");
+      DEBUG_LOG("[Sam3] Failed to start BackChannel Auth");
     return false;
   }
 
@@ -381,7 +390,7 @@ bool Sam3Client::BackChannelAuth()
 
 bool Sam3Client::GetToken(const std::string& grantType, const std::string& scope, const std::string& credential1, const std::string& credential2, std::string& accessToken)
 {
-  kodi::Log(ADDON_LOG_DEBUG, "[Sam3] function call: [%s]", __FUNCTION__);
+  DEBUG_LOG("[Sam3] function call: [%s]", __FUNCTION__);
 
   if (m_token_endpoint.empty() || m_refreshToken.empty())
     return false;
@@ -406,9 +415,9 @@ bool Sam3Client::GetToken(const std::string& grantType, const std::string& scope
   if ((doc.GetParseError()) || (statusCode != 200 && statusCode != 206))
   {
     if (!doc.GetParseError())
-      kodi::Log(ADDON_LOG_DEBUG, "[Sam3] GetToken returned: %s", result.c_str());
+      DEBUG_LOG("[Sam3] GetToken returned: %s", DebugLog::Redact(result).c_str());
     else
-      kodi::Log(ADDON_LOG_DEBUG, "[Sam3] GetToken failed");
+      DEBUG_LOG("[Sam3] GetToken failed");
     return false;
   }
   if (doc.HasMember("refresh_token"))
@@ -419,11 +428,11 @@ bool Sam3Client::GetToken(const std::string& grantType, const std::string& scope
   if (doc.HasMember("access_token"))
   {
     accessToken = Utils::JsonStringOrEmpty(doc, "access_token");
-    kodi::Log(ADDON_LOG_DEBUG, "[Sam3] Access Token: %s", accessToken.c_str());
+    DEBUG_LOG("[Sam3] Access Token: %s", DebugLog::Redact(accessToken).c_str());
   }
   if (doc.HasMember("id_token"))
   {
-    kodi::Log(ADDON_LOG_DEBUG, "[Sam3] ID Token: %s", Utils::JsonStringOrEmpty(doc, "id_token").c_str());
+    DEBUG_LOG("[Sam3] ID Token: %s", DebugLog::Redact(Utils::JsonStringOrEmpty(doc, "id_token")).c_str());
   }
 
   return true;
@@ -431,30 +440,79 @@ bool Sam3Client::GetToken(const std::string& grantType, const std::string& scope
 
 bool Sam3Client::RefreshToken(const std::string& scope, std::string& accessToken)
 {
-  kodi::Log(ADDON_LOG_DEBUG, "[Sam3] function call: [%s]", __FUNCTION__);
+  DEBUG_LOG("[Sam3] function call: [%s]", __FUNCTION__);
   return (GetToken(GRANTREFRESHTOKEN, scope, m_refreshToken, "", accessToken));
 }
 
 bool Sam3Client::RemoteLogin(const std::string& auth_req_id, const std::string& auth_req_sec, std::string& accessToken)
 {
-  kodi::Log(ADDON_LOG_DEBUG, "[Sam3] function call: [%s]", __FUNCTION__);
+  DEBUG_LOG("[Sam3] function call: [%s]", __FUNCTION__);
   return (GetToken(GRANTREMOTELOGIN, "", auth_req_id, auth_req_sec, accessToken));
 }
 
 bool Sam3Client::GetAccessToken(const std::string& scope, std::string& accessToken)
 {
-  kodi::Log(ADDON_LOG_DEBUG, "[Sam3] function call: [%s] requested scope [%s]", __FUNCTION__, scope.c_str());
+  DEBUG_LOG("[Sam3] function call: [%s] requested scope [%s]", __FUNCTION__, scope.c_str());
   //TODO: Not only taa
-  if (!m_sam3AccessTokens.taa.empty())
-    accessToken = m_sam3AccessTokens.taa;
-  else
   {
-    if (!RefreshToken(scope, accessToken))
+    // opaque tokens carry no expiry and are fetched fresh every time
+    std::lock_guard<std::mutex> lock(m_tokenMutex);
+    if (!m_sam3AccessTokens.taa.empty() &&
+        (time(nullptr) + SAM3_TOKEN_MARGIN < m_sam3AccessTokens.taaExpiry))
+    {
+      accessToken = m_sam3AccessTokens.taa;
+      return true;
+    }
+  }
+  return m_tokenFlight.Do([this, scope](std::string& token) {
+    if (!RefreshToken(scope, token))
     {
       if (!LineAuth())
         BackChannelAuth();
-      return RefreshToken(scope, accessToken);
+      if (!RefreshToken(scope, token))
+        return false;
     }
+    SetAccessToken(token);
+    return true;
+  }, accessToken);
+}
+
+void Sam3Client::SetAccessToken(const std::string& accessToken)
+{
+  std::lock_guard<std::mutex> lock(m_tokenMutex);
+  m_sam3AccessTokens.taa = accessToken;
+  m_sam3AccessTokens.taaExpiry = GetJWTExpiry(accessToken);
+}
+
+void Sam3Client::SaveState(AuthState& state)
+{
+  if (m_authMethodsKnown)
+  {
+    state.SetString("sam3.authMethods", std::string(m_authMethods.password ? "p" : "") +
+                                        (m_authMethods.code ? "c" : "") +
+                                        (m_authMethods.line ? "l" : ""));
+  }
+  std::lock_guard<std::mutex> lock(m_tokenMutex);
+  state.SetString("sam3.taaAccessToken", m_sam3AccessTokens.taa);
+  state.SetTime("sam3.taaAccessTokenExpiry", m_sam3AccessTokens.taaExpiry);
+}
+
+void Sam3Client::RestoreState(const AuthState& state)
+{
+  std::string methods;
+  if (state.GetString("sam3.authMethods", methods))
+  {
+    m_authMethods.password = methods.find('p') != std::string::npos;
+    m_authMethods.code = methods.find('c') != std::string::npos;
+    m_authMethods.line = methods.find('l') != std::string::npos;
+    m_authMethodsKnown = true;
+  }
+  std::string accessToken;
+  time_t expiry = state.GetTime("sam3.taaAccessTokenExpiry");
+  if (state.GetString("sam3.taaAccessToken", accessToken) && (expiry > time(nullptr)))
+  {
+    std::lock_guard<std::mutex> lock(m_tokenMutex);
+    m_sam3AccessTokens.taa = accessToken;
+    m_sam3AccessTokens.taaExpiry = expiry;
   }
-  return true;
 }
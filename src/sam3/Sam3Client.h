@@ -8,8 +8,12 @@
 
 #pragma once
 
+#include <ctime>
+#include <mutex>
 #include "../Settings.h"
 #include "../http/HttpClient.h"
+#include "../auth/AuthState.h"
+#include "../auth/SingleFlight.h"
 
 static const std::string GRANTLINEAUTH = "urn:com:telekom:ott-app-services:access-auth";
 static const std::string GRANTAUTHCODE = "authorization_code";
@@ -30,9 +34,12 @@ struct Sam3AuthMethods
   bool line;
 };
 
+static const time_t SAM3_TOKEN_MARGIN = 60; //s
+
 struct Sam3AccessTokens
 {
   std::string taa;
+  time_t taaExpiry;
   std::string tvhubs;
 };
 
@@ -53,6 +60,8 @@ public:
   bool Sam3Login(std::string& personaToken);
   bool ReAuthenticate(const std::string& grant);
   bool GetAccessToken(const std::string& scope, std::string& accessToken);
+  void SaveState(AuthState& state);
+  void RestoreState(const AuthState& state);
 /*
   std::string GetPersonaToken() {
     return m_personaToken;
@@ -63,6 +72,7 @@ private:
   bool GetToken(const std::string& grantType, const std::string& scope, const std::string& credential1, const std::string& credential2, std::string& accessToken);
   bool RefreshToken(const std::string& scope, std::string& accessToken);
   bool RemoteLogin(const std::string& auth_req_id, const std::string& auth_req_sec, std::string& accessToken);
+  void SetAccessToken(const std::string& accessToken);
 
   std::vector<Sam3KV> m_attributes;
 
@@ -88,5 +98,8 @@ private:
   std::string m_bcAuthStart;
   std::string m_idToken;
   Sam3AuthMethods m_authMethods;
+  bool m_authMethodsKnown;
   Sam3AccessTokens m_sam3AccessTokens;
+  std::mutex m_tokenMutex;
+  SingleFlight<std::string> m_tokenFlight;
 };
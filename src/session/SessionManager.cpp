@@ -0,0 +1,147 @@
+/*
+ *  Copyright (C) 2020 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#include "SessionManager.h"
+
+#include <kodi/AddonBase.h>
+#include <vector>
+#include "../Utils.h"
+#include "../log/DebugLog.h"
+
+SessionManager::SessionManager(const sessionrequest_t& request)
+  : m_request(request)
+{
+}
+
+SessionManager::~SessionManager()
+{
+  Stop();
+}
+
+void SessionManager::Stop()
+{
+  ReleaseAll();
+  m_taskQueue.Stop(true);
+}
+
+std::string SessionManager::GetKey(const int contentId, const int mediaId)
+{
+  return std::to_string(contentId) + ":" + std::to_string(mediaId);
+}
+
+void SessionManager::Start(const std::string& baseUrl, const int contentId, const int mediaId, const std::string& contentType,
+                           const int heartbitInterval)
+{
+  std::string key = GetKey(contentId, mediaId);
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_sessions[key] = {baseUrl, contentId, mediaId, contentType, heartbitInterval, time(nullptr)};
+  }
+  // sessions without an interval from Play are only released, never kept alive
+  if (heartbitInterval > 0)
+    ScheduleHeartbit(key, heartbitInterval);
+  else
+    m_taskQueue.Cancel("heartbit:" + key);
+}
+
+void SessionManager::Release(const int contentId, const int mediaId)
+{
+  std::string key = GetKey(contentId, mediaId);
+  MagentaPlaySession session;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_sessions.find(key);
+    if (it == m_sessions.end())
+      return;
+    session = it->second;
+    m_sessions.erase(it);
+  }
+  m_taskQueue.Cancel("heartbit:" + key);
+  m_taskQueue.Post([this, session]() { ReleaseSession(session); });
+}
+
+void SessionManager::ReleaseAll()
+{
+  std::vector<MagentaPlaySession> sessions;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (const auto& session : m_sessions)
+      sessions.emplace_back(session.second);
+    m_sessions.clear();
+  }
+  for (const auto& session : sessions)
+  {
+    m_taskQueue.Cancel("heartbit:" + GetKey(session.contentId, session.mediaId));
+    m_taskQueue.Post([this, session]() { ReleaseSession(session); });
+  }
+}
+
+size_t SessionManager::Count()
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_sessions.size();
+}
+
+void SessionManager::ScheduleHeartbit(const std::string& key, const int interval)
+{
+  int delay = interval < SESSION_HEARTBIT_MIN_INTERVAL ? SESSION_HEARTBIT_MIN_INTERVAL : interval;
+  m_taskQueue.Schedule("heartbit:" + key, delay * 1000, [this, key]() { Heartbit(key); });
+}
+
+void SessionManager::Heartbit(const std::string& key)
+{
+  MagentaPlaySession session;
+  bool expired = false;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_sessions.find(key);
+    if (it == m_sessions.end())
+      return;
+    session = it->second;
+    expired = (session.started + SESSION_MAX_DURATION < time(nullptr));
+    if (expired)
+      m_sessions.erase(it);
+  }
+  // Kodi does not always report the end of playback, forgotten sessions must not live forever
+  if (expired)
+  {
+    DEBUG_LOG("Play session %s exceeded its maximum duration", key.c_str());
+    ReleaseSession(session);
+    return;
+  }
+
+  std::string postData = "{\"contentId\": \"" + std::to_string(session.contentId) + "\","
+                          "\"mediaId\": \"" + std::to_string(session.mediaId) + "\","
+                          "\"contentType\": \"" + session.contentType + "\"}";
+  rapidjson::Document doc;
+  if (!m_request(session.baseUrl + "PlayHeartbit", postData, doc))
+  {
+    kodi::Log(ADDON_LOG_ERROR, "PlayHeartbit failed for session %s", key.c_str());
+    ScheduleHeartbit(key, session.heartbitInterval);
+    return;
+  }
+  std::string isValid = Utils::JsonStringOrEmpty(doc, "isvalid");
+  if ((isValid == "false") || (isValid == "0"))
+  {
+    DEBUG_LOG("Play session %s is no longer valid", key.c_str());
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_sessions.erase(key);
+    return;
+  }
+  std::string interval = Utils::JsonStringOrEmpty(doc, "nextcallinterval");
+  ScheduleHeartbit(key, interval.empty() ? session.heartbitInterval : atoi(interval.c_str()));
+}
+
+bool SessionManager::ReleaseSession(const MagentaPlaySession& session)
+{
+  std::string postData = "{\"mediaId\": \"" + std::to_string(session.mediaId) + "\","
+                          "\"contentId\": \"" + std::to_string(session.contentId) + "\","
+                          "\"contentType\": \"" + session.contentType + "\"}";
+
+  rapidjson::Document doc;
+  return m_request(session.baseUrl + "ReleasePlaySession", postData, doc);
+}
@@ -0,0 +1,60 @@
+/*
+ *  Copyright (C) 2020 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#pragma once
+
+#include <ctime>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include "../task/TaskQueue.h"
+#include "rapidjson/document.h"
+
+static const int SESSION_HEARTBIT_MIN_INTERVAL = 30; //s
+static const time_t SESSION_MAX_DURATION = 4 * 60 * 60; //4h
+
+typedef std::function<bool(const std::string& url, const std::string& postData, rapidjson::Document& doc)> sessionrequest_t;
+
+struct MagentaPlaySession
+{
+  std::string baseUrl;
+  int contentId;
+  int mediaId;
+  std::string contentType;
+  int heartbitInterval;
+  time_t started;
+};
+
+// Keeps the Huawei play sessions opened by Play alive with PlayHeartbit and
+// hands each of them back with ReleasePlaySession, both on a background queue.
+// A zap starts the new session before the old one is released, so several
+// sessions can be open at the same time.
+class SessionManager
+{
+public:
+  SessionManager(const sessionrequest_t& request);
+  ~SessionManager();
+
+  void Start(const std::string& baseUrl, const int contentId, const int mediaId, const std::string& contentType,
+             const int heartbitInterval);
+  void Release(const int contentId, const int mediaId);
+  void ReleaseAll();
+  void Stop();
+  size_t Count();
+
+private:
+  std::string GetKey(const int contentId, const int mediaId);
+  void ScheduleHeartbit(const std::string& key, const int interval);
+  void Heartbit(const std::string& key);
+  bool ReleaseSession(const MagentaPlaySession& session);
+
+  sessionrequest_t m_request;
+  std::mutex m_mutex;
+  std::map<std::string, MagentaPlaySession> m_sessions;
+  TaskQueue m_taskQueue;
+};
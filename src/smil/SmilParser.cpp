@@ -0,0 +1,303 @@
+/*
+ *  Copyright (C) 2020 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#include "SmilParser.h"
+
+#include <cstdlib>
+#include <cstring>
+#include "../trace/Trace.h"
+
+namespace
+{
+enum SmilScope
+{
+  SCOPE_NONE,
+  SCOPE_HEAD,
+  SCOPE_SEQ,
+  SCOPE_ERROR_REF,
+  SCOPE_SWITCH,
+  SCOPE_SWITCH_REF,
+  SCOPE_DONE
+};
+
+bool IsSpace(const char c)
+{
+  return (c == ' ') || (c == '\t') || (c == '\r') || (c == '\n');
+}
+} // unnamed namespace
+
+bool SmilParser::NextTag(const char*& pos, const char* end, Tag& tag)
+{
+  while (pos < end)
+  {
+    const char* open = static_cast<const char*>(memchr(pos, '<', end - pos));
+    if (!open)
+      return false;
+    pos = open + 1;
+    if (pos >= end)
+      return false;
+
+    // comments, declarations and processing instructions carry nothing we need
+    if ((end - pos >= 3) && (strncmp(pos, "!--", 3) == 0))
+    {
+      const char* close = pos + 3;
+      while ((close + 2 < end) && (strncmp(close, "-->", 3) != 0))
+        close++;
+      pos = close + 3;
+      continue;
+    }
+    if ((*pos == '?') || (*pos == '!'))
+    {
+      const char* close = static_cast<const char*>(memchr(pos, '>', end - pos));
+      if (!close)
+        return false;
+      pos = close + 1;
+      continue;
+    }
+
+    tag.isClosing = (*pos == '/');
+    if (tag.isClosing)
+      pos++;
+    tag.name = pos;
+    while ((pos < end) && !IsSpace(*pos) && (*pos != '>') && (*pos != '/'))
+      pos++;
+    tag.nameLength = pos - tag.name;
+
+    // quoted attribute values may contain '>'
+    tag.attributes = pos;
+    char quote = 0;
+    while (pos < end)
+    {
+      if (quote)
+      {
+        if (*pos == quote)
+          quote = 0;
+      }
+      else if ((*pos == '"') || (*pos == '\''))
+        quote = *pos;
+      else if (*pos == '>')
+        break;
+      pos++;
+    }
+    if (pos >= end)
+      return false;
+    tag.isSelfClosing = (pos > tag.attributes) && (*(pos - 1) == '/');
+    tag.attributesLength = pos - tag.attributes - (tag.isSelfClosing ? 1 : 0);
+    pos++;
+    return true;
+  }
+  return false;
+}
+
+bool SmilParser::IsTag(const Tag& tag, const char* name)
+{
+  return (strlen(name) == tag.nameLength) && (strncmp(tag.name, name, tag.nameLength) == 0);
+}
+
+bool SmilParser::GetAttribute(const Tag& tag, const char* name, std::string& value)
+{
+  const size_t nameLength = strlen(name);
+  const char* pos = tag.attributes;
+  const char* end = tag.attributes + tag.attributesLength;
+  while (pos < end)
+  {
+    while ((pos < end) && IsSpace(*pos))
+      pos++;
+    const char* attrName = pos;
+    while ((pos < end) && (*pos != '=') && !IsSpace(*pos))
+      pos++;
+    size_t attrNameLength = pos - attrName;
+    while ((pos < end) && (IsSpace(*pos) || (*pos == '=')))
+      pos++;
+    if ((pos >= end) || ((*pos != '"') && (*pos != '\'')))
+      return false;
+    char quote = *pos++;
+    const char* valueBegin = pos;
+    const char* valueEnd = static_cast<const char*>(memchr(pos, quote, end - pos));
+    if (!valueEnd)
+      return false;
+    pos = valueEnd + 1;
+
+    if ((attrNameLength == nameLength) && (strncmp(attrName, name, nameLength) == 0))
+    {
+      value.clear();
+      AppendDecoded(valueBegin, valueEnd, value);
+      return true;
+    }
+  }
+  return false;
+}
+
+void SmilParser::AppendDecoded(const char* begin, const char* end, std::string& out)
+{
+  out.reserve(out.size() + (end - begin));
+  while (begin < end)
+  {
+    const char* amp = static_cast<const char*>(memchr(begin, '&', end - begin));
+    if (!amp)
+    {
+      out.append(begin, end);
+      return;
+    }
+    out.append(begin, amp);
+    const char* semicolon = static_cast<const char*>(memchr(amp, ';', end - amp));
+    if (!semicolon)
+    {
+      out.append(amp, end);
+      return;
+    }
+    std::string entity(amp + 1, semicolon);
+    if (entity == "amp")
+      out += '&';
+    else if (entity == "lt")
+      out += '<';
+    else if (entity == "gt")
+      out += '>';
+    else if (entity == "quot")
+      out += '"';
+    else if (entity == "apos")
+      out += '\'';
+    else if ((entity.size() > 1) && (entity[0] == '#'))
+    {
+      long code = (entity[1] == 'x') ? strtol(entity.c_str() + 2, nullptr, 16)
+                                     : strtol(entity.c_str() + 1, nullptr, 10);
+      // urls and ids are ASCII, anything else is kept as it was
+      if ((code > 0) && (code < 0x80))
+        out += static_cast<char>(code);
+      else
+        out.append(amp, semicolon + 1);
+    }
+    else
+      out.append(amp, semicolon + 1);
+    begin = semicolon + 1;
+  }
+}
+
+bool SmilParser::Parse(const std::string& buffer, SmilResult& result)
+{
+  TRACE_SCOPE("smil", "Parse");
+  result.meta.clear();
+  result.isError = false;
+  result.isException = false;
+  result.responseCode = 0;
+  result.src.clear();
+  result.title.clear();
+  result.abstract.clear();
+  result.trackingData.clear();
+
+  const char* pos = buffer.c_str();
+  const char* end = pos + buffer.size();
+  SmilScope scope = SCOPE_NONE;
+  bool hasHead = false;
+  bool hasBody = false;
+  bool hasSeq = false;
+  Tag tag;
+  std::string name;
+  std::string value;
+
+  while ((scope != SCOPE_DONE) && NextTag(pos, end, tag))
+  {
+    switch (scope)
+    {
+      case SCOPE_NONE:
+        if (tag.isClosing)
+          break;
+        if (IsTag(tag, "head") && !tag.isSelfClosing)
+        {
+          hasHead = true;
+          scope = SCOPE_HEAD;
+        }
+        else if (IsTag(tag, "body"))
+          hasBody = true;
+        else if (hasBody && IsTag(tag, "seq") && !tag.isSelfClosing)
+        {
+          hasSeq = true;
+          scope = SCOPE_SEQ;
+        }
+        break;
+      case SCOPE_HEAD:
+        if (tag.isClosing && IsTag(tag, "head"))
+          scope = SCOPE_NONE;
+        else if (!tag.isClosing && IsTag(tag, "meta"))
+        {
+          SmilMeta meta;
+          GetAttribute(tag, "name", meta.name);
+          GetAttribute(tag, "content", meta.content);
+          result.meta.emplace_back(meta);
+        }
+        break;
+      case SCOPE_SEQ:
+        if (tag.isClosing)
+        {
+          if (IsTag(tag, "seq"))
+            scope = SCOPE_DONE;
+        }
+        else if (IsTag(tag, "ref"))
+        {
+          result.isError = true;
+          GetAttribute(tag, "src", result.src);
+          GetAttribute(tag, "title", result.title);
+          GetAttribute(tag, "abstract", result.abstract);
+          scope = tag.isSelfClosing ? SCOPE_DONE : SCOPE_ERROR_REF;
+        }
+        else if (IsTag(tag, "switch") && !tag.isSelfClosing)
+          scope = SCOPE_SWITCH;
+        break;
+      case SCOPE_ERROR_REF:
+        if (tag.isClosing && IsTag(tag, "ref"))
+          scope = SCOPE_DONE;
+        else if (!tag.isClosing && IsTag(tag, "param") &&
+                 GetAttribute(tag, "name", name) && GetAttribute(tag, "value", value))
+        {
+          if ((name == "isException") && (value == "true"))
+            result.isException = true;
+          else if (name == "responseCode")
+            result.responseCode = atoi(value.c_str());
+        }
+        break;
+      case SCOPE_SWITCH:
+        if (tag.isClosing && IsTag(tag, "switch"))
+          scope = SCOPE_DONE;
+        else if (!tag.isClosing && IsTag(tag, "ref"))
+        {
+          GetAttribute(tag, "src", result.src);
+          scope = tag.isSelfClosing ? SCOPE_DONE : SCOPE_SWITCH_REF;
+        }
+        break;
+      case SCOPE_SWITCH_REF:
+        // only the first param of the selected ref carries the tracking data
+        if (!tag.isClosing && IsTag(tag, "param") &&
+            GetAttribute(tag, "name", name) && (name == "trackingData"))
+          GetAttribute(tag, "value", result.trackingData);
+        scope = SCOPE_DONE;
+        break;
+      case SCOPE_DONE:
+        break;
+    }
+  }
+
+  return hasHead && hasSeq && (result.isError || !result.src.empty());
+}
+
+bool SmilParser::GetTrackingValue(const std::string& trackingData, const std::string& key, std::string& value)
+{
+  size_t start = 0;
+  while (start < trackingData.size())
+  {
+    size_t stop = trackingData.find('|', start);
+    if (stop == std::string::npos)
+      stop = trackingData.size();
+    if ((stop - start > key.size()) && (trackingData.compare(start, key.size(), key) == 0) &&
+        (trackingData[start + key.size()] == '='))
+    {
+      value = trackingData.substr(start + key.size() + 1, stop - start - key.size() - 1);
+      return true;
+    }
+    start = stop + 1;
+  }
+  return false;
+}
@@ -0,0 +1,57 @@
+/*
+ *  Copyright (C) 2020 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+struct SmilMeta
+{
+  std::string name;
+  std::string content;
+};
+
+// The subset of a media selector SMIL the addon uses. A ref directly
+// below seq is an error response, a switch holds the playable ref.
+struct SmilResult
+{
+  std::vector<SmilMeta> meta;
+  bool isError;
+  bool isException;
+  int responseCode;
+  std::string src;
+  std::string title;
+  std::string abstract;
+  std::string trackingData;
+};
+
+// Pull parser working on the response buffer. Only values that end up in
+// SmilResult are copied (and entity decoded); everything else is skipped.
+class SmilParser
+{
+public:
+  static bool Parse(const std::string& buffer, SmilResult& result);
+  static bool GetTrackingValue(const std::string& trackingData, const std::string& key, std::string& value);
+
+private:
+  struct Tag
+  {
+    const char* name;
+    size_t nameLength;
+    const char* attributes;
+    size_t attributesLength;
+    bool isClosing;
+    bool isSelfClosing;
+  };
+
+  static bool NextTag(const char*& pos, const char* end, Tag& tag);
+  static bool IsTag(const Tag& tag, const char* name);
+  static bool GetAttribute(const Tag& tag, const char* name, std::string& value);
+  static void AppendDecoded(const char* begin, const char* end, std::string& out);
+};
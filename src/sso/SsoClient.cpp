@@ -9,6 +9,7 @@
 #include "../Settings.h"
 #include "../Utils.h"
 #include "rapidjson/document.h"
+#include "../log/DebugLog.h"
 
 SsoClient::SsoClient(CSettings* setting, HttpClient* httpclient):
   m_settings(setting),
@@ -26,7 +27,7 @@ SsoClient::~SsoClient()
 
 std::string SsoClient::SSOLogin()
 {
-  kodi::Log(ADDON_LOG_DEBUG, "function call: [%s]", __FUNCTION__);
+  DEBUG_LOG("function call: [%s]", __FUNCTION__);
   std::string url = SSO_URL + "login";
   int statusCode = 0;
   std::string result;
@@ -38,9 +39,9 @@ std::string SsoClient::SSOLogin()
   if ((doc.GetParseError()) || (statusCode != 200 && statusCode != 206) || (!doc.HasMember("loginRedirectUrl")))
   {
     if (!doc.GetParseError())
-      kodi::Log(ADDON_LOG_DEBUG, "[Sam3] SSO Login returned: %s", result.c_str());
+      DEBUG_LOG("[Sam3] SSO Login returned: %s", result.c_str());
    else
-      kodi::Log(ADDON_LOG_DEBUG, "[Sam3] SSO Login failed");
+      DEBUG_LOG("[Sam3] SSO Login failed");
     return "";
   }
 
@@ -49,7 +50,7 @@ std::string SsoClient::SSOLogin()
 
 bool SsoClient::SSOAuthenticate(const std::string& code, const std::string& state, std::string& personaToken)
 {
-  kodi::Log(ADDON_LOG_DEBUG, "function call: [%s]", __FUNCTION__);
+  DEBUG_LOG("function call: [%s]", __FUNCTION__);
 
   std::string url = SSO_URL + "authenticate";
 
@@ -84,9 +85,9 @@ bool SsoClient::SSOAuthenticate(const std::string& code, const std::string& stat
   if ((doc.GetParseError()) || (statusCode != 200 && statusCode != 206) || (!doc.HasMember("userInfo")))
   {
     if (!doc.GetParseError())
-      kodi::Log(ADDON_LOG_DEBUG, "[Sam3] SSO Authenticate returned: %s", result.c_str());
+      DEBUG_LOG("[Sam3] SSO Authenticate returned: %s", result.c_str());
    else
-      kodi::Log(ADDON_LOG_DEBUG, "[Sam3] SSO Authenticate failed");
+      DEBUG_LOG("[Sam3] SSO Authenticate failed");
     return false;
   }
 
@@ -12,15 +12,16 @@
 #include "rapidjson/document.h"
 #include "../Base64.h"
 #include "../auth/JWT.h"
+#include "../log/DebugLog.h"
 
 void TaaClient::SetTaaUrl(const std::string& url) {
   m_taaUrl = url;
-  kodi::Log(ADDON_LOG_DEBUG, "[Taa] TaaUrl set to: %s", m_taaUrl.c_str());
+  DEBUG_LOG("[Taa] TaaUrl set to: %s", m_taaUrl.c_str());
 }
 /*
 void TaaClient::SetAccountUri(const std::string& accountUri) {
   m_accountUri = accountUri;
-  kodi::Log(ADDON_LOG_DEBUG, "[Taa] AccountURI set to: %s", m_accountUri.c_str());
+  DEBUG_LOG("[Taa] AccountURI set to: %s", m_accountUri.c_str());
 }
 */
 TaaClient::TaaClient(CSettings* setting, HttpClient* httpclient, Sam3Client* sam3client):
@@ -29,6 +30,8 @@ TaaClient::TaaClient(CSettings* setting, HttpClient* httpclient, Sam3Client* sam
   m_sam3Client(sam3client)
 {
   m_dcCtsPersonaToken.clear();
+  m_tokenIat = 0;
+  m_tokenExp = 0;
 //  m_personaToken = m_settings->GetMagenta2PersonaToken();
   m_deviceId = m_settings->GetMagentaDeviceID();
   m_platform = m_settings->GetTerminalType();
@@ -42,7 +45,7 @@ TaaClient::~TaaClient()
 
 bool TaaClient::UpdateTaa(std::string& dcCtsPersonaToken)
 {
-  kodi::Log(ADDON_LOG_DEBUG, "function call: [%s]", __FUNCTION__);
+  DEBUG_LOG("function call: [%s]", __FUNCTION__);
 
   if (m_taaUrl.empty())
     return false;
@@ -78,9 +81,9 @@ bool TaaClient::UpdateTaa(std::string& dcCtsPersonaToken)
   if ((doc.GetParseError()) || (statusCode != 200 && statusCode != 206))
   {
     if (!doc.GetParseError())
-      kodi::Log(ADDON_LOG_DEBUG, "[Taa] Login returned: %s", result.c_str());
+      DEBUG_LOG("[Taa] Login returned: %s", result.c_str());
     else
-      kodi::Log(ADDON_LOG_DEBUG, "[Taa] Failed login");
+      DEBUG_LOG("[Taa] Failed login");
     return false;
   }
 
@@ -94,51 +97,68 @@ bool TaaClient::UpdateTaa(std::string& dcCtsPersonaToken)
   }
 
   m_TaaAccessToken = Utils::JsonStringOrEmpty(doc, "accessToken");
-  std::string header;
-  std::string payload;
-  std::string signature;
-  if (ParseToken(m_TaaAccessToken, header, payload, signature))
-  {
-    kodi::Log(ADDON_LOG_DEBUG, "[Taa] header: %s, Payload %s, Signature: %s", header.c_str(), payload.c_str(), signature.c_str());
-    std::string decPayload = base64_decode(payload);
-//    kodi::Log(ADDON_LOG_DEBUG, "[Taa] decoded access token payload %s", decPayload.c_str());
-    if (!ParseJWT(decPayload))
-      return false;
-    dcCtsPersonaToken = m_dcCtsPersonaToken;
-  }
+  if (!ParseJWT(m_TaaAccessToken))
+    return false;
+  dcCtsPersonaToken = m_dcCtsPersonaToken;
   m_TaaRefreshToken = Utils::JsonStringOrEmpty(doc, "refreshToken");
-  if (ParseToken(m_TaaRefreshToken, header, payload, signature))
-  {
-    std::string decPayload = base64_decode(payload);
-//    kodi::Log(ADDON_LOG_DEBUG, "[Taa] decoded refresh token payload %s", decPayload.c_str());
+  return true;
+}
+
+time_t TaaClient::GetTokenExpiry()
+{
+  // read from the auth queue while a refresh may parse a new token
+  std::lock_guard<std::mutex> lock(m_tokenMutex);
+  return m_tokenExp;
+}
 
+void TaaClient::SaveState(AuthState& state)
+{
+  state.SetString("taa.accessToken", m_TaaAccessToken);
+  state.SetString("taa.refreshToken", m_TaaRefreshToken);
+}
+
+void TaaClient::RestoreState(const AuthState& state)
+{
+  std::string accessToken;
+  if (!state.GetString("taa.accessToken", accessToken) || accessToken.empty())
+    return;
+  // the expiry and ids come back from the claims of the stored token
+  if (!ParseJWT(accessToken) || (GetTokenExpiry() < time(nullptr)))
+  {
+    std::lock_guard<std::mutex> lock(m_tokenMutex);
+    m_tokenExp = 0;
+    return;
   }
-  return true;
+  m_TaaAccessToken = accessToken;
+  state.GetString("taa.refreshToken", m_TaaRefreshToken);
 }
 
 bool TaaClient::ParseJWT(const std::string& jwt)
 {
-  kodi::Log(ADDON_LOG_DEBUG, "function call: [%s]", __FUNCTION__);
+  DEBUG_LOG("function call: [%s]", __FUNCTION__);
 
-  rapidjson::Document doc;
-  doc.Parse(jwt.c_str());
-  if (doc.GetParseError())
+  std::shared_ptr<const JWT> token = JWT::Get(jwt);
+  if (!token->IsValid())
   {
-    kodi::Log(ADDON_LOG_DEBUG, "[Taa] JWT Parse error");
+    DEBUG_LOG("[Taa] JWT Parse error");
     return false;
   }
-  m_tokenIat = Utils::JsonIntOrZero(doc, "iat");
-  m_tokenExp = Utils::JsonIntOrZero(doc, "exp");
+  const JWTClaims& claims = token->GetClaims();
+  {
+    std::lock_guard<std::mutex> lock(m_tokenMutex);
+    m_tokenIat = claims.iat;
+    m_tokenExp = claims.exp;
+  }
 
-  m_dcCtsPersonaToken = Utils::JsonStringOrEmpty(doc, "dc_cts_personaToken");
-  m_accountToken = Utils::JsonStringOrEmpty(doc, "dc_cts_accountToken");
+  m_dcCtsPersonaToken = claims.personaToken;
+  m_accountToken = claims.accountToken;
 
-  m_personaId = Utils::JsonStringOrEmpty(doc, "dc_cts_personaId");
-  m_consumerId = Utils::JsonStringOrEmpty(doc, "dc_cts_consumerId");
-  m_accountId = Utils::JsonStringOrEmpty(doc, "dc_cts_accountId");
-  m_tvAccountId = Utils::JsonStringOrEmpty(doc, "dc_tvAccountId");
+  m_personaId = claims.personaId;
+  m_consumerId = claims.consumerId;
+  m_accountId = claims.accountId;
+  m_tvAccountId = claims.tvAccountId;
 
-  kodi::Log(ADDON_LOG_DEBUG, "[Taa] expire: %u", m_tokenExp);
+  DEBUG_LOG("[Taa] expire: %u", claims.exp);
 //  m_settings->SetIntSetting("personaexpiry", m_tokenExp);
 
   return true;
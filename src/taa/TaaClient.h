@@ -7,9 +7,11 @@
 
 #pragma once
 
+#include <mutex>
 #include "../Settings.h"
 #include "../http/HttpClient.h"
 #include "../sam3/Sam3Client.h"
+#include "../auth/AuthState.h"
 
 static const std::string APPVERSION2 = "3.134.4462";
 static const std::string IDM = "TDGIDM";
@@ -23,6 +25,9 @@ public:
   void SetTaaUrl(const std::string& url);
 //  void SetAccountUri(const std::string& accountUri);
   bool UpdateTaa(std::string& dcCtsPersonaToken);
+  time_t GetTokenExpiry();
+  void SaveState(AuthState& state);
+  void RestoreState(const AuthState& state);
 
 private:
   bool ParseJWT(const std::string& jwt);
@@ -39,6 +44,7 @@ private:
   std::string m_TaaRefreshToken;
   time_t m_tokenIat;
   time_t m_tokenExp;
+  std::mutex m_tokenMutex;
   std::string m_accountToken;
 //  std::string m_personaToken;
   std::string m_dcCtsPersonaToken;
@@ -0,0 +1,170 @@
+/*
+ *  Copyright (C) 2020 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#include "StartupProfiler.h"
+
+#include <kodi/AddonBase.h>
+
+static const size_t NO_PHASE = static_cast<size_t>(-1);
+
+thread_local StartupProfiler::Scope* StartupProfiler::t_current = nullptr;
+
+StartupProfiler::StartupProfiler(const std::string& name)
+  : m_name(name),
+    m_origin(std::chrono::steady_clock::now()),
+    m_reported(false)
+{
+}
+
+StartupProfiler::~StartupProfiler()
+{
+}
+
+StartupProfiler::Scope::Scope(StartupProfiler* profiler, const std::string& name,
+                              const std::vector<std::string>& dependencies)
+  : m_profiler(profiler),
+    m_previous(t_current),
+    m_index(NO_PHASE),
+    m_ok(true)
+{
+  std::string parent;
+  if (m_previous && m_previous->m_profiler == m_profiler && m_previous->m_index != NO_PHASE)
+  {
+    std::lock_guard<std::mutex> lock(m_profiler->m_mutex);
+    parent = m_profiler->m_phases[m_previous->m_index].name;
+  }
+  m_index = m_profiler->Begin(name, parent, dependencies);
+  t_current = this;
+}
+
+StartupProfiler::Scope::~Scope()
+{
+  m_profiler->End(m_index, m_ok);
+  t_current = m_previous;
+}
+
+void StartupProfiler::AddNetwork(const profiletime_t& since, const size_t bytes)
+{
+  Scope* scope = t_current;
+  if (scope)
+    scope->m_profiler->Add(scope->m_index, scope->m_profiler->Elapsed(std::chrono::steady_clock::now()) -
+                                           scope->m_profiler->Elapsed(since), bytes, 0);
+}
+
+void StartupProfiler::AddParse(const profiletime_t& since)
+{
+  Scope* scope = t_current;
+  if (scope)
+    scope->m_profiler->Add(scope->m_index, 0, 0, scope->m_profiler->Elapsed(std::chrono::steady_clock::now()) -
+                                                 scope->m_profiler->Elapsed(since));
+}
+
+int64_t StartupProfiler::Elapsed(const profiletime_t& time) const
+{
+  return std::chrono::duration_cast<std::chrono::milliseconds>(time - m_origin).count();
+}
+
+size_t StartupProfiler::Begin(const std::string& name, const std::string& parent,
+                              const std::vector<std::string>& dependencies)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  // only the startup is of interest, later logins must not show up
+  if (m_reported)
+    return NO_PHASE;
+
+  int64_t now = Elapsed(std::chrono::steady_clock::now());
+  m_phases.push_back({name, parent, dependencies, now, now, 0, 0, 0, 0, false});
+  return m_phases.size() - 1;
+}
+
+void StartupProfiler::End(const size_t index, const bool ok)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  if (index == NO_PHASE)
+    return;
+  m_phases[index].end = Elapsed(std::chrono::steady_clock::now());
+  m_phases[index].ok = ok;
+}
+
+void StartupProfiler::Add(const size_t index, const int64_t networkTime, const size_t bytes, const int64_t parseTime)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  if (index == NO_PHASE)
+    return;
+  StartupPhase& phase = m_phases[index];
+  if (networkTime > 0 || bytes > 0)
+  {
+    phase.networkTime += networkTime;
+    phase.bytes += bytes;
+    phase.requests++;
+  }
+  phase.parseTime += parseTime;
+}
+
+std::vector<std::string> StartupProfiler::CriticalPath() const
+{
+  // walk back from the phase finishing last along the dependency finishing last
+  std::vector<std::string> path;
+  const StartupPhase* current = nullptr;
+  for (const auto& phase : m_phases)
+  {
+    if (phase.parent.empty() && (!current || phase.end > current->end))
+      current = &phase;
+  }
+  while (current)
+  {
+    path.insert(path.begin(), current->name);
+    const StartupPhase* latest = nullptr;
+    for (const auto& dependency : current->dependencies)
+    {
+      for (const auto& phase : m_phases)
+      {
+        if (phase.name == dependency && phase.parent.empty() && (!latest || phase.end > latest->end))
+          latest = &phase;
+      }
+    }
+    current = latest;
+  }
+  return path;
+}
+
+void StartupProfiler::Report()
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  if (m_reported)
+    return;
+  m_reported = true;
+
+  int64_t total = 0;
+  for (const auto& phase : m_phases)
+  {
+    if (phase.end > total)
+      total = phase.end;
+  }
+  kodi::Log(ADDON_LOG_INFO, "[Startup] %s ready after %lldms", m_name.c_str(), static_cast<long long>(total));
+  for (const auto& phase : m_phases)
+  {
+    kodi::Log(ADDON_LOG_INFO, "[Startup] %s%s%s: %s start=%lldms wall=%lldms net=%lldms requests=%i bytes=%llu parse=%lldms",
+              phase.parent.c_str(), phase.parent.empty() ? "" : "/", phase.name.c_str(),
+              phase.ok ? "ok" : "failed",
+              static_cast<long long>(phase.start),
+              static_cast<long long>(phase.end - phase.start),
+              static_cast<long long>(phase.networkTime),
+              phase.requests,
+              static_cast<unsigned long long>(phase.bytes),
+              static_cast<long long>(phase.parseTime));
+  }
+
+  std::string path;
+  for (const auto& name : CriticalPath())
+  {
+    if (!path.empty())
+      path += " -> ";
+    path += name;
+  }
+  kodi::Log(ADDON_LOG_INFO, "[Startup] critical path: %s", path.c_str());
+}
@@ -0,0 +1,79 @@
+/*
+ *  Copyright (C) 2020 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+typedef std::chrono::steady_clock::time_point profiletime_t;
+
+struct StartupPhase
+{
+  std::string name;
+  std::string parent;
+  std::vector<std::string> dependencies;
+  int64_t start; //ms since the profiler was created
+  int64_t end;
+  int64_t networkTime;
+  uint64_t bytes;
+  int requests;
+  int64_t parseTime;
+  bool ok;
+};
+
+// Collects wall, network and parse time per startup phase. Network and parse
+// time are attributed to the phase running on the calling thread, so the
+// http and json code only has to report what it measured.
+class StartupProfiler
+{
+public:
+  StartupProfiler(const std::string& name);
+  ~StartupProfiler();
+
+  // Marks the calling thread as running the phase for its lifetime,
+  // a scope opened inside another one becomes its sub-phase
+  class Scope
+  {
+  public:
+    Scope(StartupProfiler* profiler, const std::string& name,
+          const std::vector<std::string>& dependencies = {});
+    ~Scope();
+    void SetResult(const bool ok) { m_ok = ok; }
+
+  private:
+    StartupProfiler* m_profiler;
+    Scope* m_previous;
+    size_t m_index;
+    bool m_ok;
+
+    friend class StartupProfiler;
+  };
+
+  static void AddNetwork(const profiletime_t& since, const size_t bytes);
+  static void AddParse(const profiletime_t& since);
+  void Report();
+
+private:
+  size_t Begin(const std::string& name, const std::string& parent,
+               const std::vector<std::string>& dependencies);
+  void End(const size_t index, const bool ok);
+  void Add(const size_t index, const int64_t networkTime, const size_t bytes, const int64_t parseTime);
+  int64_t Elapsed(const profiletime_t& time) const;
+  std::vector<std::string> CriticalPath() const;
+
+  std::string m_name;
+  profiletime_t m_origin;
+  std::mutex m_mutex;
+  std::vector<StartupPhase> m_phases;
+  bool m_reported;
+
+  static thread_local Scope* t_current;
+};
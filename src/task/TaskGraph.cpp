@@ -0,0 +1,154 @@
+/*
+ *  Copyright (C) 2020 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#include "TaskGraph.h"
+
+#include <exception>
+#include <kodi/AddonBase.h>
+#include "../log/DebugLog.h"
+
+namespace
+{
+// a throwing step fails like one returning false, Wait must not rethrow into Kodi's callbacks
+bool RunTask(const std::string& name, const std::function<bool()>& task)
+{
+  try
+  {
+    return task();
+  }
+  catch (const std::exception& e)
+  {
+    kodi::Log(ADDON_LOG_ERROR, "[TaskGraph] Step %s failed: %s", name.c_str(), e.what());
+  }
+  catch (...)
+  {
+    kodi::Log(ADDON_LOG_ERROR, "[TaskGraph] Step %s failed", name.c_str());
+  }
+  return false;
+}
+}
+
+TaskGraph::TaskGraph()
+  : m_profiler(nullptr),
+    m_started(false)
+{
+}
+
+TaskGraph::~TaskGraph()
+{
+  WaitAll();
+}
+
+bool TaskGraph::Add(const std::string& name, const std::vector<std::string>& dependencies,
+                    const std::function<bool()>& task)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  if (m_started || (m_steps.find(name) != m_steps.end()))
+  {
+    kodi::Log(ADDON_LOG_ERROR, "[TaskGraph] Cannot add step %s", name.c_str());
+    return false;
+  }
+  for (const auto& dependency : dependencies)
+  {
+    if (m_steps.find(dependency) == m_steps.end())
+    {
+      kodi::Log(ADDON_LOG_ERROR, "[TaskGraph] Step %s depends on unknown step %s",
+                name.c_str(), dependency.c_str());
+      return false;
+    }
+  }
+  m_steps[name] = {dependencies, task, {}};
+  m_order.emplace_back(name);
+  return true;
+}
+
+void TaskGraph::Start()
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  if (m_started)
+    return;
+  m_started = true;
+
+  // dependencies come first in m_order, so their futures already exist
+  for (const auto& name : m_order)
+  {
+    Step& step = m_steps[name];
+    std::vector<std::shared_future<bool>> dependencies;
+    for (const auto& dependency : step.dependencies)
+      dependencies.emplace_back(m_steps[dependency].result);
+
+    std::function<bool()> task = step.task;
+    StartupProfiler* profiler = m_profiler;
+    std::vector<std::string> names = step.dependencies;
+    step.result = std::async(std::launch::async, [name, dependencies, task, profiler, names]() {
+      for (const auto& dependency : dependencies)
+      {
+        if (!dependency.get())
+        {
+          DEBUG_LOG("[TaskGraph] Skipping %s", name.c_str());
+          return false;
+        }
+      }
+      if (!profiler)
+        return RunTask(name, task);
+      StartupProfiler::Scope scope(profiler, name, names);
+      bool ok = RunTask(name, task);
+      scope.SetResult(ok);
+      return ok;
+    }).share();
+  }
+
+  if (m_profiler)
+  {
+    std::vector<std::shared_future<bool>> results;
+    for (const auto& step : m_steps)
+      results.emplace_back(step.second.result);
+    StartupProfiler* profiler = m_profiler;
+    m_report = std::async(std::launch::async, [results, profiler]() {
+      for (const auto& result : results)
+        result.wait();
+      profiler->Report();
+    }).share();
+  }
+}
+
+bool TaskGraph::Wait(const std::string& name)
+{
+  std::shared_future<bool> result;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_steps.find(name);
+    if (it == m_steps.end())
+      return false;
+    result = it->second.result;
+  }
+  if (!result.valid())
+    return false;
+  return result.get();
+}
+
+void TaskGraph::WaitAll()
+{
+  std::vector<std::shared_future<bool>> results;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (const auto& step : m_steps)
+      results.emplace_back(step.second.result);
+  }
+  for (const auto& result : results)
+  {
+    if (result.valid())
+      result.wait();
+  }
+  std::shared_future<void> report;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    report = m_report;
+  }
+  if (report.valid())
+    report.wait();
+}
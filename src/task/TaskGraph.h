@@ -0,0 +1,51 @@
+/*
+ *  Copyright (C) 2020 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#pragma once
+
+#include <functional>
+#include <future>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "StartupProfiler.h"
+
+// Runs named steps concurrently once their dependencies succeeded. A step
+// whose dependency failed is skipped and counts as failed itself.
+// Dependencies have to be added before the steps relying on them.
+// With a profiler set every step is timed as a phase and the profiler
+// reports once all steps are done.
+class TaskGraph
+{
+public:
+  TaskGraph();
+  ~TaskGraph();
+
+  void SetProfiler(StartupProfiler* profiler) { m_profiler = profiler; }
+  bool Add(const std::string& name, const std::vector<std::string>& dependencies,
+           const std::function<bool()>& task);
+  void Start();
+  bool Wait(const std::string& name);
+  void WaitAll();
+
+private:
+  struct Step
+  {
+    std::vector<std::string> dependencies;
+    std::function<bool()> task;
+    std::shared_future<bool> result;
+  };
+
+  std::mutex m_mutex;
+  std::vector<std::string> m_order;
+  std::map<std::string, Step> m_steps;
+  std::shared_future<void> m_report;
+  StartupProfiler* m_profiler;
+  bool m_started;
+};
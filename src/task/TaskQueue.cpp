@@ -0,0 +1,127 @@
+/*
+ *  Copyright (C) 2020 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#include "TaskQueue.h"
+
+#include <kodi/AddonBase.h>
+
+TaskQueue::TaskQueue()
+  : m_running(false),
+    m_stopped(false)
+{
+}
+
+TaskQueue::~TaskQueue()
+{
+  Stop(false);
+}
+
+void TaskQueue::Post(const std::function<void()>& task)
+{
+  Enqueue("", 0, task);
+}
+
+void TaskQueue::Schedule(const std::string& key, const int delayMs, const std::function<void()>& task)
+{
+  Enqueue(key, delayMs, task);
+}
+
+void TaskQueue::Enqueue(const std::string& key, const int delayMs, const std::function<void()>& task)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  if (m_stopped)
+    return;
+
+  if (!key.empty())
+    m_tasks.remove_if([&key](const Task& pending) { return pending.key == key; });
+  m_tasks.push_back({key, std::chrono::steady_clock::now() + std::chrono::milliseconds(delayMs), task});
+
+  if (!m_running)
+  {
+    m_running = true;
+    m_thread = std::thread(&TaskQueue::Process, this);
+  }
+  m_condition.notify_one();
+}
+
+bool TaskQueue::Cancel(const std::string& key)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  size_t before = m_tasks.size();
+  m_tasks.remove_if([&key](const Task& pending) { return pending.key == key; });
+  return m_tasks.size() != before;
+}
+
+bool TaskQueue::IsPending(const std::string& key)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  for (const auto& pending : m_tasks)
+  {
+    if (pending.key == key)
+      return true;
+  }
+  return false;
+}
+
+void TaskQueue::Stop(const bool runPending)
+{
+  std::list<Task> pending;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_stopped)
+      return;
+    m_stopped = true;
+    pending.swap(m_tasks);
+    m_condition.notify_one();
+  }
+  if (m_thread.joinable())
+    m_thread.join();
+
+  if (!runPending)
+    return;
+  // delayed writes must not get lost on shutdown
+  for (const auto& task : pending)
+    task.run();
+}
+
+void TaskQueue::Process()
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  while (!m_stopped)
+  {
+    if (m_tasks.empty())
+    {
+      m_condition.wait(lock);
+      continue;
+    }
+
+    auto next = m_tasks.begin();
+    for (auto it = m_tasks.begin(); it != m_tasks.end(); ++it)
+    {
+      if (it->due < next->due)
+        next = it;
+    }
+    if (next->due > std::chrono::steady_clock::now())
+    {
+      m_condition.wait_until(lock, next->due);
+      continue;
+    }
+
+    Task task = *next;
+    m_tasks.erase(next);
+    lock.unlock();
+    try
+    {
+      task.run();
+    }
+    catch (const std::exception& e)
+    {
+      kodi::Log(ADDON_LOG_ERROR, "Background task %s failed: %s", task.key.c_str(), e.what());
+    }
+    lock.lock();
+  }
+}
@@ -0,0 +1,50 @@
+/*
+ *  Copyright (C) 2020 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <list>
+#include <mutex>
+#include <string>
+#include <thread>
+
+// Single background worker for work that must not block Kodi's threads.
+// Tasks scheduled with a key are debounced: scheduling the same key again
+// replaces the pending task and restarts its delay.
+class TaskQueue
+{
+public:
+  TaskQueue();
+  ~TaskQueue();
+
+  void Post(const std::function<void()>& task);
+  void Schedule(const std::string& key, const int delayMs, const std::function<void()>& task);
+  bool Cancel(const std::string& key);
+  bool IsPending(const std::string& key);
+  void Stop(const bool runPending);
+
+private:
+  struct Task
+  {
+    std::string key;
+    std::chrono::steady_clock::time_point due;
+    std::function<void()> run;
+  };
+
+  void Enqueue(const std::string& key, const int delayMs, const std::function<void()>& task);
+  void Process();
+
+  std::mutex m_mutex;
+  std::condition_variable m_condition;
+  std::list<Task> m_tasks;
+  std::thread m_thread;
+  bool m_running;
+  bool m_stopped;
+};
@@ -0,0 +1,178 @@
+/*
+ *  Copyright (C) 2020 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#include "Trace.h"
+
+#ifdef MAGENTA_TRACING
+
+#include <chrono>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <kodi/AddonBase.h>
+#include <kodi/Filesystem.h>
+#include "rapidjson/writer.h"
+#include "rapidjson/stringbuffer.h"
+
+namespace
+{
+std::mutex g_buffersMutex;
+// buffers outlive their threads, spans of finished workers still show up in the dump
+std::vector<std::shared_ptr<TraceBuffer>> g_buffers;
+
+// gives the buffer back when its thread exits
+struct TraceBufferLease
+{
+  TraceBuffer* buffer = nullptr;
+  ~TraceBufferLease()
+  {
+    if (buffer)
+      buffer->Release();
+  }
+};
+
+TraceBuffer* GetThreadBuffer()
+{
+  thread_local TraceBufferLease lease;
+  if (!lease.buffer)
+  {
+    std::lock_guard<std::mutex> lock(g_buffersMutex);
+    for (const auto& buffer : g_buffers)
+    {
+      if (buffer->Acquire())
+      {
+        lease.buffer = buffer.get();
+        return lease.buffer;
+      }
+    }
+    if (g_buffers.size() >= TRACE_MAX_BUFFERS)
+      return nullptr;
+    g_buffers.emplace_back(std::make_shared<TraceBuffer>(static_cast<int>(g_buffers.size()) + 1));
+    g_buffers.back()->Acquire();
+    lease.buffer = g_buffers.back().get();
+  }
+  return lease.buffer;
+}
+
+void CopyName(char* target, const char* name)
+{
+  strncpy(target, name, TRACE_NAME_SIZE - 1);
+  target[TRACE_NAME_SIZE - 1] = '\0';
+}
+}
+
+void TraceBuffer::Add(const char* category, const char* name, const int64_t start, const int64_t duration)
+{
+  uint64_t next = m_next.load(std::memory_order_relaxed);
+  Slot& slot = m_slots[next % TRACE_BUFFER_SIZE];
+  uint32_t sequence = slot.sequence.load(std::memory_order_relaxed);
+  slot.sequence.store(sequence + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  slot.event.category = category;
+  CopyName(slot.event.name, name);
+  slot.event.start = start;
+  slot.event.duration = duration;
+  slot.sequence.store(sequence + 2, std::memory_order_release);
+  m_next.store(next + 1, std::memory_order_release);
+}
+
+bool TraceBuffer::GetEvent(const uint64_t index, TraceEvent& event) const
+{
+  const Slot& slot = m_slots[index % TRACE_BUFFER_SIZE];
+  uint32_t before = slot.sequence.load(std::memory_order_acquire);
+  if (before & 1)
+    return false;
+  event = slot.event;
+  std::atomic_thread_fence(std::memory_order_acquire);
+  return slot.sequence.load(std::memory_order_relaxed) == before;
+}
+
+TraceSpan::TraceSpan(const char* category, const char* name)
+  : m_category(category),
+    m_start(Trace::Now())
+{
+  CopyName(m_name, name);
+}
+
+TraceSpan::TraceSpan(const char* category, const std::string& name)
+  : TraceSpan(category, name.c_str())
+{
+}
+
+TraceSpan::~TraceSpan()
+{
+  TraceBuffer* buffer = GetThreadBuffer();
+  if (buffer)
+    buffer->Add(m_category, m_name, m_start, Trace::Now() - m_start);
+}
+
+int64_t Trace::Now()
+{
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+bool Trace::Dump(const std::string& file)
+{
+  std::vector<std::shared_ptr<TraceBuffer>> buffers;
+  {
+    std::lock_guard<std::mutex> lock(g_buffersMutex);
+    buffers = g_buffers;
+  }
+
+  rapidjson::StringBuffer output;
+  rapidjson::Writer<rapidjson::StringBuffer> writer(output);
+  writer.StartObject();
+  writer.Key("displayTimeUnit");
+  writer.String("ms");
+  writer.Key("traceEvents");
+  writer.StartArray();
+  for (const auto& buffer : buffers)
+  {
+    // threads keep tracing while we read, spans rewritten meanwhile are left out
+    uint64_t count = buffer->GetCount();
+    uint64_t first = count > TRACE_BUFFER_SIZE ? count - TRACE_BUFFER_SIZE : 0;
+    for (uint64_t i = first; i < count; i++)
+    {
+      TraceEvent event;
+      if (!buffer->GetEvent(i, event))
+        continue;
+      writer.StartObject();
+      writer.Key("name");
+      writer.String(event.name);
+      writer.Key("cat");
+      writer.String(event.category);
+      writer.Key("ph");
+      writer.String("X");
+      writer.Key("ts");
+      writer.Int64(event.start);
+      writer.Key("dur");
+      writer.Int64(event.duration);
+      writer.Key("pid");
+      writer.Int(1);
+      writer.Key("tid");
+      writer.Int(buffer->GetThreadId());
+      writer.EndObject();
+    }
+  }
+  writer.EndArray();
+  writer.EndObject();
+
+  kodi::vfs::CFile traceFile;
+  if (!traceFile.OpenFileForWrite(file, true))
+  {
+    kodi::Log(ADDON_LOG_ERROR, "[Trace] Could not write %s", file.c_str());
+    return false;
+  }
+  const char* json = output.GetString();
+  traceFile.Write(json, strlen(json));
+  kodi::Log(ADDON_LOG_INFO, "[Trace] Wrote %s", file.c_str());
+  return true;
+}
+
+#endif
@@ -0,0 +1,90 @@
+/*
+ *  Copyright (C) 2020 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#pragma once
+
+// Spans only exist in builds configured with -DMAGENTA_TRACING=ON, otherwise
+// the macros expand to nothing and cost nothing.
+#ifdef MAGENTA_TRACING
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+static const size_t TRACE_BUFFER_SIZE = 8192; //spans kept per thread
+static const size_t TRACE_MAX_BUFFERS = 32; //threads traced at the same time, further ones are not recorded
+static const size_t TRACE_NAME_SIZE = 64;
+
+struct TraceEvent
+{
+  const char* category;
+  char name[TRACE_NAME_SIZE];
+  int64_t start; //us on the monotonic clock
+  int64_t duration;
+};
+
+// Ring of the latest spans finished on one thread. Only the owning thread
+// writes, so a span is recorded without taking a lock. Each slot carries a
+// sequence number that is odd while it is rewritten, a reader retries or
+// skips a slot that changed under it. Once its thread exits the buffer is
+// handed to the next new thread, keeping the spans recorded so far.
+class TraceBuffer
+{
+public:
+  TraceBuffer(const int threadId) : m_threadId(threadId), m_next(0), m_inUse(false) {}
+
+  void Add(const char* category, const char* name, const int64_t start, const int64_t duration);
+  int GetThreadId() const { return m_threadId; }
+  uint64_t GetCount() const { return m_next.load(std::memory_order_acquire); }
+  bool GetEvent(const uint64_t index, TraceEvent& event) const;
+  bool Acquire() { return !m_inUse.exchange(true, std::memory_order_acquire); }
+  void Release() { m_inUse.store(false, std::memory_order_release); }
+
+private:
+  struct Slot
+  {
+    std::atomic<uint32_t> sequence;
+    TraceEvent event;
+  };
+
+  int m_threadId;
+  std::atomic<uint64_t> m_next;
+  std::atomic<bool> m_inUse;
+  Slot m_slots[TRACE_BUFFER_SIZE] = {};
+};
+
+class TraceSpan
+{
+public:
+  TraceSpan(const char* category, const char* name);
+  TraceSpan(const char* category, const std::string& name);
+  ~TraceSpan();
+
+private:
+  const char* m_category;
+  char m_name[TRACE_NAME_SIZE];
+  int64_t m_start;
+};
+
+namespace Trace
+{
+int64_t Now();
+// Writes every buffered span as Chrome trace-event json (chrome://tracing, Perfetto)
+bool Dump(const std::string& file);
+}
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+#define TRACE_SCOPE(category, name) TraceSpan TRACE_CONCAT(traceSpan, __LINE__)(category, name)
+#define TRACE_DUMP(file) Trace::Dump(file)
+
+#else
+
+#define TRACE_SCOPE(category, name)
+#define TRACE_DUMP(file)
+
+#endif